@@ -39,6 +39,7 @@
 #include <algorithm>
 #include <cxxtools/inifile.h>
 
+#include "db/asset_changes.h"
 #include "db/inout.h"
 #include "shared/csv.h"
 
@@ -47,6 +48,8 @@ s_usage()
 {
     std::cerr << "Usage: bios-csv [export|compare]" << std::endl;
     std::cerr << "       export     export csv file from current DB" << std::endl;
+    std::cerr << "                  --since TIME  only assets changed and deleted since TIME" << std::endl;
+    std::cerr << "                                (seconds since epoch or 2020-01-31T12:00:00+0100)" << std::endl;
     std::cerr << "       compare    sourcefile_1 exportedfile_2  return exportedfile_2 corresponds with sourcefile_1" << std::endl;
     std::cerr << "Enviromental variables:" << std::endl;
     std::cerr << "      DB_USER     name of database user" << std::endl;
@@ -186,7 +189,23 @@ int main(int argc, char** argv)
         if (!strcmp(argv[1], "export"))
         {
            // log_set_level(LOG_WARNING); //to suppress messages from src/db
-            persist::export_asset_csv(std::cout);
+            std::time_t since = 0;
+            if (argc >= 3)
+            {
+                if (argc != 4 || strcmp(argv[2], "--since") != 0)
+                    s_die_usage();
+                if (!persist::parse_change_time(argv[3], since))
+                {
+                    log_error("Invalid time '%s'", argv[3]);
+                    exit(EXIT_FAILURE);
+                }
+                if (!persist::asset_tombstones_cover(since))
+                {
+                    log_error("Deleted assets are kept for %d days only, do a full export", ASSET_TOMBSTONES_KEEP_DAYS);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            persist::export_asset_csv(std::cout, -1, true, since);
         }
         else
         if (!strcmp(argv[1], "compare"))
@@ -19,9 +19,9 @@
  */
 
 #include "db/agentstate/agentstate.h"
+#include "db/connection_pool.h"
 #include "shared/utils.h"
 #include <fty_common.h>
-#include <fty_common_db_dbpath.h>
 #include <inttypes.h>
 #include <tntdb/error.h>
 #include <tntdb/row.h>
@@ -71,9 +71,8 @@ int save_agent_info(const std::string& agent_name, const std::string& data)
 {
     int result = 1;
     try {
-        auto connection = tntdb::connect(DBConn::url);
+        auto connection = ConnectionPool::instance().acquire();
         result          = save_agent_info(connection, agent_name, data);
-        connection.close();
     } catch (const std::exception& e) {
         log_error("Cannot save agent %s info: %s", agent_name.c_str(), e.what());
     }
@@ -121,7 +120,7 @@ int load_agent_info(tntdb::Connection& conn, const std::string& agent_name, std:
 int load_agent_info(const std::string& agent_name, std::string& agent_info)
 {
     try {
-        auto connection = tntdb::connect(DBConn::url);
+        auto connection = ConnectionPool::instance().acquire();
         return load_agent_info(connection, agent_name, agent_info);
     } catch (const std::exception& e) {
         log_info("Cannot load agent %s info: %s", agent_name.c_str(), e.what());
@@ -0,0 +1,331 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_bulk.cc
+ * \brief Chunked insert of new assets for csv import
+ */
+#include "db/asset_bulk.h"
+#include "db/asset_general.h"
+#include <algorithm>
+#include <fty_common.h>
+#include <fty_common_macros.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace persist {
+
+// rows per one multi-row INSERT, keeps the statement and its parameters reasonably small
+static constexpr size_t ROWS_PER_STATEMENT = 256;
+
+static db_reply_t s_error(const std::string& msg)
+{
+    db_reply_t ret = db_reply_new();
+    ret.status     = 0;
+    ret.errtype    = DB_ERR;
+    ret.errsubtype = DB_ERROR_BADINPUT;
+    ret.msg        = msg;
+    return ret;
+}
+
+// " (:k0, :v0), (:k1, :v1)" for names {"k", "v"} and count 2
+static std::string s_values(std::initializer_list<const char*> names, size_t count)
+{
+    std::string values;
+    for (size_t i = 0; i != count; ++i) {
+        values += i == 0 ? " (" : ", (";
+        bool first = true;
+        for (const char* name : names) {
+            if (!first) {
+                values += ", ";
+            }
+            first = false;
+            values += ':';
+            values += name;
+            values += std::to_string(i);
+        }
+        values += ')';
+    }
+    return values;
+}
+
+AssetBulkInsert::AssetBulkInsert(tntdb::Connection& conn)
+    : _conn(conn)
+{
+}
+
+AssetBulkInsert::~AssetBulkInsert()
+{
+    if (_active) {
+        log_warning("bulk insert of %zu assets was not flushed, rolled back", _size);
+        rollback();
+    }
+}
+
+void AssetBulkInsert::begin()
+{
+    if (!_active) {
+        _conn.beginTransaction();
+        _active = true;
+    }
+}
+
+void AssetBulkInsert::rollback()
+{
+    try {
+        _conn.rollbackTransaction();
+    } catch (const std::exception& e) {
+        log_error("rollback of bulk insert failed: %s", e.what());
+    }
+    _active = false;
+    _size   = 0;
+    _ext_attributes.clear();
+    _groups.clear();
+    _links.clear();
+}
+
+void AssetBulkInsert::queue_ext_attributes(a_elmnt_id_t id, zhash_t* attributes, bool read_only)
+{
+    if (attributes == NULL) {
+        return;
+    }
+    for (void* it = zhash_first(attributes); it != NULL; it = zhash_next(attributes)) {
+        _ext_attributes.push_back({id, zhash_cursor(attributes), static_cast<const char*>(it), read_only});
+    }
+}
+
+db_reply_t AssetBulkInsert::insert(
+    const char*                   element_name,
+    a_elmnt_tp_id_t               element_type_id,
+    a_dvc_tp_id_t                 asset_device_type_id,
+    a_elmnt_id_t                  parent_id,
+    zhash_t*                      extattributes,
+    const char*                   status,
+    a_elmnt_pr_t                  priority,
+    std::set<a_elmnt_id_t> const& groups,
+    std::vector<link_t>&          links,
+    const std::string&            asset_tag,
+    zhash_t*                      extattributesRO,
+    std::string&                  name)
+{
+    LOG_START;
+    bool is_device = element_type_id == asset_type::DEVICE;
+
+    // uniqueness of the name is checked by the caller, the new assets are not visible to other connections yet
+    std::string iname;
+    auto        reply_check = check_new_asset(element_name, element_type_id, asset_device_type_id, status, false, iname);
+    if (reply_check.status == 0) {
+        return reply_check;
+    }
+
+    begin();
+    _conn.execute("SAVEPOINT bulk_row");
+
+    db_reply_t reply_insert1;
+    try {
+        reply_insert1 = DBAssetsInsert::insert_into_asset_element(
+            _conn, iname.c_str(), element_type_id, parent_id, status, priority, is_device ? asset_device_type_id : 0,
+            asset_tag.c_str(), false);
+        if (reply_insert1.status == 0) {
+            _conn.execute("ROLLBACK TO SAVEPOINT bulk_row");
+            log_info("end: element was not inserted");
+            reply_insert1.msg = JSONIFY(reply_insert1.msg.c_str());
+            return reply_insert1;
+        }
+        auto element_id = uint32_t(reply_insert1.rowid);
+
+        // monitor part, same as insert_device() and insert_dc_room_row_rack_group()
+        uint16_t monitor_type_id = 0;
+        if (is_device) {
+            // BIOS-1962: we do not use this classification. So ignore it.
+            auto reply_select = DBAssets::select_monitor_device_type_id(_conn, "not_classified");
+            if (reply_select.status == 1) {
+                monitor_type_id = uint16_t(reply_select.item);
+            } else if (reply_select.errsubtype != DB_ERROR_NOTFOUND) {
+                _conn.execute("ROLLBACK TO SAVEPOINT bulk_row");
+                log_warning("end: some error in denoting a type of device in monitor part");
+                reply_select.msg = JSONIFY(reply_select.msg.c_str());
+                return reply_select;
+            }
+        } else if ((element_type_id == asset_type::DATACENTER) || (element_type_id == asset_type::RACK)) {
+            monitor_type_id = 1;
+        }
+        if (monitor_type_id != 0) {
+            auto reply_insert4 = DBAssetsInsert::insert_into_monitor_device(_conn, monitor_type_id, element_name);
+            if (reply_insert4.status == 0) {
+                _conn.execute("ROLLBACK TO SAVEPOINT bulk_row");
+                log_info("end: device was not inserted (fail monitor_device)");
+                reply_insert4.msg = JSONIFY(reply_insert4.msg.c_str());
+                return reply_insert4;
+            }
+            auto reply_insert5 =
+                DBAssetsInsert::insert_into_monitor_asset_relation(_conn, uint16_t(reply_insert4.rowid), element_id);
+            if (reply_insert5.status == 0) {
+                _conn.execute("ROLLBACK TO SAVEPOINT bulk_row");
+                log_info("end: monitor asset link was not inserted (fail monitor asset relation)");
+                reply_insert5.msg = JSONIFY(reply_insert5.msg.c_str());
+                return reply_insert5;
+            }
+        }
+
+        // name is derived from the id by the insert
+        tntdb::Statement st =
+            _conn.prepareCached(" SELECT name FROM t_bios_asset_element WHERE id_asset_element = :id");
+        st.set("id", element_id).selectValue().get(name);
+        ++_size;
+
+        queue_ext_attributes(element_id, extattributes, false);
+        queue_ext_attributes(element_id, extattributesRO, true);
+        for (auto group_id : groups) {
+            _groups.emplace_back(group_id, element_id);
+        }
+        if (is_device) {
+            for (auto& one_link : links) {
+                // links don't have 'dest' defined - it was not known until now; we have to fix it
+                one_link.dest = element_id;
+                _links.push_back({one_link.src, element_id, one_link.src_out ? one_link.src_out : "",
+                    one_link.dest_in ? one_link.dest_in : "", one_link.type});
+            }
+        }
+    } catch (const std::exception& e) {
+        _conn.execute("ROLLBACK TO SAVEPOINT bulk_row");
+        log_error("end: element '%s' was not inserted: %s", element_name, e.what());
+        auto ret       = s_error(JSONIFY(e.what()));
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        return ret;
+    }
+
+    LOG_END;
+    reply_insert1.msg = JSONIFY(reply_insert1.msg.c_str());
+    return reply_insert1;
+}
+
+void AssetBulkInsert::write_ext_attributes()
+{
+    for (size_t start = 0; start < _ext_attributes.size(); start += ROWS_PER_STATEMENT) {
+        size_t count = std::min(ROWS_PER_STATEMENT, _ext_attributes.size() - start);
+
+        // as DBAssetsInsert::insert_into_asset_ext_attributes, a read-only value is not overwritten by
+        // a read-write one (value is assigned before read_only changes)
+        tntdb::Statement st = _conn.prepareCached(
+            " INSERT INTO t_bios_asset_ext_attributes"
+            "   (keytag, value, id_asset_element, read_only)"
+            " VALUES" +
+            s_values({"k", "v", "i", "r"}, count) +
+            " ON DUPLICATE KEY UPDATE"
+            "   value = IF(read_only AND NOT VALUES(read_only), value, VALUES(value)),"
+            "   read_only = read_only OR VALUES(read_only)");
+        for (size_t i = 0; i != count; ++i) {
+            const auto& attr = _ext_attributes[start + i];
+            std::string n    = std::to_string(i);
+            st.set("k" + n, attr.keytag).set("v" + n, attr.value).set("i" + n, attr.id).set("r" + n, attr.read_only);
+        }
+        st.execute();
+    }
+}
+
+void AssetBulkInsert::write_groups()
+{
+    for (size_t start = 0; start < _groups.size(); start += ROWS_PER_STATEMENT) {
+        size_t count = std::min(ROWS_PER_STATEMENT, _groups.size() - start);
+
+        tntdb::Statement st = _conn.prepareCached(
+            " INSERT INTO t_bios_asset_group_relation"
+            "   (id_asset_group, id_asset_element)"
+            " VALUES" +
+            s_values({"g", "e"}, count));
+        for (size_t i = 0; i != count; ++i) {
+            std::string n = std::to_string(i);
+            st.set("g" + n, _groups[start + i].first).set("e" + n, _groups[start + i].second);
+        }
+        if (st.execute() != count) {
+            throw std::runtime_error(TRANSLATE_ME("cannot insert device into all specified groups"));
+        }
+    }
+}
+
+void AssetBulkInsert::write_links()
+{
+    for (size_t start = 0; start < _links.size(); start += ROWS_PER_STATEMENT) {
+        size_t count = std::min(ROWS_PER_STATEMENT, _links.size() - start);
+
+        tntdb::Statement st = _conn.prepareCached(
+            " INSERT INTO t_bios_asset_link"
+            "   (id_asset_device_src, src_out, id_asset_device_dest, dest_in, id_asset_link_type)"
+            " VALUES" +
+            s_values({"s", "so", "d", "di", "t"}, count));
+        for (size_t i = 0; i != count; ++i) {
+            const auto& link = _links[start + i];
+            std::string n    = std::to_string(i);
+            st.set("s" + n, link.src).set("d" + n, link.dest).set("t" + n, link.type);
+            if (link.src_out.empty()) {
+                st.setNull("so" + n);
+            } else {
+                st.set("so" + n, link.src_out);
+            }
+            if (link.dest_in.empty()) {
+                st.setNull("di" + n);
+            } else {
+                st.set("di" + n, link.dest_in);
+            }
+        }
+        if (st.execute() != count) {
+            throw std::runtime_error(TRANSLATE_ME("not all links were inserted"));
+        }
+    }
+}
+
+db_reply_t AssetBulkInsert::flush()
+{
+    LOG_START;
+    db_reply_t ret = db_reply_new();
+    if (!_active) {
+        ret.status = 1;
+        return ret;
+    }
+
+    try {
+        write_ext_attributes();
+        write_groups();
+        write_links();
+        _conn.commitTransaction();
+    } catch (const std::exception& e) {
+        log_error("bulk insert of %zu assets failed: %s", _size, e.what());
+        rollback();
+        ret = s_error(JSONIFY(e.what()));
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        return ret;
+    }
+
+    log_debug(
+        "bulk insert of %zu assets (%zu ext attributes, %zu group relations, %zu links) committed", _size,
+        _ext_attributes.size(), _groups.size(), _links.size());
+    ret.status        = 1;
+    ret.affected_rows = _size;
+    _active           = false;
+    _size             = 0;
+    _ext_attributes.clear();
+    _groups.clear();
+    _links.clear();
+    LOG_END;
+    return ret;
+}
+
+} // namespace persist
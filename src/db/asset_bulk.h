@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_bulk.h
+/// @brief Chunked insert of new assets for csv import
+///
+/// How it works
+/// ============
+/// Rows of one chunk share a single transaction. The element row (and its
+/// monitor part) is inserted right away, because the id is needed by the
+/// following rows. External attributes, group membership and power links
+/// are queued and written by multi-row INSERTs in flush(), which commits.
+/// A keytag given both read-write and read-only keeps the read-only value,
+/// as with DBAssetsInsert::insert_into_asset_ext_attributes.
+///
+/// A row failing in insert() is rolled back to its savepoint, the rest of
+/// the chunk is kept. If flush() fails, the whole chunk is rolled back and
+/// the caller is expected to import its rows again one by one, to get
+/// a precise error per row.
+///
+/// Until flush(), the new assets are visible only through this connection,
+/// so the caller is responsible for name resolution and for the check of
+/// duplicate names (csv import does both with AssetNames).
+
+#pragma once
+
+#include "db/dbhelpers.h"
+#include <fty_common_db.h>
+#include <set>
+#include <string>
+#include <tntdb/connection.h>
+#include <vector>
+
+namespace persist {
+
+class AssetBulkInsert
+{
+public:
+    explicit AssetBulkInsert(tntdb::Connection& conn);
+
+    /// Rolls back the chunk, which was not flushed
+    ~AssetBulkInsert();
+
+    AssetBulkInsert(const AssetBulkInsert&) = delete;
+    AssetBulkInsert& operator=(const AssetBulkInsert&) = delete;
+
+    /// Inserts new asset into the current chunk
+    ///
+    /// Arguments have the same meaning as for insert_device() and
+    /// insert_dc_room_row_rack_group(), subtype is ignored unless the
+    /// element is a device. The asset is checked by check_new_asset() as
+    /// there, except for uniqueness of element_name.
+    ///
+    /// @param[out] name - internal name of the new element
+    /// @return reply with rowid of the new element, or the error
+    db_reply_t insert(
+        const char*                   element_name,
+        a_elmnt_tp_id_t               element_type_id,
+        a_dvc_tp_id_t                 asset_device_type_id,
+        a_elmnt_id_t                  parent_id,
+        zhash_t*                      extattributes,
+        const char*                   status,
+        a_elmnt_pr_t                  priority,
+        std::set<a_elmnt_id_t> const& groups,
+        std::vector<link_t>&          links,
+        const std::string&            asset_tag,
+        zhash_t*                      extattributesRO,
+        std::string&                  name);
+
+    /// Number of assets in the current chunk
+    size_t size() const
+    {
+        return _size;
+    }
+
+    /// Writes queued rows and commits the chunk
+    /// @return reply with status 0 if the chunk was rolled back
+    db_reply_t flush();
+
+private:
+    struct ExtAttribute
+    {
+        a_elmnt_id_t id;
+        std::string  keytag;
+        std::string  value;
+        bool         read_only;
+    };
+
+    struct Link
+    {
+        a_elmnt_id_t src;
+        a_elmnt_id_t dest;
+        std::string  src_out;
+        std::string  dest_in;
+        uint16_t     type;
+    };
+
+    void begin();
+    void rollback();
+    void queue_ext_attributes(a_elmnt_id_t id, zhash_t* attributes, bool read_only);
+    void write_ext_attributes();
+    void write_groups();
+    void write_links();
+
+    tntdb::Connection&                                 _conn;
+    bool                                               _active = false;
+    size_t                                             _size   = 0;
+    std::vector<ExtAttribute>                          _ext_attributes;
+    std::vector<std::pair<a_elmnt_id_t, a_elmnt_id_t>> _groups;
+    std::vector<Link>                                  _links;
+};
+
+} // namespace persist
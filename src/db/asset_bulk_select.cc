@@ -0,0 +1,126 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_bulk_select.cc
+ * \brief Names, ext attributes, groups and power links of all assets
+ */
+#include "db/asset_bulk_select.h"
+#include <fty_log.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace persist {
+
+AssetBulkSelect::AssetBulkSelect(tntdb::Connection& conn)
+    : _names(conn)
+{
+    load_ext_attributes(conn);
+    load_groups(conn);
+    load_power_links(conn);
+    log_debug("data of %zu assets loaded (%zu with ext attributes, %zu in groups, %zu powered)", _names.size(),
+        _ext_attributes.size(), _groups.size(), _power_links.size());
+}
+
+void AssetBulkSelect::load_ext_attributes(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, keytag, value, read_only"
+        " FROM"
+        "   t_bios_asset_ext_attributes");
+
+    tntdb::Result result = st.select();
+    _ext_attributes.reserve(_names.size());
+    for (const auto& row : result) {
+        a_elmnt_id_t id = 0;
+        std::string  keytag, value;
+        bool         read_only = false;
+        row[0].get(id);
+        row[1].get(keytag);
+        row[2].get(value);
+        row[3].get(read_only);
+        _ext_attributes[id].emplace(std::move(keytag), std::make_pair(std::move(value), read_only));
+    }
+}
+
+void AssetBulkSelect::load_groups(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, id_asset_group"
+        " FROM"
+        "   t_bios_asset_group_relation");
+
+    for (const auto& row : st.select()) {
+        a_elmnt_id_t id = 0, group_id = 0;
+        row[0].get(id);
+        row[1].get(group_id);
+        _groups[id].push_back(group_id);
+    }
+}
+
+void AssetBulkSelect::load_power_links(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_device_dest, id_asset_device_src, src_out, dest_in"
+        " FROM"
+        "   t_bios_asset_link"
+        " WHERE"
+        "   id_asset_link_type = :type");
+
+    for (const auto& row : st.set("type", INPUT_POWER_CHAIN).select()) {
+        a_elmnt_id_t id = 0;
+        PowerLink    link{0, "", ""};
+        row[0].get(id);
+        row[1].get(link.src);
+        row[2].get(link.src_out);
+        row[3].get(link.dest_in);
+        _power_links[id].push_back(std::move(link));
+    }
+}
+
+const AssetBulkSelect::ExtAttributes& AssetBulkSelect::ext_attributes(a_elmnt_id_t id) const
+{
+    static const ExtAttributes empty;
+
+    auto it = _ext_attributes.find(id);
+    return it == _ext_attributes.end() ? empty : it->second;
+}
+
+const std::vector<a_elmnt_id_t>& AssetBulkSelect::groups(a_elmnt_id_t id) const
+{
+    static const std::vector<a_elmnt_id_t> empty;
+
+    auto it = _groups.find(id);
+    return it == _groups.end() ? empty : it->second;
+}
+
+const std::vector<AssetBulkSelect::PowerLink>& AssetBulkSelect::power_links(a_elmnt_id_t id) const
+{
+    static const std::vector<PowerLink> empty;
+
+    auto it = _power_links.find(id);
+    return it == _power_links.end() ? empty : it->second;
+}
+
+} // namespace persist
@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_bulk_select.h
+/// @brief Names, ext attributes, groups and power links of all assets
+///
+/// How it works
+/// ============
+/// Everything is read by four queries when the object is created (names,
+/// ext attributes, group membership and power links) and indexed by asset
+/// id, so that an export costs a fixed number of round trips instead of
+/// several queries per asset:
+///
+///     persist::AssetBulkSelect all(conn);
+///     for (const auto& attr : all.ext_attributes(id)) {
+///         ...
+///     }
+///
+/// Results are the same as of DBAssets::select_ext_attributes,
+/// DBAssets::select_group_names (by id) and
+/// DBAssets::select_v_web_asset_power_link_src_byId (by id). The object is
+/// a snapshot, create it inside the transaction of the export.
+
+#pragma once
+
+#include "db/asset_names.h"
+#include "dbtypes.h"
+#include <map>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_map>
+#include <vector>
+
+namespace persist {
+
+class AssetBulkSelect
+{
+public:
+    /// keytag -> (value, read_only), as DBAssets::select_ext_attributes
+    using ExtAttributes = std::map<std::string, std::pair<std::string, bool>>;
+
+    struct PowerLink
+    {
+        a_elmnt_id_t src;
+        std::string  src_out;
+        std::string  dest_in;
+    };
+
+    /// Loads data of all assets
+    /// @throws std::exception on database error
+    explicit AssetBulkSelect(tntdb::Connection& conn);
+
+    const AssetNames& names() const
+    {
+        return _names;
+    }
+
+    /// Ext attributes of the asset, empty if there are none
+    const ExtAttributes& ext_attributes(a_elmnt_id_t id) const;
+
+    /// Ids of groups the asset belongs to
+    const std::vector<a_elmnt_id_t>& groups(a_elmnt_id_t id) const;
+
+    /// Power links incoming to the asset
+    const std::vector<PowerLink>& power_links(a_elmnt_id_t id) const;
+
+private:
+    void load_ext_attributes(tntdb::Connection& conn);
+    void load_groups(tntdb::Connection& conn);
+    void load_power_links(tntdb::Connection& conn);
+
+    AssetNames                                                  _names;
+    std::unordered_map<a_elmnt_id_t, ExtAttributes>             _ext_attributes;
+    std::unordered_map<a_elmnt_id_t, std::vector<a_elmnt_id_t>> _groups;
+    std::unordered_map<a_elmnt_id_t, std::vector<PowerLink>>    _power_links;
+};
+
+} // namespace persist
@@ -0,0 +1,246 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_changes.cc
+ * \brief Assets changed or deleted since a given time, for incremental export
+ */
+#include "db/asset_changes.h"
+#include "db/connection_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <stdexcept>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace persist {
+
+static bool s_is_digits(const std::string& s)
+{
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+        return isdigit(static_cast<unsigned char>(c));
+    });
+}
+
+// "Z", "+HH", "+HHMM" or "+HH:MM" -> seconds east of UTC
+static bool s_parse_offset(const char* s, long& offset)
+{
+    if (strcmp(s, "Z") == 0) {
+        offset = 0;
+        return true;
+    }
+    size_t len = strlen(s);
+    if ((s[0] != '+' && s[0] != '-') || (len != 3 && len != 5 && len != 6))
+        return false;
+    std::string digits(s + 1);
+    if (len == 6) {
+        if (digits[2] != ':')
+            return false;
+        digits.erase(2, 1);
+    }
+    if (!s_is_digits(digits))
+        return false;
+    long hours   = std::stol(digits.substr(0, 2));
+    long minutes = digits.size() == 4 ? std::stol(digits.substr(2)) : 0;
+    offset       = (s[0] == '-' ? -1 : 1) * (hours * 3600 + minutes * 60);
+    return true;
+}
+
+bool parse_change_time(const std::string& value, std::time_t& time)
+{
+    if (s_is_digits(value)) {
+        try {
+            time = std::time_t(std::stoll(value));
+            return true;
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* rest = strptime(value.c_str(), "%Y-%m-%dT%H:%M:%S", &tm);
+    if (rest == NULL)
+        return false;
+    if (*rest == '\0') {
+        tm.tm_isdst = -1;
+        time        = mktime(&tm);
+        return time != -1;
+    }
+    long offset = 0;
+    if (!s_parse_offset(rest, offset))
+        return false;
+    time = timegm(&tm) - offset;
+    return true;
+}
+
+std::time_t asset_change_time(const AssetBulkSelect::ExtAttributes& ext_attributes)
+{
+    std::time_t last = 0;
+    for (const char* keytag : {"update_ts", "create_ts"}) {
+        auto        it   = ext_attributes.find(keytag);
+        std::time_t time = 0;
+        if (it != ext_attributes.end() && parse_change_time(it->second.first, time))
+            last = std::max(last, time);
+    }
+    return last;
+}
+
+std::unordered_set<a_elmnt_id_t> select_changed_assets(
+    tntdb::Connection& conn, const AssetBulkSelect& all, std::time_t since)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, id_parent"
+        " FROM"
+        "   t_bios_asset_element");
+
+    std::vector<std::pair<a_elmnt_id_t, a_elmnt_id_t>> parents;
+    std::unordered_set<a_elmnt_id_t>                   changed;
+    for (const auto& row : st.select()) {
+        a_elmnt_id_t id = 0, id_parent = 0;
+        row[0].get(id);
+        row[1].get(id_parent);
+        parents.emplace_back(id, id_parent);
+        if (asset_change_time(all.ext_attributes(id)) >= since)
+            changed.insert(id);
+    }
+
+    // rows of children show the name of the parent, rows of destinations the name of the source
+    std::vector<a_elmnt_id_t> shown;
+    for (const auto& it : parents) {
+        if (changed.count(it.first) > 0)
+            continue;
+        bool show = it.second > 0 && changed.count(it.second) > 0;
+        for (const auto& link : all.power_links(it.first)) {
+            show = show || changed.count(link.src) > 0;
+        }
+        if (show)
+            shown.push_back(it.first);
+    }
+    log_debug("%zu assets changed since %" PRIi64 ", %zu more show their names", changed.size(), int64_t(since),
+        shown.size());
+    changed.insert(shown.begin(), shown.end());
+    return changed;
+}
+
+bool asset_tombstones_cover(std::time_t since)
+{
+    return since >= std::time(NULL) - std::time_t(ASSET_TOMBSTONES_KEEP_DAYS) * 24 * 3600;
+}
+
+bool asset_tombstones_available(tntdb::Connection& conn)
+{
+    // checked until found, the schema may be migrated while we run
+    static std::atomic<bool> available{false};
+    if (available)
+        return true;
+
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   COUNT(*)"
+        " FROM"
+        "   information_schema.tables"
+        " WHERE"
+        "   table_schema = DATABASE() AND table_name = 't_bios_asset_element_tombstone'");
+    unsigned count = 0;
+    st.selectRow()[0].get(count);
+    available = count != 0;
+    return available;
+}
+
+void prepare_asset_tombstones()
+{
+    auto conn = ConnectionPool::instance().acquire();
+    if (!asset_tombstones_available(conn))
+        throw std::runtime_error(TRANSLATE_ME(
+            "Incremental export is not available, table t_bios_asset_element_tombstone is missing in the database"));
+
+    tntdb::Statement st = conn->prepareCached(
+        " DELETE FROM t_bios_asset_element_tombstone"
+        " WHERE deleted_ts < NOW() - INTERVAL :days DAY");
+    unsigned pruned = st.set("days", ASSET_TOMBSTONES_KEEP_DAYS).execute();
+    if (pruned > 0)
+        log_debug("%u asset tombstones older than %d days removed", pruned, ASSET_TOMBSTONES_KEEP_DAYS);
+}
+
+db_reply_t insert_asset_tombstone(tntdb::Connection& conn, a_elmnt_id_t id)
+{
+    db_reply_t ret = db_reply_new();
+    try {
+        if (!asset_tombstones_available(conn)) {
+            log_warning("tombstone of deleted asset %" PRIu32 " was not recorded, the table is missing", id);
+            ret.status = 1;
+            return ret;
+        }
+
+        // the id may be reused by a new asset, which is deleted again
+        tntdb::Statement st = conn.prepareCached(
+            " REPLACE INTO t_bios_asset_element_tombstone"
+            "   (id_asset_element, name, ext_name)"
+            " SELECT"
+            "   e.id_asset_element, e.name, COALESCE(ext.value, e.name)"
+            " FROM"
+            "   t_bios_asset_element e"
+            " LEFT JOIN t_bios_asset_ext_attributes ext"
+            "   ON ext.id_asset_element = e.id_asset_element AND ext.keytag = 'name'"
+            " WHERE"
+            "   e.id_asset_element = :id");
+        ret.affected_rows = st.set("id", id).execute();
+        ret.status        = 1;
+    } catch (const std::exception& e) {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        log_error("tombstone of deleted asset %" PRIu32 " was not recorded: %s", id, e.what());
+    }
+    return ret;
+}
+
+std::vector<AssetTombstone> select_asset_tombstones(tntdb::Connection& conn, std::time_t since)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, name, ext_name"
+        " FROM"
+        "   t_bios_asset_element_tombstone"
+        " WHERE"
+        "   deleted_ts >= FROM_UNIXTIME(:since)"
+        " ORDER BY deleted_ts");
+
+    std::vector<AssetTombstone> tombstones;
+    for (const auto& row : st.set("since", int64_t(since)).select()) {
+        AssetTombstone tombstone;
+        row[0].get(tombstone.id);
+        row[1].get(tombstone.name);
+        row[2].get(tombstone.ext_name);
+        tombstones.push_back(std::move(tombstone));
+    }
+    return tombstones;
+}
+
+} // namespace persist
@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_changes.h
+/// @brief Assets changed or deleted since a given time, for incremental export
+///
+/// How it works
+/// ============
+/// An asset counts as changed when its update_ts (or create_ts) read-only
+/// ext attribute, written by the csv import, is not older than the time
+/// asked for. The export has all ext attributes loaded anyway (see
+/// AssetBulkSelect), so the test needs no extra query. A row of the export
+/// also shows names of other assets, the parent (location) and sources of
+/// power links (power_source.N): children of a changed asset and
+/// destinations of its power links are listed too, a rename of the parent
+/// or of the source shows up in their rows. Only one level is followed, a
+/// grandparent is not shown in the row of an asset.
+///
+/// Changes which do not write update_ts are not seen: assets edited by
+/// other agents or through the REST API of a single asset, and links
+/// created or removed without an update of their destination. Only a full
+/// export shows them.
+///
+/// Deleted assets leave no trace in the asset tables, so delete_device(),
+/// delete_group() and delete_dc_room_row_rack() record a tombstone (id,
+/// internal and user-friendly name) in the same transaction as the delete.
+/// Deletions done outside of these functions (another agent, a script
+/// working on the database) leave no tombstone: an incremental export does
+/// not list them, only a full export shows the assets are gone.
+/// The tombstone table is indexed by the time of deletion, tombstones older
+/// than ASSET_TOMBSTONES_KEEP_DAYS are removed. An incremental export asked
+/// for an older time cannot list all deletions, a full export is needed then.
+///
+/// The table is not created at runtime (DDL would commit the transaction of
+/// the delete), it comes with the migration of the core database schema:
+///
+///     CREATE TABLE t_bios_asset_element_tombstone (
+///         id_asset_element INT UNSIGNED NOT NULL,
+///         name             VARCHAR(50) NOT NULL,
+///         ext_name         VARCHAR(255) NOT NULL,
+///         deleted_ts       TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+///         PRIMARY KEY (id_asset_element),
+///         INDEX I_t_bios_asset_element_tombstone_deleted_ts (deleted_ts)
+///     ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+///
+/// On a database without it, deletions are not recorded and an incremental
+/// export fails with an explicit error.
+
+#pragma once
+
+#include "db/asset_bulk_select.h"
+#include "db/dbhelpers.h"
+#include "dbtypes.h"
+#include <ctime>
+#include <fty_common_db_defs.h>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_set>
+#include <vector>
+
+// how long deletions of assets are remembered for incremental export
+#define ASSET_TOMBSTONES_KEEP_DAYS 30
+
+namespace persist {
+
+struct AssetTombstone
+{
+    a_elmnt_id_t id = 0;
+    std::string  name;
+    std::string  ext_name;
+};
+
+/// Parses the time of an incremental export
+///
+/// Accepts seconds since the epoch or the format of update_ts
+/// ("2020-01-31T12:00:00+0100"). The offset may be written as "+01:00" or
+/// "Z", the time is local if there is none.
+///
+/// @return false if the value is not a valid time
+bool parse_change_time(const std::string& value, std::time_t& time);
+
+/// Time of the last change of an asset, from its update_ts or create_ts
+/// @return 0 if the asset has none of them
+std::time_t asset_change_time(const AssetBulkSelect::ExtAttributes& ext_attributes);
+
+/// Ids of assets changed since the time, for an incremental export
+///
+/// Assets whose asset_change_time() is not older than since, their children
+/// and destinations of their power links.
+///
+/// @param[in] conn - connection with the transaction of the export
+/// @param[in] all  - data of all assets, read in the same transaction
+/// @throws std::exception on database error
+std::unordered_set<a_elmnt_id_t> select_changed_assets(
+    tntdb::Connection& conn, const AssetBulkSelect& all, std::time_t since);
+
+/// @return true if tombstones of all assets deleted since the time are kept
+bool asset_tombstones_cover(std::time_t since);
+
+/// @return true if the database has the tombstone table
+/// @throws std::exception on database error
+bool asset_tombstones_available(tntdb::Connection& conn);
+
+/// Removes old tombstones, call it before the transaction of an incremental export
+///
+/// @throws std::runtime_error if the tombstone table is missing
+/// @throws std::exception on database error
+void prepare_asset_tombstones();
+
+/// Records the deletion of the asset, call it before the element is deleted
+///
+/// Only deletions done by this process (delete_device(), delete_group(),
+/// delete_dc_room_row_rack()) are recorded. Assets deleted by other
+/// processes or by hand in the database are not seen by an incremental
+/// export.
+///
+/// @param[in] conn - connection with the transaction deleting the asset
+/// @return status 0 on failure, the caller rolls the delete back then
+db_reply_t insert_asset_tombstone(tntdb::Connection& conn, a_elmnt_id_t id);
+
+/// Assets deleted since the time, oldest first
+/// @throws std::exception on database error
+std::vector<AssetTombstone> select_asset_tombstones(tntdb::Connection& conn, std::time_t since);
+
+} // namespace persist
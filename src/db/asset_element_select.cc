@@ -0,0 +1,243 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_element_select.cc
+ * \brief Complete web elements of several assets in one round trip
+ */
+#include "db/asset_element_select.h"
+#include <algorithm>
+#include <fty_common_asset_types.h>
+#include <fty_log.h>
+#include <set>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace persist {
+
+// ids bound to one execution of the statement
+static constexpr size_t BATCH_SIZE = 64;
+
+// first column of every row, part of the statement the row comes from
+enum Part
+{
+    BASIC  = 0,
+    EXT    = 1,
+    GROUP  = 2,
+    POWER  = 3,
+    PARENT = 4
+};
+
+static const std::string& s_sql()
+{
+    static const std::string sql = [] {
+        std::string in = "(";
+        for (size_t i = 0; i != BATCH_SIZE; ++i) {
+            in += (i == 0 ? ":i" : ", :i") + std::to_string(i);
+        }
+        in += ")";
+
+        const std::string parents =
+            "sp.id_parent1, sp.id_parent2, sp.id_parent3, sp.id_parent4, sp.id_parent5,"
+            " sp.id_parent6, sp.id_parent7, sp.id_parent8, sp.id_parent9, sp.id_parent10";
+
+        // columns: part, id, 4 numbers, 5 strings, parent type and name (of BASIC rows)
+        return " SELECT"
+               "   0, v.id, v.priority, v.id_type, v.id_parent, v.subtype_id,"
+               "   v.name, v.status, v.asset_tag, v.type_name, v.subtype_name,"
+               "   v.id_parent_type, v.parent_name"
+               " FROM"
+               "   v_web_element v"
+               " WHERE"
+               "   v.id IN " +
+               in +
+               " UNION ALL"
+               " SELECT"
+               "   1, a.id_asset_element, a.read_only, NULL, NULL, NULL,"
+               "   a.keytag, a.value, NULL, NULL, NULL, NULL, NULL"
+               " FROM"
+               "   t_bios_asset_ext_attributes a"
+               " WHERE"
+               "   a.id_asset_element IN " +
+               in +
+               " UNION ALL"
+               " SELECT"
+               "   2, r.id_asset_element, r.id_asset_group, NULL, NULL, NULL,"
+               "   g.name, NULL, NULL, NULL, NULL, NULL, NULL"
+               " FROM"
+               "   t_bios_asset_group_relation r"
+               " JOIN t_bios_asset_element g"
+               "   ON g.id_asset_element = r.id_asset_group"
+               " WHERE"
+               "   r.id_asset_element IN " +
+               in +
+               " UNION ALL"
+               " SELECT"
+               "   3, l.id_asset_device_dest, l.id_asset_device_src, NULL, NULL, NULL,"
+               "   s.name, l.src_out, l.dest_in, NULL, NULL, NULL, NULL"
+               " FROM"
+               "   t_bios_asset_link l"
+               " JOIN t_bios_asset_element s"
+               "   ON s.id_asset_element = l.id_asset_device_src"
+               " WHERE"
+               "   l.id_asset_link_type = :linktype AND"
+               "   l.id_asset_device_dest IN " +
+               in +
+               " UNION ALL"
+               " SELECT"
+               "   4, sp.id_asset_element, p.id_asset_element, p.id_type, p.id_subtype,"
+               "   FIELD(p.id_asset_element, " +
+               parents +
+               "),"
+               "   p.name, NULL, NULL, NULL, NULL, NULL, NULL"
+               " FROM"
+               "   v_bios_asset_element_super_parent sp"
+               " JOIN t_bios_asset_element p"
+               "   ON p.id_asset_element IN (" +
+               parents +
+               ")"
+               " WHERE"
+               "   sp.id_asset_element IN " +
+               in;
+    }();
+    return sql;
+}
+
+std::map<a_elmnt_id_t, db_web_element_t> select_web_elements(
+    tntdb::Connection& conn, const std::vector<a_elmnt_id_t>& ids)
+{
+    using Parent = std::tuple<a_elmnt_id_t, std::string, std::string, std::string>;
+
+    std::set<a_elmnt_id_t>                                      unique(ids.begin(), ids.end());
+    std::vector<a_elmnt_id_t>                                   todo(unique.begin(), unique.end());
+    std::map<a_elmnt_id_t, db_web_element_t>                    elements;
+    std::set<a_elmnt_id_t>                                      found;
+    std::map<a_elmnt_id_t, std::vector<std::pair<int, Parent>>> parents;
+
+    tntdb::Statement st = conn.prepareCached(s_sql());
+    for (size_t start = 0; start < todo.size(); start += BATCH_SIZE) {
+        st.set("linktype", INPUT_POWER_CHAIN);
+        for (size_t i = 0; i != BATCH_SIZE; ++i) {
+            // there is no asset with id 0
+            st.set("i" + std::to_string(i), start + i < todo.size() ? todo[start + i] : a_elmnt_id_t(0));
+        }
+
+        for (const auto& row : st.select()) {
+            int          part = -1;
+            a_elmnt_id_t id   = 0;
+            row[0].get(part);
+            row[1].get(id);
+            db_web_element_t& element = elements[id];
+
+            switch (part) {
+                case BASIC: {
+                    db_web_basic_element_t& basic = element.basic;
+                    basic.id                      = id;
+                    row[2].get(basic.priority);
+                    row[3].get(basic.type_id);
+                    row[4].get(basic.parent_id);
+                    row[5].get(basic.subtype_id);
+                    row[6].get(basic.name);
+                    row[7].get(basic.status);
+                    row[8].get(basic.asset_tag);
+                    row[9].get(basic.type_name);
+                    row[10].get(basic.subtype_name);
+                    row[11].get(basic.parent_type_id);
+                    row[12].get(basic.parent_name);
+                    found.insert(id);
+                    break;
+                }
+                case EXT: {
+                    bool        read_only = false;
+                    std::string keytag, value;
+                    row[2].get(read_only);
+                    row[6].get(keytag);
+                    row[7].get(value);
+                    element.ext.emplace(std::move(keytag), std::make_pair(std::move(value), read_only));
+                    break;
+                }
+                case GROUP: {
+                    a_elmnt_id_t group_id = 0;
+                    std::string  name;
+                    row[2].get(group_id);
+                    row[6].get(name);
+                    element.groups.emplace(group_id, std::move(name));
+                    break;
+                }
+                case POWER: {
+                    db_tmp_link_t link{};
+                    link.dest_id = id;
+                    row[2].get(link.src_id);
+                    row[6].get(link.src_name);
+                    row[7].get(link.src_socket);
+                    row[8].get(link.dest_socket);
+                    element.powers.push_back(std::move(link));
+                    break;
+                }
+                case PARENT: {
+                    a_elmnt_id_t     parent_id  = 0;
+                    a_elmnt_tp_id_t  type_id    = 0;
+                    a_elmnt_stp_id_t subtype_id = 0;
+                    int              position   = 0;
+                    std::string      name;
+                    row[2].get(parent_id);
+                    row[3].get(type_id);
+                    row[4].get(subtype_id);
+                    row[5].get(position);
+                    row[6].get(name);
+                    parents[id].emplace_back(position, std::make_tuple(parent_id, std::move(name),
+                        persist::typeid_to_type(type_id), persist::subtypeid_to_subtype(subtype_id)));
+                    break;
+                }
+                default:
+                    log_error("unexpected part %d of web element select", part);
+            }
+        }
+    }
+
+    for (auto it = elements.begin(); it != elements.end();) {
+        if (!found.count(it->first)) {
+            // rows of an asset deleted in the meantime
+            it = elements.erase(it);
+            continue;
+        }
+        db_web_element_t& element = it->second;
+        if (element.basic.type_id != persist::asset_type::DEVICE) {
+            // power links are reported for devices only
+            element.powers.clear();
+        }
+        auto& list = parents[it->first];
+        std::sort(list.begin(), list.end(), [](const std::pair<int, Parent>& l, const std::pair<int, Parent>& r) {
+            return l.first < r.first;
+        });
+        for (auto& parent : list) {
+            if (!std::get<1>(parent.second).empty()) {
+                element.parents.push_back(std::move(parent.second));
+            }
+        }
+        ++it;
+    }
+
+    log_debug("%zu of %zu web elements selected", elements.size(), todo.size());
+    return elements;
+}
+
+} // namespace persist
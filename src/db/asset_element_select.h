@@ -0,0 +1,60 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_element_select.h
+/// @brief Complete web elements of several assets in one round trip
+///
+/// How it works
+/// ============
+/// asset_manager::get_item1 used to run five queries one after another
+/// (basic info, ext attributes, groups, power links and parents). Here all
+/// of them are parts of one UNION ALL statement: every row starts with the
+/// kind of data it carries and the id of the asset it belongs to, the rest
+/// of the columns are shared by the parts (unused ones are NULL).
+///
+/// Parents are unpivoted from v_bios_asset_element_super_parent by a join
+/// on the ten parent columns, their order is restored from FIELD().
+///
+/// Ids are bound to a fixed number of placeholders, so that the statement
+/// text does not depend on the number of assets and stays in the statement
+/// cache of the connection; larger requests take one execution per batch.
+
+#pragma once
+
+#include "dbtypes.h"
+#include <fty_common_db_asset.h>
+#include <map>
+#include <tntdb/connection.h>
+#include <vector>
+
+namespace persist {
+
+/// Select basic info, ext attributes, groups, power links (devices only)
+/// and parents of the given assets
+///
+/// Results are the same as of the separate DBAssets selects used by
+/// asset_manager::get_item1.
+///
+/// @return id -> element, assets which do not exist are missing
+/// @throws std::exception on database error
+std::map<a_elmnt_id_t, db_web_element_t> select_web_elements(
+    tntdb::Connection& conn, const std::vector<a_elmnt_id_t>& ids);
+
+} // namespace persist
@@ -18,6 +18,7 @@
  *
  */
 
+#include "db/asset_changes.h"
 #include "dbtypes.h"
 #include "shared/ic.h"
 #include "shared/utilspp.h"
@@ -35,6 +36,41 @@ namespace persist {
 
 static const char* ENV_OVERRIDE_LAST_DC_DELETION_CHECK = "FTY_OVERRIDE_LAST_DC_DELETION_CHECK";
 
+//=============================================================================
+db_reply_t check_new_asset(
+    const char*     element_name,
+    a_elmnt_tp_id_t element_type_id,
+    a_dvc_tp_id_t   asset_device_type_id,
+    const char*     status,
+    bool            check_name,
+    std::string&    iname)
+{
+    db_reply_t ret = db_reply_new();
+    ret.status     = 0;
+    ret.errtype    = DB_ERR;
+    ret.errsubtype = DB_ERROR_BADINPUT;
+    ret.rowid      = 8;
+
+    if (check_name && DBAssets::extname_to_asset_id(element_name) != -1) {
+        ret.msg = TRANSLATE_ME(
+            "Element '%s' cannot be processed because of conflict. Most likely duplicate entry.", element_name);
+        return ret;
+    }
+    bool is_device = element_type_id == asset_type::DEVICE;
+    setlocale(LC_ALL, ""); // move this to main?
+    iname = utils::strip(
+        is_device ? persist::subtypeid_to_subtype(asset_device_type_id) : persist::typeid_to_type(element_type_id));
+    log_debug("  element_name = '%s/%s'", element_name, iname.c_str());
+
+    if (!is_device && streq(status, "nonactive")) {
+        ret.msg = TRANSLATE_ME("Element '%s' cannot be inactivated. Change status to 'active'.", element_name);
+        return ret;
+    }
+    ret.status = 1;
+    ret.rowid  = 0;
+    return ret;
+}
+
 //=============================================================================
 // transaction is used
 int update_dc_room_row_rack_group(
@@ -243,28 +279,10 @@ db_reply_t insert_dc_room_row_rack_group(
     zhash_t*                      extattributesRO)
 {
     LOG_START;
-    if (DBAssets::extname_to_asset_id(element_name) != -1) {
-        db_reply_t ret;
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_BADINPUT;
-        ret.rowid      = 8;
-        ret.msg        = TRANSLATE_ME(
-            "Element '%s' cannot be processed because of conflict. Most likely duplicate entry.", element_name);
-        return ret;
-    }
-    setlocale(LC_ALL, ""); // move this to main?
-    std::string iname = utils::strip(persist::typeid_to_type(element_type_id));
-    log_debug("  element_name = '%s/%s'", element_name, iname.c_str());
-
-    if (streq(status, "nonactive")) {
-        db_reply_t ret;
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_BADINPUT;
-        ret.rowid      = 8;
-        ret.msg        = TRANSLATE_ME("Element '%s' cannot be inactivated. Change status to 'active'.", element_name);
-        return ret;
+    std::string iname;
+    auto        reply_check = check_new_asset(element_name, element_type_id, 0, status, true, iname);
+    if (reply_check.status == 0) {
+        return reply_check;
     }
 
     tntdb::Transaction trans(conn);
@@ -351,19 +369,12 @@ db_reply_t insert_device(
     zhash_t*           extattributesRO)
 {
     LOG_START;
-    if (DBAssets::extname_to_asset_id(element_name) != -1) {
-        db_reply_t ret;
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_BADINPUT;
-        ret.rowid      = 8;
-        ret.msg        = TRANSLATE_ME(
-            "Element '%s' cannot be processed because of conflict. Most likely duplicate entry.", element_name);
-        return ret;
+    std::string iname;
+    auto        reply_check =
+        check_new_asset(element_name, asset_type::DEVICE, asset_device_type_id, status, true, iname);
+    if (reply_check.status == 0) {
+        return reply_check;
     }
-    setlocale(LC_ALL, ""); // move this to main?
-    std::string iname = utils::strip(persist::subtypeid_to_subtype(asset_device_type_id));
-    log_debug("  element_name = '%s/%s'", element_name, iname.c_str());
 
     auto reply_insert1 = DBAssetsInsert::insert_into_asset_element(
         conn, iname.c_str(), asset_type::DEVICE, parent_id, status, priority, asset_device_type_id, asset_tag.c_str(),
@@ -511,6 +522,14 @@ db_reply_t delete_dc_room_row_rack(tntdb::Connection& conn, a_elmnt_id_t element
         return reply_delete3;
     }
 
+    auto reply_tombstone = insert_asset_tombstone(conn, element_id);
+    if (reply_tombstone.status == 0) {
+        trans.rollback();
+        log_info("end: error occured during recording the deletion");
+        reply_tombstone.msg = JSONIFY(reply_tombstone.msg.c_str());
+        return reply_tombstone;
+    }
+
     auto reply_delete4 = DBAssetsDelete::delete_asset_element(conn, element_id);
     if (reply_delete4.status == 0) {
         trans.rollback();
@@ -539,6 +558,14 @@ db_reply_t delete_group(tntdb::Connection& conn, a_elmnt_id_t element_id)
         return reply_delete2;
     }
 
+    auto reply_tombstone = insert_asset_tombstone(conn, element_id);
+    if (reply_tombstone.status == 0) {
+        trans.rollback();
+        log_info("end: error occured during recording the deletion");
+        reply_tombstone.msg = JSONIFY(reply_tombstone.msg.c_str());
+        return reply_tombstone;
+    }
+
     auto reply_delete3 = DBAssetsDelete::delete_asset_element(conn, element_id);
     if (reply_delete3.status == 0) {
         trans.rollback();
@@ -583,6 +610,14 @@ db_reply_t delete_device(tntdb::Connection& conn, a_elmnt_id_t element_id, const
         return reply_delete5;
     }
 
+    auto reply_tombstone = insert_asset_tombstone(conn, element_id);
+    if (reply_tombstone.status == 0) {
+        trans.rollback();
+        log_info("end: error occured during recording the deletion");
+        reply_tombstone.msg = JSONIFY(reply_tombstone.msg.c_str());
+        return reply_tombstone;
+    }
+
     auto reply_delete6 = DBAssetsDelete::delete_asset_element(conn, element_id);
     if (reply_delete6.status == 0) {
         trans.rollback();
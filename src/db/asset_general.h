@@ -33,6 +33,24 @@
 
 namespace persist {
 
+/// Checks a new asset before insert, shared by insert_device(),
+/// insert_dc_room_row_rack_group() and AssetBulkInsert::insert()
+///
+/// Elements other than devices cannot be inactive. Uniqueness of the ext
+/// name is checked only if check_name is set (the bulk insert leaves it to
+/// its caller).
+///
+/// @param[out] iname - type, or subtype of a device, the internal name is derived from
+/// @return reply with status 0 and the error if the asset cannot be inserted
+db_reply_t check_new_asset(
+    const char*     element_name,
+    a_elmnt_tp_id_t element_type_id,
+    a_dvc_tp_id_t   asset_device_type_id,
+    const char*     status,
+    bool            check_name,
+    std::string&    iname);
+
+
 int update_dc_room_row_rack_group(
     tntdb::Connection&            conn,
     a_elmnt_id_t                  element_id,
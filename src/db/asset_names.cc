@@ -0,0 +1,157 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_names.cc
+ * \brief In-memory map of asset id, internal name and ext name
+ */
+#include "db/asset_names.h"
+#include <fty_log.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace persist {
+
+std::string AssetNames::fold(const std::string& name)
+{
+    std::string key;
+    key.reserve(name.size());
+    for (size_t i = 0; i < name.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        if (c >= 'A' && c <= 'Z') {
+            key += char(c - 'A' + 'a');
+        } else if (c == 0xC3 && i + 1 < name.size()) {
+            // U+00C0..U+00DE, but U+00D7 (multiplication sign), are upper case Latin-1 letters
+            unsigned char next = static_cast<unsigned char>(name[++i]);
+            key += char(c);
+            key += char(next >= 0x80 && next <= 0x9E && next != 0x97 ? next + 0x20 : next);
+        } else {
+            key += char(c);
+        }
+    }
+    key.erase(key.find_last_not_of(' ') + 1);
+    return key;
+}
+
+AssetNames::AssetNames(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   v.id, v.name, ext.value"
+        " FROM"
+        "   v_bios_asset_element v"
+        " LEFT JOIN"
+        "   v_bios_asset_ext_attributes ext"
+        " ON"
+        "   ext.id_asset_element = v.id AND ext.keytag = 'name'");
+
+    tntdb::Result result = st.select();
+    _byId.reserve(result.size());
+    _byName.reserve(result.size());
+    _byExtName.reserve(result.size());
+    for (const auto& row : result) {
+        a_elmnt_id_t id = 0;
+        std::string  name, ext_name;
+        row[0].get(id);
+        row[1].get(name);
+        row[2].get(ext_name);
+        set(id, name, ext_name);
+    }
+    log_debug("names of %zu assets loaded", _byId.size());
+}
+
+int AssetNames::extname_to_name(const std::string& ext_name, std::string& name) const
+{
+    auto it = _byExtName.find(fold(ext_name));
+    if (it == _byExtName.end()) {
+        return -1;
+    }
+    name = _byId.at(it->second).name;
+    return 0;
+}
+
+int AssetNames::name_to_extname(const std::string& name, std::string& ext_name) const
+{
+    auto it = _byName.find(fold(name));
+    if (it == _byName.end()) {
+        return -1;
+    }
+    ext_name = _byId.at(it->second).ext_name;
+    return 0;
+}
+
+bool AssetNames::id_to_names(a_elmnt_id_t id, std::string& name, std::string& ext_name) const
+{
+    auto it = _byId.find(id);
+    if (it == _byId.end()) {
+        return false;
+    }
+    name     = it->second.name;
+    ext_name = it->second.ext_name;
+    return true;
+}
+
+int64_t AssetNames::name_to_id(const std::string& name) const
+{
+    auto it = _byName.find(fold(name));
+    return it == _byName.end() ? -1 : int64_t(it->second);
+}
+
+int64_t AssetNames::find(const std::string& name) const
+{
+    int64_t id = name_to_id(name);
+    if (id == -1) {
+        auto it = _byExtName.find(fold(name));
+        if (it != _byExtName.end()) {
+            id = int64_t(it->second);
+        }
+    }
+    return id;
+}
+
+void AssetNames::set(a_elmnt_id_t id, const std::string& name, const std::string& ext_name)
+{
+    erase(id);
+    _byId[id]           = Names{name, ext_name};
+    _byName[fold(name)] = id;
+    if (!ext_name.empty()) {
+        _byExtName[fold(ext_name)] = id;
+    }
+}
+
+void AssetNames::erase(a_elmnt_id_t id)
+{
+    auto it = _byId.find(id);
+    if (it == _byId.end()) {
+        return;
+    }
+    auto name = _byName.find(fold(it->second.name));
+    if (name != _byName.end() && name->second == id) {
+        _byName.erase(name);
+    }
+    auto ext = _byExtName.find(fold(it->second.ext_name));
+    if (ext != _byExtName.end() && ext->second == id) {
+        _byExtName.erase(ext);
+    }
+    _byId.erase(it);
+}
+
+} // namespace persist
@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_names.h
+/// @brief In-memory map of asset id, internal name and ext name
+///
+/// How it works
+/// ============
+/// All names are read by one query when the object is created. The owner
+/// keeps it up to date with set() and erase() while it writes assets, so
+/// lookups never go to the database. It is meant to live for one import
+/// or export, it is not shared and not thread safe.
+///
+/// Names are compared as by the default collation of the database, which
+/// is case insensitive and ignores trailing spaces: maps are keyed by the
+/// folded name (ASCII and Latin-1 letters lowered, trailing spaces
+/// removed). Letters differing by their accent only are equal for the
+/// database but not here, an insert of such a duplicate fails in the
+/// database instead.
+
+#pragma once
+
+#include "dbtypes.h"
+#include <cstdint>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_map>
+
+namespace persist {
+
+class AssetNames
+{
+public:
+    /// Loads names of all assets
+    /// @throws std::exception on database error
+    explicit AssetNames(tntdb::Connection& conn);
+
+    /// Internal name of the asset with the ext name, as DBAssets::extname_to_asset_name
+    /// @return 0 if found, -1 otherwise
+    int extname_to_name(const std::string& ext_name, std::string& name) const;
+
+    /// Ext name of the asset with the internal name, as DBAssets::name_to_extname
+    /// @return 0 if found, -1 otherwise
+    int name_to_extname(const std::string& name, std::string& ext_name) const;
+
+    /// Names of the asset with the id, as DBAssets::id_to_name_ext_name
+    /// @return false if not found
+    bool id_to_names(a_elmnt_id_t id, std::string& name, std::string& ext_name) const;
+
+    /// Id of the asset with the internal name, as DBAssets::name_to_asset_id
+    /// @return -1 if not found
+    int64_t name_to_id(const std::string& name) const;
+
+    /// Id of the asset with the internal name or, if there is none, with the ext name,
+    /// as select_asset_element_by_name
+    /// @return -1 if not found
+    int64_t find(const std::string& name) const;
+
+    /// Adds the asset or updates its names
+    void set(a_elmnt_id_t id, const std::string& name, const std::string& ext_name);
+
+    /// Removes the asset
+    void erase(a_elmnt_id_t id);
+
+    size_t size() const
+    {
+        return _byId.size();
+    }
+
+private:
+    struct Names
+    {
+        std::string name;
+        std::string ext_name;
+    };
+
+    /// Key of the name in _byName and _byExtName
+    static std::string fold(const std::string& name);
+
+    std::unordered_map<a_elmnt_id_t, Names>       _byId;
+    std::unordered_map<std::string, a_elmnt_id_t> _byName;
+    std::unordered_map<std::string, a_elmnt_id_t> _byExtName;
+};
+
+} // namespace persist
@@ -0,0 +1,254 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file connection_pool.cc
+ * \brief Bounded pool of database connections shared by web pages and helpers
+ */
+#include "db/connection_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <fty_common_db_dbpath.h>
+#include <fty_log.h>
+#include <tntdb/error.h>
+
+namespace persist {
+
+// waits longer than this are worth a warning, the pool is probably too small
+static constexpr std::chrono::milliseconds SLOW_WAIT{1000};
+
+// ids of slots of all pools, a worker remembers its last slot by id
+static std::atomic<uint64_t> s_slotIds{0};
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool, Slot* slot)
+    : _pool(pool)
+    , _slot(slot)
+{
+}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : _pool(other._pool)
+    , _slot(other._slot)
+{
+    other._slot = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        _pool       = other._pool;
+        _slot       = other._slot;
+        other._slot = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+tntdb::Connection& ConnectionPool::Lease::operator*() const
+{
+    return _slot->conn;
+}
+
+tntdb::Connection* ConnectionPool::Lease::operator->() const
+{
+    return &_slot->conn;
+}
+
+ConnectionPool::Lease::operator tntdb::Connection&() const
+{
+    return _slot->conn;
+}
+
+void ConnectionPool::Lease::release()
+{
+    if (_slot) {
+        _pool->release(_slot);
+        _slot = nullptr;
+    }
+}
+
+ConnectionPool& ConnectionPool::instance()
+{
+    static ConnectionPool pool;
+    return pool;
+}
+
+ConnectionPool::ConnectionPool(size_t maxSize)
+    : _maxSize(std::max<size_t>(maxSize, 1))
+{
+}
+
+ConnectionPool::Lease ConnectionPool::acquire()
+{
+    Slot* slot;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        slot = take(lock);
+    }
+
+    try {
+        prepare(slot);
+    } catch (...) {
+        release(slot);
+        throw;
+    }
+    return Lease(this, slot);
+}
+
+ConnectionPool::Slot* ConnectionPool::take(std::unique_lock<std::mutex>& lock)
+{
+    // connection used last time by this worker, its statement cache is warm
+    static thread_local uint64_t t_last = 0;
+
+    auto me       = std::this_thread::get_id();
+    auto start    = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(CONNECTION_POOL_WAIT_TIMEOUT_MS);
+    bool nested   = std::any_of(_slots.begin(), _slots.end(), [&](const std::unique_ptr<Slot>& s) {
+        return s->busy && s->owner == me;
+    });
+    bool waited   = false;
+
+    for (;;) {
+        Slot* found = nullptr;
+        for (const auto& slot : _slots) {
+            if (slot->busy) {
+                continue;
+            }
+            if (slot->id == t_last) {
+                found = slot.get();
+                break;
+            }
+            // prefer open connections to the ones which failed to connect
+            if (!found || (found->url.empty() && !slot->url.empty())) {
+                found = slot.get();
+            }
+        }
+
+        if (!found && (_slots.size() < _maxSize || nested)) {
+            if (_slots.size() >= _maxSize) {
+                ++_stats.overflow;
+            }
+            _slots.push_back(std::make_unique<Slot>());
+            found     = _slots.back().get();
+            found->id = ++s_slotIds;
+        }
+
+        if (found) {
+            found->busy  = true;
+            found->owner = me;
+            t_last       = found->id;
+            ++_stats.acquired;
+            if (waited) {
+                auto waitTime = std::chrono::steady_clock::now() - start;
+                auto us       = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(waitTime).count());
+                _stats.wait_us += us;
+                _stats.wait_max_us = std::max(_stats.wait_max_us, us);
+                if (waitTime > SLOW_WAIT) {
+                    log_warning("waited %" PRIu64 " ms for a database connection", us / 1000);
+                } else {
+                    log_debug("waited %" PRIu64 " us for a database connection", us);
+                }
+            }
+            return found;
+        }
+
+        if (!waited) {
+            waited = true;
+            ++_stats.waited;
+        }
+        if (_released.wait_until(lock, deadline) == std::cv_status::timeout) {
+            ++_stats.timeouts;
+            log_error("no database connection got free in %d ms (%zu busy)", CONNECTION_POOL_WAIT_TIMEOUT_MS,
+                _slots.size());
+            throw tntdb::Error("no free database connection");
+        }
+    }
+}
+
+void ConnectionPool::prepare(Slot* slot)
+{
+    // slot is leased, so it is accessed by this thread only
+    std::string url = DBConn::url;
+    bool        reconnect;
+
+    if (slot->url.empty()) {
+        reconnect = false;
+    } else if (slot->url != url) {
+        log_debug("database url changed, reconnecting");
+        reconnect = true;
+    } else if (
+        std::chrono::steady_clock::now() - slot->lastUsed > std::chrono::milliseconds(CONNECTION_POOL_PING_IDLE_MS) &&
+        !slot->conn.ping()) {
+        log_warning("database connection lost, reconnecting");
+        reconnect = true;
+    } else {
+        return;
+    }
+
+    slot->url.clear();
+    slot->conn = tntdb::Connection();
+    slot->conn = tntdb::connect(url);
+    slot->url  = url;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.opened;
+    if (reconnect) {
+        ++_stats.reconnected;
+    }
+}
+
+void ConnectionPool::release(Slot* slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        slot->busy     = false;
+        slot->owner    = std::thread::id();
+        slot->lastUsed = std::chrono::steady_clock::now();
+
+        // connections opened over the bound for nested leases are not kept
+        if (_slots.size() > _maxSize) {
+            _slots.erase(std::find_if(_slots.begin(), _slots.end(), [&](const std::unique_ptr<Slot>& s) {
+                return s.get() == slot;
+            }));
+        }
+    }
+    _released.notify_one();
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats ret = _stats;
+    ret.size  = _slots.size();
+    for (const auto& slot : _slots) {
+        if (slot->busy) {
+            ++ret.busy;
+        }
+    }
+    return ret;
+}
+
+} // namespace persist
@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file connection_pool.h
+/// @brief Bounded pool of database connections shared by web pages and helpers
+///
+/// How it works
+/// ============
+/// acquire() hands out a lease on an open connection, the connection goes
+/// back to the pool when the lease is destroyed:
+///
+///     auto conn = persist::ConnectionPool::instance().acquire();
+///     auto ret  = DBAssets::select_asset_element_web_byId(conn, id);
+///
+/// A worker thread gets the connection it used last time when it is free,
+/// so that prepared statements cached in the connection are reused. Other
+/// free connections are taken next and new ones are opened while the pool
+/// is smaller than its bound. When all connections are busy, the caller
+/// waits for one; a thread which already holds a lease never waits (that
+/// would deadlock on nested helpers), it gets an extra connection.
+///
+/// A connection which was idle for a while is pinged before it is handed
+/// out and reopened if the ping fails. Connections are reopened as well
+/// when DBConn::url changes (e.g. after the database password was set).
+///
+/// Long-lived connections (the SSE stream) are not taken from the pool.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tntdb/connection.h>
+#include <thread>
+#include <vector>
+
+/// Upper bound of pooled connections
+#define CONNECTION_POOL_SIZE 16
+/// How long acquire() waits for a free connection before it throws
+#define CONNECTION_POOL_WAIT_TIMEOUT_MS 10000
+/// Connections idle for longer than this are pinged before use
+#define CONNECTION_POOL_PING_IDLE_MS 5000
+
+namespace persist {
+
+class ConnectionPool
+{
+    struct Slot;
+
+public:
+    /// Connection borrowed from the pool, usable where tntdb::Connection& is expected
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        tntdb::Connection& operator*() const;
+        tntdb::Connection* operator->() const;
+        operator tntdb::Connection&() const;
+
+        explicit operator bool() const
+        {
+            return _slot != nullptr;
+        }
+
+        /// Give the connection back before the lease goes out of scope
+        void release();
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, Slot* slot);
+
+        ConnectionPool* _pool = nullptr;
+        Slot*           _slot = nullptr;
+    };
+
+    struct Stats
+    {
+        uint64_t acquired    = 0; ///< leases handed out
+        uint64_t waited      = 0; ///< leases which had to wait for a free connection
+        uint64_t timeouts    = 0; ///< acquire() calls which gave up waiting
+        uint64_t opened      = 0; ///< connections opened (including reconnects)
+        uint64_t reconnected = 0; ///< connections reopened after a failed ping or url change
+        uint64_t overflow    = 0; ///< connections opened over the bound for nested leases
+        uint64_t wait_us     = 0; ///< total time spent waiting
+        uint64_t wait_max_us = 0; ///< longest wait
+        size_t   size        = 0; ///< connections in the pool
+        size_t   busy        = 0; ///< connections leased right now
+    };
+
+    static ConnectionPool& instance();
+
+    explicit ConnectionPool(size_t maxSize = CONNECTION_POOL_SIZE);
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /// Borrow a connection to DBConn::url
+    /// @throws tntdb::Error when no connection got free in time or when
+    ///         the connection cannot be opened
+    Lease acquire();
+
+    Stats stats() const;
+
+private:
+    struct Slot
+    {
+        tntdb::Connection                     conn;
+        std::string                           url; ///< empty while not connected
+        std::chrono::steady_clock::time_point lastUsed;
+        std::thread::id                       owner;
+        uint64_t                              id   = 0; ///< never reused, unlike the address of an erased slot
+        bool                                  busy = false;
+    };
+
+    Slot* take(std::unique_lock<std::mutex>& lock);
+    void  prepare(Slot* slot);
+    void  release(Slot* slot);
+
+    mutable std::mutex                 _mutex;
+    std::condition_variable            _released;
+    std::vector<std::unique_ptr<Slot>> _slots;
+    size_t                             _maxSize;
+    Stats                              _stats;
+};
+
+using PooledConnection = ConnectionPool::Lease;
+
+} // namespace persist
@@ -0,0 +1,163 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file import_jobs.h
+/// @brief Csv import running as a background job
+///
+/// How it works
+/// ============
+/// start() only stores the csv and queues the job, the caller gets the job
+/// id back immediately. The queue is bounded: start() refuses a job when
+/// IMPORT_JOBS_MAX_QUEUED jobs are already waiting or when the waiting csv
+/// documents would take more than IMPORT_JOBS_MAX_QUEUED_BYTES (a single
+/// document is always accepted into an empty queue). A small pool of worker
+/// threads (started with the first job) runs load_asset_csv() on the queued
+/// jobs. Its touch callback, called after every row, refreshes the progress
+/// of the job: rows done, rows failed so far and an ETA derived from the
+/// rate since the start.
+///
+/// Progress can be polled by status(). Each worker also publishes it on the
+/// malamute SSE stream (topic "asset-import"), at most once per second and
+/// once more when the job ends, so sse clients get it without polling.
+/// If malamute is not reachable, only polling is available.
+///
+/// load_asset_csv() only writes to the database. When it is done, the
+/// imported assets are published on the ASSETS stream by send_configure(),
+/// as the synchronous import does, by IMPORT_JOBS_PUBLISH_BATCH rows. A
+/// failure of the publishing is reported in the status of the job.
+///
+/// Finished jobs (with their per-row errors) are kept for a while, the oldest
+/// are forgotten once there are more than IMPORT_JOBS_KEEP of them.
+
+#pragma once
+
+#include "db/inout.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <malamute.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Number of imports running in parallel
+#define CSV_IMPORT_WORKERS 1
+
+/// Number of jobs waiting for a worker at most
+#define IMPORT_JOBS_MAX_QUEUED 8
+
+/// Size of the csv documents waiting for a worker at most
+#define IMPORT_JOBS_MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+/// Number of finished jobs kept for status()
+#define IMPORT_JOBS_KEEP 32
+
+/// Imported assets published on the ASSETS stream by one send_configure() call
+#define IMPORT_JOBS_PUBLISH_BATCH 500
+
+/// Topic of the progress messages on the SSE stream
+#define IMPORT_JOBS_SSE_TOPIC "asset-import"
+
+namespace persist {
+
+class ImportJobs
+{
+public:
+    enum class State
+    {
+        QUEUED,
+        RUNNING,
+        DONE,
+        FAILED
+    };
+
+    struct Status
+    {
+        std::string                id;
+        std::string                user;
+        State                      state       = State::QUEUED;
+        size_t                     rows_total  = 0;  ///< data rows of the csv (header excluded)
+        size_t                     rows_done   = 0;  ///< rows imported, rejected or skipped so far
+        size_t                     rows_failed = 0;
+        int64_t                    eta         = -1; ///< seconds to the end, -1 if not known yet
+        std::string                error;            ///< why the whole import failed (FAILED only)
+        size_t                     imported = 0;     ///< rows imported (DONE only)
+        ImportStats                stats;            ///< inserted, updated and unchanged rows (DONE only)
+        std::map<int, std::string> failRows;         ///< errors per csv line (DONE only)
+        std::string                publish_error;    ///< why imported assets were not published (DONE only)
+    };
+
+    static ImportJobs& instance();
+
+    /// Waits for the running imports, queued ones are dropped
+    ~ImportJobs();
+
+    ImportJobs(const ImportJobs&) = delete;
+    ImportJobs& operator=(const ImportJobs&) = delete;
+
+    /// Queue import of the csv document
+    /// @param[in] skip_unchanged - see load_asset_csv()
+    /// @return id of the new job, empty if the queue is full
+    std::string start(
+        std::string        csv,
+        const std::string& user,
+        bool               skip_unchanged = false,
+        size_t             chunk_size     = CSV_IMPORT_CHUNK_SIZE);
+
+    /// Get current status of the job
+    /// @return false if the job does not exist (or was already forgotten)
+    bool status(const std::string& id, Status& status) const;
+
+    /// Status as json, the SSE stream gets it without the per-row errors
+    static std::string json(const Status& status, bool withErrors = true);
+
+private:
+    struct Job
+    {
+        Status                                status;
+        std::string                           csv;
+        bool                                  skip_unchanged = false;
+        size_t                                chunk_size     = CSV_IMPORT_CHUNK_SIZE;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point published;
+    };
+
+    ImportJobs() = default;
+
+    void work();
+    void run(Job& job, mlm_client_t* client);
+    void progress(Job& job, size_t total, size_t ok, size_t failed);
+    void finish(Job& job, State state);
+    void publish(mlm_client_t* client, Job& job, bool force);
+
+    mutable std::mutex                          _mutex;
+    std::condition_variable                     _cond;
+    std::deque<std::shared_ptr<Job>>            _queue;
+    size_t                                      _queuedBytes = 0;
+    std::map<std::string, std::shared_ptr<Job>> _jobs;
+    std::deque<std::string>                     _finished;
+    std::vector<std::thread>                    _workers;
+    bool                                        _stop = false;
+};
+
+} // namespace persist
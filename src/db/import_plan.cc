@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file import_plan.cc
+ * \brief Order of import of csv rows
+ */
+#include "db/import_plan.h"
+#include <algorithm>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace persist {
+
+ImportPlan import_plan(const std::vector<RowRefs>& rows)
+{
+    const size_t count = rows.size();
+    ImportPlan   plan;
+
+    // referenced value -> row defining it
+    std::unordered_map<std::string, size_t> defined;
+    for (size_t row_i = 1; row_i != count; ++row_i) {
+        defined.emplace(rows[row_i].name, row_i);
+        if (!rows[row_i].id.empty()) {
+            defined.emplace(rows[row_i].id, row_i);
+        }
+    }
+
+    std::vector<std::vector<size_t>> dependents(count);
+    std::vector<std::vector<size_t>> dependencies(count);
+    std::vector<size_t>              in_degree(count, 0);
+    for (size_t row_i = 1; row_i != count; ++row_i) {
+        for (const auto& value : rows[row_i].refs) {
+            auto it = defined.find(value);
+            if (it == defined.end() || it->second == row_i) {
+                // already in database or myself (ignored power source)
+                continue;
+            }
+            auto& deps = dependencies[row_i];
+            if (std::find(deps.begin(), deps.end(), it->second) != deps.end()) {
+                continue;
+            }
+            deps.push_back(it->second);
+            dependents[it->second].push_back(row_i);
+            in_degree[row_i]++;
+        }
+    }
+
+    plan.in_order.assign(count, false);
+    for (size_t row_i = 1; row_i != count; ++row_i) {
+        bool in_order = true;
+        for (size_t dep : dependencies[row_i]) {
+            in_order = in_order && dep < row_i && plan.in_order[dep];
+        }
+        plan.in_order[row_i] = in_order;
+    }
+
+    // Kahn's algorithm, ready rows are taken in csv order
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t row_i = 1; row_i != count; ++row_i) {
+        if (in_degree[row_i] == 0) {
+            ready.push(row_i);
+        }
+    }
+
+    size_t ordered = 0;
+    while (!ready.empty()) {
+        size_t row_i = ready.top();
+        ready.pop();
+        ++ordered;
+        if (!plan.in_order[row_i]) {
+            plan.deferred.push_back(row_i);
+        }
+        for (size_t next : dependents[row_i]) {
+            if (--in_degree[next] == 0) {
+                ready.push(next);
+            }
+        }
+    }
+
+    if (ordered + 1 >= count) {
+        return plan;
+    }
+
+    // what is left is either in a cycle or depends on one
+    // walk unresolved dependencies until some row repeats to name the cycle
+    std::vector<size_t> on_path(count, 0);
+    for (size_t row_i = 1; row_i != count; ++row_i) {
+        if (in_degree[row_i] == 0 || plan.cycles.count(row_i)) {
+            continue;
+        }
+        std::vector<size_t> path;
+        size_t              current = row_i;
+        while (on_path[current] != row_i && !plan.cycles.count(current)) {
+            on_path[current] = row_i;
+            path.push_back(current);
+            for (size_t dep : dependencies[current]) {
+                if (in_degree[dep] != 0) {
+                    current = dep;
+                    break;
+                }
+            }
+        }
+
+        auto cycle_start = std::find(path.begin(), path.end(), current);
+        if (cycle_start != path.end()) {
+            // row numbers as seen by the user, title is the first line
+            std::string description;
+            for (auto it = cycle_start; it != path.end(); ++it) {
+                description += std::to_string(*it + 1) + " -> ";
+            }
+            description += std::to_string(current + 1);
+            for (auto it = cycle_start; it != path.end(); ++it) {
+                plan.cycles[*it] = TRANSLATE_ME("circular dependency between rows %s", description.c_str());
+            }
+            path.erase(cycle_start, path.end());
+        }
+        for (size_t dependent : path) {
+            plan.cycles[dependent] = TRANSLATE_ME(
+                "depends on row %s, which cannot be imported due to circular dependency",
+                std::to_string(current + 1).c_str());
+        }
+    }
+
+    for (const auto& it : plan.cycles) {
+        log_warning("row %zu: %s", it.first, it.second.c_str());
+        plan.deferred.push_back(it.first);
+    }
+    return plan;
+}
+
+} // namespace persist
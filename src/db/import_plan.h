@@ -0,0 +1,75 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file import_plan.h
+/// @brief Order of import of csv rows
+///
+/// How it works
+/// ============
+/// Rows of a csv file reference other assets by name or id (location,
+/// logical_asset, power_source.X, group.X). Only these values are needed to
+/// order the import, so the file may be read twice: once for the references
+/// of all rows, once more to import the rows by parts.
+///
+/// A row is imported in csv order, while the file is read, if all rows it
+/// references come before it and are imported in csv order too. The others
+/// (references forward in the file) are deferred and imported at the end in
+/// dependency order (Kahn's algorithm, ready rows are taken in csv order).
+/// Rows in a cycle, or depending on one, cannot be ordered: they get an
+/// error describing the cycle and are the last ones in their csv order.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace persist {
+
+/// Names and references of a csv row, all import_plan() needs to know about it
+struct RowRefs
+{
+    std::string name;
+    std::string id;
+    // values of location, logical_asset, power_source.X and group.X columns, empty ones dropped
+    std::vector<std::string> refs;
+};
+
+/// Order of import of csv rows
+struct ImportPlan
+{
+    // by row number, true if the row is imported in csv order
+    std::vector<bool> in_order;
+    // rows imported after the others, in this order
+    std::vector<size_t> deferred;
+    // rows which cannot be ordered, with a description of the cycle
+    std::map<size_t, std::string> cycles;
+};
+
+/// Orders rows of csv so that every row comes after the rows it references
+///
+/// A reference is resolved against name and id columns of other rows, values
+/// not found are assets already in the database.
+///
+/// @param[in] rows - references of the rows by row number, rows[0] (titles) is ignored
+ImportPlan import_plan(const std::vector<RowRefs>& rows);
+
+} // namespace persist
@@ -27,6 +27,7 @@
 #include "db/dbhelpers.h"
 #include "shared/csv.h"
 #include <fty_common.h>
+#include <ctime>
 #include <fty_common_db.h>
 #include <iostream>
 #include <map>
@@ -37,6 +38,13 @@
 #define CREATE_MODE_ONE_ASSET 1
 #define CREATE_MODE_CSV       2
 
+// default number of new assets inserted in one transaction by csv import
+#define CSV_IMPORT_CHUNK_SIZE 500
+
+// default number of threads serializing json export, more threads are worth it only
+// where measured to be faster (the data are read by one connection either way)
+#define EXPORT_JSON_WORKERS 1
+
 // forward declaration
 class MlmClient;
 
@@ -62,19 +70,45 @@ int get_priority(const std::string& s);
 /// @throws execeptions on errors
 std::pair<db_a_elmnt_t, persist::asset_operation> process_one_asset(const shared::CsvMap& cm);
 
+/// Counters of one csv import
+struct ImportStats
+{
+    /// data rows of the csv (header excluded), known before the first row is imported
+    size_t rows     = 0;
+    size_t inserted = 0;
+    size_t updated  = 0;
+    /// rows with id equal to the stored asset, neither written nor reported in okRows
+    size_t unchanged = 0;
+};
+
 /// Processes a csv file
 ///
 /// Resuls are written in DB and into log.
 ///
-/// @param[in]  input    - an input file
+/// The file is read twice. The first pass keeps only names and references
+/// (location, logical_asset, power_source.X, group.X) of the rows to plan the
+/// order of import. The second pass imports rows in csv order by parts of
+/// chunk_size rows (CSV_IMPORT_CHUNK_SIZE if chunk_size is 0 or 1), a part is
+/// dropped once it is imported. Only rows referencing a row after them (and
+/// rows of cycles) are kept in memory, they are imported at the end in
+/// dependency order. Memory thus grows with the size of the parts, the number
+/// of such rows and the names of the file, not with all its cells.
+///
+/// @param[in]  input    - an input file, must be seekable
 /// @param[out] okRows   - a list of short information about inserted rows
 /// @param[out] failRows - a list of rejected rows with the message
+/// @param[in]  chunk_size - new assets inserted in one transaction, 0 or 1 inserts them one by one
+/// @param[in]  skip_unchanged - do not write (and report) updates which would not change the asset
+/// @param[out] stats    - if set, counters of the import are added to it
 void load_asset_csv(
     std::istream&                                                   input,
     std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
     std::map<int, std::string>&                                     failRows,
     touch_cb_t                                                      touch_fn,
-    std::string                                                     user = "");
+    std::string                                                     user           = "",
+    size_t                                                          chunk_size     = CSV_IMPORT_CHUNK_SIZE,
+    bool                                                            skip_unchanged = false,
+    ImportStats*                                                    stats          = nullptr);
 
 /// Processes a csv map
 ///
@@ -83,20 +117,53 @@ void load_asset_csv(
 /// @param[in]  cm       - an input csv map
 /// @param[out] okRows   - a list of short information about inserted rows
 /// @param[out] failRows - a list of rejected rows with the message
+/// @param[in]  chunk_size - new assets inserted in one transaction, 0 or 1 inserts them one by one
+/// @param[in]  skip_unchanged - do not write (and report) updates which would not change the asset
+/// @param[out] stats    - if set, counters of the import are added to it
+///
+/// New assets are written by chunks (see AssetBulkInsert), a chunk failing as a whole
+/// is imported again row by row, so failRows always gets the error of the row.
+///
+/// With skip_unchanged, the stored state of all assets updated by the csv is loaded at once
+/// (see select_web_elements), by the istream variant at once per part. A row equal to it in location, status, priority, asset_tag,
+/// ext attributes, groups and power sources is not written and not put into okRows, so
+/// the caller does not publish it either.
 void load_asset_csv(
     const shared::CsvMap&                                           cm,
     std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
     std::map<int, std::string>&                                     failRows,
-    touch_cb_t                                                      touch_fn);
+    touch_cb_t                                                      touch_fn,
+    size_t                                                          chunk_size     = CSV_IMPORT_CHUNK_SIZE,
+    bool                                                            skip_unchanged = false,
+    ImportStats*                                                    stats          = nullptr);
 
 /// export csv file and write result to output stream
 ///
+/// Rows are written and the stream is flushed by chunks of about 64kB, so with a tntnet reply
+/// in direct mode (reply.setDirectMode()) the client gets the data while the export runs.
+///
 /// @param[out] out - a reference to the standard output stream to which content will be written
 /// @param[in] dc_id - limit export to this DC id (default -1 means all DCs)
 /// @param[in] generate_bom - generate BOM or not (default true)
-void export_asset_csv(std::ostream& out, int64_t dc_id = -1, bool generate_bom = true);
+/// @param[in] since - if set, export only assets changed since this time and tombstones of assets
+///                    deleted since (rows with status 'deleted', only name and id filled), see asset_changes.h
+void export_asset_csv(std::ostream& out, int64_t dc_id = -1, bool generate_bom = true, std::time_t since = 0);
 
-void export_asset_json(std::ostream& out, std::set<std::string>* listElement = NULL);
+/// export assets as json array and write result to output stream
+///
+/// Data are read by a fixed number of queries, then shards of consecutive ids are serialized
+/// by up to workers threads and written in id order.
+///
+/// @param[out] out - a reference to the standard output stream to which content will be written
+/// @param[in] listElement - internal names of the assets to export, nothing is exported if NULL
+/// @param[in] workers - maximum number of threads, 1 serializes in the calling thread only
+/// @param[in] since - if set, export only listed assets changed since this time, followed by
+///                    {"id", "name", "status": "deleted"} of all assets deleted since
+void export_asset_json(
+    std::ostream&          out,
+    std::set<std::string>* listElement = NULL,
+    size_t                 workers     = EXPORT_JSON_WORKERS,
+    std::time_t            since       = 0);
 
 /// Identify id of row with rackcontroller-0
 /// @param[in]   client      Mlm client to send and receieve messages to/from other agents
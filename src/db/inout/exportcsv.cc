@@ -23,21 +23,31 @@
     \author Michal Vyskocil <MichalVyskocil@Eaton.com>
 */
 
+#include "db/asset_bulk_select.h"
+#include "db/asset_changes.h"
+#include "db/connection_pool.h"
 #include "dbtypes.h"
-#include "shared/data.h"
+#include "shared/csv_writer.h"
+#include "shared/json_writer.h"
 #include "shared/utilspp.h"
 #include <algorithm>
-#include <cxxtools/csvserializer.h>
-#include <cxxtools/jsonserializer.h>
-#include <cxxtools/regex.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <exception>
 #include <fty_common.h>
 #include <fty_common_db_asset.h>
-#include <fty_common_db_dbpath.h>
 #include <fty_common_macros.h>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
 #include <tntdb/row.h>
 #include <tntdb/transaction.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace persist {
@@ -65,76 +75,35 @@ static int s_update_keytags(tntdb::Connection& conn, const std::vector<std::stri
     return rv;
 }
 
-// using callbacks in cycle with maximum possible items might be difficult, so simply generate vector
-// for power links and print it inside the cycle
-//
-// at the same time I don't think this is general enough to be in src/db, so static functions here
-typedef std::vector<std::tuple<std::string, std::string, std::string>> power_links_t;
-static int s_power_links(tntdb::Connection& conn, a_elmnt_id_t id, power_links_t& out)
+void export_asset_csv(std::ostream& out, int64_t dc_id, bool generate_bom, std::time_t since)
 {
-    row_cb_f foo = [&out](const tntdb::Row& r) {
-        std::string src_name{""};
-        std::string src_out{""};
-        std::string dest_in{""};
-        r["src_name"].get(src_name);
-        r["src_out"].get(src_out);
-        r["dest_in"].get(dest_in);
-        out.push_back(std::make_tuple(src_name, src_out, dest_in));
-    };
-    return DBAssets::select_v_web_asset_power_link_src_byId(conn, id, foo);
-}
-
-// helper class to assist with serialization line by line
-class LineCsvSerializer
-{
-public:
-    explicit LineCsvSerializer(std::ostream& out)
-        : _cs{out, NULL}
-        , _buf{}
-    {
-    }
-
-    void add(const std::string& s)
-    {
-        _buf.push_back(s);
-    }
-
-    void add(const uint32_t i)
-    {
-        return add(std::to_string(i));
-    }
-
-    void serialize()
-    {
-        std::vector<std::vector<std::string>> aux{};
-        aux.push_back(_buf);
-        _cs.serialize(aux);
-        _buf.clear();
-    }
-
-protected:
-    cxxtools::CsvSerializer  _cs;
-    std::vector<std::string> _buf;
-};
+    auto start = std::chrono::steady_clock::now();
 
-void export_asset_csv(std::ostream& out, int64_t dc_id, bool generate_bom)
-{
     // 0.) tntdb connection
-    tntdb::Connection conn;
-    std::string       msg{TRANSLATE_ME("no connection to database")};
+    persist::PooledConnection conn;
+    std::string               msg{TRANSLATE_ME("no connection to database")};
     try {
-        conn = tntdb::connect(DBConn::url);
+        conn = persist::ConnectionPool::instance().acquire();
     } catch (...) {
         log_error("%s", msg.c_str());
         LOG_END;
         throw std::runtime_error(msg.c_str());
     }
+    if (since > 0) {
+        // the error tells why an incremental export is not possible
+        try {
+            prepare_asset_tombstones();
+        } catch (const std::exception& e) {
+            log_error("%s", e.what());
+            throw std::runtime_error(e.what());
+        }
+    }
     tntdb::Transaction transaction{conn, true};
 
     if (generate_bom)
         out << "\xef\xbb\xbf";
 
-    LineCsvSerializer lcs{out};
+    shared::CsvWriter csv{out};
 
     // TODO: move somewhere else
     std::vector<std::string> KEYTAGS = {"description",
@@ -178,104 +147,115 @@ void export_asset_csv(std::ostream& out, int64_t dc_id, bool generate_bom)
     for (const auto& k : ASSET_ELEMENT_KEYTAGS) {
         if (k == "id")
             continue; // ugly but works
-        lcs.add(k);
+        csv.field(k);
     }
 
     // 1.2      print power links
     for (uint32_t i = 0; i != max_power_links; i++) {
         std::string si = std::to_string(i + 1);
-        lcs.add("power_source." + si);
-        lcs.add("power_plug_src." + si);
-        lcs.add("power_input." + si);
+        csv.field("power_source." + si);
+        csv.field("power_plug_src." + si);
+        csv.field("power_input." + si);
     }
 
     // 1.3      print extended attributes
     for (const auto& k : KEYTAGS) {
-        lcs.add(k);
+        csv.field(k);
     }
 
     // 1.4      print groups
     for (uint32_t i = 0; i != max_groups; i++) {
         std::string si = std::to_string(i + 1);
-        lcs.add("group." + si);
+        csv.field("group." + si);
     }
 
-    lcs.add("id");
-    lcs.serialize();
+    csv.field("id");
+    csv.endRow();
 
-    // 2. FOR EACH ROW from v_web_asset_element / t_bios_asset_element do ...
-    std::function<void(const tntdb::Row&)> process_v_web_asset_element_row = [&conn, &lcs, &KEYTAGS, max_power_links,
-                                                                              max_groups, &msg](const tntdb::Row& r) {
+    // 2. names, ext attributes, groups and links of all assets at once
+    std::unique_ptr<AssetBulkSelect> all;
+    try {
+        all.reset(new AssetBulkSelect(conn));
+    } catch (const std::exception& e) {
+        log_error("%s: %s", msg.c_str(), e.what());
+        throw std::runtime_error(msg.c_str());
+    }
+    const AssetNames& names = all->names();
+
+    // 2.1 incremental export, assets changed since
+    std::unordered_set<a_elmnt_id_t> changed;
+    if (since > 0) {
+        try {
+            changed = select_changed_assets(conn, *all, since);
+        } catch (const std::exception& e) {
+            log_error("%s: %s", msg.c_str(), e.what());
+            throw std::runtime_error(msg.c_str());
+        }
+    }
+
+    // 3. FOR EACH ROW from v_web_asset_element / t_bios_asset_element do ...
+    std::function<void(const tntdb::Row&)> process_v_web_asset_element_row = [&csv, &KEYTAGS, &all, &names,
+                                                                              &changed, max_power_links, max_groups,
+                                                                              since, &msg](const tntdb::Row& r) {
         a_elmnt_id_t id_num = 0;
-        std::string  id;
+        std::string  id, ext_name;
         r["id"].get(id_num);
-        std::pair<std::string, std::string> asset_names = DBAssets::id_to_name_ext_name(id_num);
-        if (asset_names.first.empty() && asset_names.second.empty())
+        // incremental export, skip assets not changed since
+        if (since > 0 && changed.count(id_num) == 0)
+            return;
+        if (!names.id_to_names(id_num, id, ext_name))
             throw std::runtime_error(msg.c_str());
-        id = asset_names.first;
 
         a_elmnt_id_t id_parent_num = 0;
-        std::string  location;
+        std::string  location, location_id;
         r["id_parent"].get(id_parent_num);
-        location = DBAssets::id_to_name_ext_name(id_parent_num).second;
-
-        // 2.1      select all extended attributes
-        std::map<std::string, std::pair<std::string, bool>> ext_attrs;
-        int rv1 = DBAssets::select_ext_attributes(conn, id_num, ext_attrs);
-        if (rv1 != 0)
-            throw std::runtime_error(msg.c_str());
+        names.id_to_names(id_parent_num, location_id, location);
 
-        // 2.3 links
-        power_links_t power_links;
-        rv1 = s_power_links(conn, id_num, power_links);
-        if (rv1 != 0)
-            throw std::runtime_error(msg.c_str());
-        // 3.4 groups
-        std::vector<std::string> groups;
-        rv1 = DBAssets::select_group_names(conn, id_num, groups);
-        if (rv1 != 0)
-            throw std::runtime_error(msg.c_str());
+        // 3.1      extended attributes, links and groups
+        const auto& ext_attrs   = all->ext_attributes(id_num);
+        const auto& power_links = all->power_links(id_num);
+        const auto& groups      = all->groups(id_num);
 
-        // 2.5      PRINT IT
-        // 2.5.1    things from asset element table itself
-        // ORDER of fields added to the lcs IS SIGNIFICANT
+        // 3.2      PRINT IT
+        // 3.2.1    things from asset element table itself
+        // ORDER of fields added to the csv IS SIGNIFICANT
         std::string type_name;
         {
-            lcs.add(asset_names.second);
+            csv.field(ext_name);
 
             r["type_name"].get(type_name);
-            lcs.add(type_name);
+            csv.field(type_name);
 
             std::string subtype_name = "";
-            // subtype for groups is stored as ext/type
+            // subtype for groups is stored as ext/type, it is not printed as ext attribute then
             if (type_name == "group") {
-                if (ext_attrs.count("type") == 1) {
-                    subtype_name = ext_attrs["type"].first;
-                    ext_attrs.erase("type");
+                auto it = ext_attrs.find("type");
+                if (it != ext_attrs.end()) {
+                    subtype_name = it->second.first;
                 }
             } else {
                 r["subtype_name"].get(subtype_name);
             }
             if (subtype_name == "N_A")
                 subtype_name = "";
-            lcs.add(utils::strip(subtype_name));
+            csv.field(utils::strip(subtype_name));
 
-            lcs.add(location);
+            csv.field(location);
 
             std::string status;
             r["status"].get(status);
-            lcs.add(status);
+            csv.field(status);
 
             uint32_t priority;
             r["priority"].get(priority);
-            lcs.add("P" + std::to_string(priority));
+            csv.field("P" + std::to_string(priority));
 
             std::string asset_tag;
             r["asset_tag"].get(asset_tag);
-            lcs.add(asset_tag);
+            csv.field(asset_tag);
         }
 
-        // 2.5.2        power location
+        // 3.2.2        power location
         for (uint32_t i = 0; i != max_power_links; i++) {
             std::string source{""};
             std::string plug_src{""};
@@ -284,52 +264,47 @@ void export_asset_csv(std::ostream& out, int64_t dc_id, bool generate_bom)
             if (i >= power_links.size()) {
                 // nothing here, exists only for consistency reasons
             } else {
-                int rv2 = DBAssets::name_to_extname(std::get<0>(power_links[i]), source);
-                if (rv2 != 0)
+                std::string source_id;
+                if (!names.id_to_names(power_links[i].src, source_id, source))
                     throw std::runtime_error(msg.c_str());
-                plug_src = std::get<1>(power_links[i]);
-                input    = std::get<2>(power_links[i]);
+                plug_src = power_links[i].src_out;
+                input    = power_links[i].dest_in;
             }
-            lcs.add(source);
-            lcs.add(plug_src);
-            lcs.add(input);
+            csv.field(source);
+            csv.field(plug_src);
+            csv.field(input);
         }
 
-        // convert necessary ids to names, for now just logical_asset
-        {
-            auto it = ext_attrs.find("logical_asset");
-            if (it != ext_attrs.end()) {
+        // 3.2.3        read-write (!read_only) extended attributes
+        for (const auto& k : KEYTAGS) {
+            auto it = ext_attrs.find(k);
+            if (it == ext_attrs.end() || it->second.second || (k == "type" && type_name == "group")) {
+                csv.field("");
+            } else if (k == "logical_asset") {
+                // convert necessary ids to names, for now just logical_asset
                 std::string extname;
-                int         rv2 = DBAssets::name_to_extname(it->second.first, extname);
-                if (rv2 != 0)
+                if (names.name_to_extname(it->second.first, extname) != 0)
                     throw std::runtime_error(msg.c_str());
-                ext_attrs["logical_asset"] = make_pair(extname, it->second.second);
-            }
-        }
-        // 2.5.3        read-write (!read_only) extended attributes
-        for (const auto& k : KEYTAGS) {
-            if (ext_attrs.count(k) == 1 && !ext_attrs[k].second) {
-                lcs.add(ext_attrs[k].first);
+                csv.field(extname);
             } else {
-                lcs.add("");
+                csv.field(it->second.first);
             }
         }
 
-        // 2.5.4        groups
+        // 3.2.4        groups
         for (uint32_t i = 0; i != max_groups; i++) {
             if (i >= groups.size())
-                lcs.add("");
+                csv.field("");
             else {
-                std::string extname;
-                int         rv2 = DBAssets::name_to_extname(groups[i], extname);
-                if (rv2 != 0)
+                std::string group_id, extname;
+                if (!names.id_to_names(groups[i], group_id, extname))
                     throw std::runtime_error(msg.c_str());
-                lcs.add(extname);
+                csv.field(extname);
             }
         }
 
-        lcs.add(id);
-        lcs.serialize();
+        csv.field(id);
+        csv.endRow();
     };
 
     if (dc_id > 0) {
@@ -339,7 +314,46 @@ void export_asset_csv(std::ostream& out, int64_t dc_id, bool generate_bom)
     }
     if (rv != 0)
         throw std::runtime_error(msg.c_str());
+
+    // 4. tombstones of assets deleted since, with status 'deleted' and only name and id set
+    size_t deleted = 0;
+    if (since > 0) {
+        std::vector<AssetTombstone> tombstones;
+        try {
+            tombstones = select_asset_tombstones(conn, since);
+        } catch (const std::exception& e) {
+            log_error("%s: %s", msg.c_str(), e.what());
+            throw std::runtime_error(msg.c_str());
+        }
+        for (const auto& tombstone : tombstones) {
+            std::string name, ext_name;
+            // the id was reused by a new asset
+            if (names.id_to_names(tombstone.id, name, ext_name))
+                continue;
+            csv.field(tombstone.ext_name);
+            csv.field(""); // type
+            csv.field(""); // sub_type
+            csv.field(""); // location
+            csv.field("deleted");
+            csv.field(""); // priority
+            csv.field(""); // asset_tag
+            for (size_t i = 0; i != 3 * max_power_links + KEYTAGS.size() + max_groups; i++) {
+                csv.field("");
+            }
+            csv.field(tombstone.name);
+            csv.endRow();
+            ++deleted;
+        }
+    }
+
+    if (!csv.flush())
+        throw std::runtime_error(TRANSLATE_ME("cannot write csv"));
     transaction.commit();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    log_info(
+        "%zu assets (%zu deleted) exported to csv in %" PRIi64 " ms", csv.rows() - 1, deleted,
+        int64_t(elapsed.count()));
 }
 
 struct Outlet
@@ -361,319 +375,358 @@ std::string getOutletNumber(const std::string& extAttributeName)
     return oNumber;
 }
 
-void export_asset_json(std::ostream& out, std::set<std::string>* listElements)
+// "outlet.<number>.<attribute>", whole key or just its beginning
+static bool s_is_outlet_attribute(const std::string& key, const char* attribute, bool prefix)
 {
-    asset_manager asset_mgr;
-    // 0.) tntdb connection
-    tntdb::Connection conn;
-    std::string       msg{"no connection to database"};
-    try {
-        conn = tntdb::connect(DBConn::url);
-    } catch (...) {
-        log_error("%s", msg.c_str());
-        LOG_END;
-        throw std::runtime_error(msg.c_str());
-    }
-    tntdb::Transaction transaction{conn, true};
+    static const std::string OUTLET = "outlet.";
+
+    if (key.compare(0, OUTLET.size(), OUTLET) != 0)
+        return false;
+    size_t pos = OUTLET.size();
+    while (pos < key.size() && isdigit(static_cast<unsigned char>(key[pos])))
+        ++pos;
+    if (pos == OUTLET.size() || pos == key.size() || key[pos] != '.')
+        return false;
+    ++pos;
+    size_t len = strlen(attribute);
+    if (key.compare(pos, len, attribute) != 0)
+        return false;
+    return prefix || pos + len == key.size();
+}
 
-    cxxtools::JsonSerializer serializer(out);
+// row of v_web_asset_element needed by json export
+struct JsonAsset
+{
+    a_elmnt_id_t id        = 0;
+    a_elmnt_id_t id_parent = 0;
+    std::string  name;
+    std::string  ext_name;
+    std::string  type_name;
+    std::string  subtype_name;
+    std::string  status;
+    uint32_t     priority = 0;
+    std::string  asset_tag;
+};
 
-    cxxtools::SerializationInfo si;
-    si.setCategory(cxxtools::SerializationInfo::Category::Array);
-    // 2. FOR EACH ROW from v_web_asset_element / t_bios_asset_element do ...
-    std::function<void(const tntdb::Row&)> process_v_web_asset_element_row_json = [&conn, &si, &msg, &asset_mgr,
-                                                                                   listElements](const tntdb::Row& r) {
-        a_elmnt_id_t id_num = 0;
-        std::string  id;
-        r["id"].get(id_num);
-        std::pair<std::string, std::string> asset_names = DBAssets::id_to_name_ext_name(id_num);
-        if (asset_names.first.empty() && asset_names.second.empty())
-            throw std::runtime_error(msg.c_str());
-        id = asset_names.first;
+using JsonAssets = std::unordered_map<a_elmnt_id_t, JsonAsset>;
 
-        if (listElements == NULL || listElements->count(id) <= 0) {
-            return;
-        }
-        a_elmnt_id_t id_parent_num = 0;
-        std::string  location;
-        r["id_parent"].get(id_parent_num);
-        std::pair<std::string, std::string> location_names;
-        if (id_parent_num > 0) {
-            // Protect against invalid IDs.
-            location_names = DBAssets::id_to_name_ext_name(id_parent_num);
-        }
-        location                = location_names.second;
-        std::string location_id = location_names.first;
-
-        // 2.1      select all extended attributes
-        std::map<std::string, std::pair<std::string, bool>> ext_attrs;
-        int rv = DBAssets::select_ext_attributes(conn, id_num, ext_attrs);
-        if (rv != 0)
-            throw std::runtime_error(msg.c_str());
+static void s_asset_json(
+    utils::JsonWriter& w, const JsonAsset& asset, const JsonAssets& assets, const AssetBulkSelect& all)
+{
+    const AssetNames& names = all.names();
+    const std::string msg{"no connection to database"};
+
+    std::string location_id, location;
+    std::string location_type;
+    if (asset.id_parent > 0) {
+        // Protect against invalid IDs.
+        names.id_to_names(asset.id_parent, location_id, location);
+        auto parent = assets.find(asset.id_parent);
+        if (parent != assets.end())
+            location_type = parent->second.type_name;
+    }
 
-        // 2.3 links
-        power_links_t power_links;
-        rv = s_power_links(conn, id_num, power_links);
-        if (rv != 0)
-            throw std::runtime_error(msg.c_str());
-        // 3.4 groups
-        std::vector<std::string> groups;
-        rv = DBAssets::select_group_names(conn, id_num, groups);
-        if (rv != 0)
+    const auto& ext_attrs   = all.ext_attributes(asset.id);
+    const auto& power_links = all.power_links(asset.id);
+    bool        is_group    = asset.type_name == "group";
+
+    // ORDER of members IS SIGNIFICANT
+    w.beginObject();
+    w.member("id", asset.name);
+    w.member(
+        "power_devices_in_uri",
+        "/api/v1/assets?in=" + asset.name + "&sub_type=epdu,pdu,feed,genset,ups,sts,rackcontroller");
+    w.member("name", asset.ext_name);
+    w.member("status", asset.status);
+    w.member("priority", "P" + std::to_string(asset.priority));
+    w.member("type", asset.type_name);
+    if (!location.empty()) {
+        w.member("location_uri", "/api/v1/asset/" + location_id);
+        w.member("location_id", location_id);
+    }
+    w.member("location", location);
+    w.member("location_type", location_type);
+
+    // TODO : groups
+    w.key("groups").beginArray().endArray();
+
+    std::string subtype_name = "";
+    // subtype for groups is stored as ext/type
+    if (is_group) {
+        auto it = ext_attrs.find("type");
+        if (it != ext_attrs.end())
+            subtype_name = it->second.first;
+    } else {
+        subtype_name = asset.subtype_name;
+    }
+    if (subtype_name == "N_A")
+        subtype_name = "";
+    w.member("sub_type", utils::strip(subtype_name));
+
+    // TODO : Parents
+    w.key("parents").beginArray().endArray();
+
+    // power location
+    w.key("powers").beginArray();
+    for (const auto& link : power_links) {
+        std::string src_id, source;
+        if (!names.id_to_names(link.src, src_id, source))
             throw std::runtime_error(msg.c_str());
+        w.beginObject();
+        w.member("src_name", source);
+        w.member("src_id", src_id);
+        w.member("src_socket", link.src_out);
+        w.member("dest_socket", link.dest_in);
+        w.endObject();
+    }
+    w.endArray();
 
-        cxxtools::SerializationInfo& si_asset = si.addMember("");
-        // 2.5      PRINT IT
-        // 2.5.1    things from asset element table itself
-        // ORDER of fields added to the lcs IS SIGNIFICANT
-        std::string type_name;
-        {
-            si_asset.addMember("id") <<= id;
-            si_asset.addMember("power_devices_in_uri") <<=
-                "/api/v1/assets?in=" + id + "&sub_type=epdu,pdu,feed,genset,ups,sts,rackcontroller";
-            si_asset.addMember("name") <<= asset_names.second;
-
-            std::string status;
-            r["status"].get(status);
-            si_asset.addMember("status") <<= status;
-
-            uint32_t priority;
-            r["priority"].get(priority);
-            si_asset.addMember("priority") <<= ("P" + std::to_string(priority));
+    // extended attributes
+    w.key("ext").beginArray();
+    if (!asset.asset_tag.empty()) {
+        w.beginObject().member("asset_tag", asset.asset_tag).member("read_only", false).endObject();
+    }
 
-            r["type_name"].get(type_name);
-            si_asset.addMember("type") <<= type_name;
+    static const std::string      t_ip("ip.");
+    std::map<std::string, Outlet> outlets;
+    auto                          outlet = [&outlets](const std::string& oNumber) -> Outlet& {
+        return outlets.emplace(oNumber, Outlet()).first->second;
+    };
+    for (const auto& k : ext_attrs) {
+        if (k.first == "name" || k.first.compare(0, t_ip.length(), t_ip) == 0)
+            continue;
+        // filter location_type (already present) and type of group (sub_type)
+        if (k.first == "location_type" || (is_group && k.first == "type"))
+            continue;
+
+        // We don't want info use in outlets
+        if (s_is_outlet_attribute(k.first, "label", false)) {
+            Outlet& o = outlet(getOutletNumber(k.first));
+            o.label   = k.second.first;
+            o.label_r = k.second.second;
+            continue;
+        } else if (s_is_outlet_attribute(k.first, "group", false)) {
+            Outlet& o = outlet(getOutletNumber(k.first));
+            o.group   = k.second.first;
+            o.group_r = k.second.second;
+            continue;
+        } else if (s_is_outlet_attribute(k.first, "type", false)) {
+            Outlet& o = outlet(getOutletNumber(k.first));
+            o.type    = k.second.first;
+            o.type_r  = k.second.second;
+            continue;
+        }
+        // for ups programmable outlet
+        else if (s_is_outlet_attribute(k.first, "switchable", true)) {
+            outlet(getOutletNumber(k.first));
+        }
+        // for ups master outlet
+        else if (k.first == "outlet.switchable") {
+            outlet("0");
+        } else if (k.first == "outlet.label") {
+            Outlet& o = outlet("0");
+            o.label   = k.second.first;
+            o.label_r = k.second.second;
+        }
 
-            if (!location.empty()) {
-                si_asset.addMember("location_uri") <<= "/api/v1/asset/" + location_id;
-                si_asset.addMember("location_id") <<= location_id;
-            }
-            si_asset.addMember("location") <<= location;
+        // print valid info, convert necessary ids to names, for now just logical_asset
+        w.beginObject();
+        if (k.first == "logical_asset") {
+            std::string extname;
+            if (names.name_to_extname(k.second.first, extname) != 0)
+                throw std::runtime_error(msg.c_str());
+            w.member(k.first, extname);
+        } else {
+            w.member(k.first, k.second.first);
+        }
+        w.member("read_only", k.second.second);
+        w.endObject();
+    }
+    w.endArray();
 
-            if (id_parent_num > 0) {
-                auto parentAsset = asset_mgr.get_item1(id_parent_num);
-                si_asset.addMember("location_type") <<= parentAsset.item.basic.type_name;
+    // Print Ips
+    w.key("ips").beginArray();
+    for (const auto& k : ext_attrs) {
+        if (k.first.compare(0, t_ip.length(), t_ip) == 0)
+            w.value(k.second.first);
+    }
+    w.endArray();
+
+    // Print outlets
+    if (!outlets.empty()) {
+        w.key("outlets").beginObject();
+        for (const auto& oneOutlet : outlets) {
+            w.key(oneOutlet.first).beginArray();
+
+            w.beginObject().member("name", "label");
+            // if label is empty, get index value
+            if (!oneOutlet.second.label.empty()) {
+                w.member("value", oneOutlet.second.label).member("read_only", oneOutlet.second.label_r);
             } else {
-                si_asset.addMember("location_type") <<= "";
+                w.member("value", oneOutlet.first).member("read_only", true);
             }
+            w.endObject();
 
-            // TODO : groups
-            cxxtools::SerializationInfo& si_asset_groups = si_asset.addMember("groups");
-            si_asset_groups.setCategory(cxxtools::SerializationInfo::Category::Array);
-            /*
-            // 2.5.4        groups
-            for (uint32_t i = 0; i != groups.size(); i++) {
-                if (i >= groups.size())
-                    lcs.add("");
-                else {
-                    std::string extname;
-                    int rv = DBAssets::name_to_extname (groups[i], extname);
-                    if (rv != 0)
-                        throw std::runtime_error(msg.c_str());
-                    lcs.add(extname);
-                }
+            if (!oneOutlet.second.group.empty()) {
+                w.beginObject().member("name", "group").member("value", oneOutlet.second.group);
+                w.member("read_only", oneOutlet.second.group_r).endObject();
             }
-    */
-            std::string subtype_name = "";
-            // subtype for groups is stored as ext/type
-            if (type_name == "group") {
-                if (ext_attrs.count("type") == 1) {
-                    subtype_name = ext_attrs["type"].first;
-                    ext_attrs.erase("type");
-                }
-            } else {
-                r["subtype_name"].get(subtype_name);
+            if (!oneOutlet.second.type.empty()) {
+                w.beginObject().member("name", "type").member("value", oneOutlet.second.type);
+                w.member("read_only", oneOutlet.second.type_r).endObject();
             }
-            if (subtype_name == "N_A")
-                subtype_name = "";
-
-            si_asset.addMember("sub_type") <<= utils::strip(subtype_name);
+            w.endArray();
         }
+        w.endObject();
+    }
+    w.endObject();
+}
 
-        // TODO : Parents
-        cxxtools::SerializationInfo& si_asset_parents = si_asset.addMember("parents");
-        si_asset_parents.setCategory(cxxtools::SerializationInfo::Category::Array);
-
-        // 2.5.2        power location
-        cxxtools::SerializationInfo& si_asset_powers = si_asset.addMember("powers");
-        si_asset_powers.setCategory(cxxtools::SerializationInfo::Category::Array);
-        for (uint32_t i = 0; i != power_links.size(); i++) {
-            cxxtools::SerializationInfo& si_power = si_asset_powers.addMember("");
-            std::string                  source{""};
-            std::string                  plug_src{""};
-            std::string                  input{""};
+void export_asset_json(std::ostream& out, std::set<std::string>* listElements, size_t workers, std::time_t since)
+{
+    // smaller shards are not worth a thread
+    static constexpr size_t MIN_SHARD_SIZE = 256;
 
-            if (i >= power_links.size()) {
-                // nothing here, exists only for consistency reasons
-            } else {
-                int rv1 = DBAssets::name_to_extname(std::get<0>(power_links[i]), source);
-                if (rv1 != 0)
-                    throw std::runtime_error(msg.c_str());
-                plug_src = std::get<1>(power_links[i]);
-                input    = std::get<2>(power_links[i]);
-            }
-            si_power.addMember("src_name") <<= source;
-            si_power.addMember("src_id") <<= std::get<0>(power_links[i]);
-            si_power.addMember("src_socket") <<= plug_src;
-            si_power.addMember("dest_socket") <<= input;
-        }
+    auto start = std::chrono::steady_clock::now();
 
-        // convert necessary ids to names, for now just logical_asset
-        {
-            auto it = ext_attrs.find("logical_asset");
-            if (it != ext_attrs.end()) {
-                std::string extname;
-                int         rv1 = DBAssets::name_to_extname(it->second.first, extname);
-                if (rv1 != 0)
-                    throw std::runtime_error(msg.c_str());
-                ext_attrs["logical_asset"] = make_pair(extname, it->second.second);
-            }
+    // 0.) tntdb connection
+    persist::PooledConnection conn;
+    std::string               msg{"no connection to database"};
+    try {
+        conn = persist::ConnectionPool::instance().acquire();
+    } catch (...) {
+        log_error("%s", msg.c_str());
+        LOG_END;
+        throw std::runtime_error(msg.c_str());
+    }
+    if (since > 0) {
+        // the error tells why an incremental export is not possible
+        try {
+            prepare_asset_tombstones();
+        } catch (const std::exception& e) {
+            log_error("%s", e.what());
+            throw std::runtime_error(e.what());
         }
+    }
+    tntdb::Transaction transaction{conn, true};
 
-        // 2.5.3        extended attributes
-        cxxtools::SerializationInfo& si_asset_ext_list = si_asset.addMember("ext");
-        si_asset_ext_list.setCategory(cxxtools::SerializationInfo::Category::Array);
-
-        std::string asset_tag;
-        r["asset_tag"].get(asset_tag);
-        if (!asset_tag.empty()) {
-            cxxtools::SerializationInfo& si_ext_asset_tag = si_asset_ext_list.addMember("");
-            si_ext_asset_tag.addMember("asset_tag") <<= asset_tag;
-            si_ext_asset_tag.addMember("read_only") <<= false;
-        }
+    // 1. names, ext attributes, groups and links of all assets at once
+    std::unique_ptr<AssetBulkSelect> all;
+    try {
+        all.reset(new AssetBulkSelect(conn));
+    } catch (const std::exception& e) {
+        log_error("%s: %s", msg.c_str(), e.what());
+        throw std::runtime_error(msg.c_str());
+    }
+    const AssetNames& names = all->names();
+
+    // 2. all rows from v_web_asset_element / t_bios_asset_element, parents are needed for location_type
+    JsonAssets                             assets;
+    std::vector<const JsonAsset*>          selected;
+    std::function<void(const tntdb::Row&)> process_v_web_asset_element_row_json = [&assets, &names,
+                                                                                   &msg](const tntdb::Row& r) {
+        JsonAsset asset;
+        r["id"].get(asset.id);
+        if (!names.id_to_names(asset.id, asset.name, asset.ext_name))
+            throw std::runtime_error(msg.c_str());
+        r["id_parent"].get(asset.id_parent);
+        r["type_name"].get(asset.type_name);
+        r["subtype_name"].get(asset.subtype_name);
+        r["status"].get(asset.status);
+        r["priority"].get(asset.priority);
+        r["asset_tag"].get(asset.asset_tag);
+        assets.emplace(asset.id, std::move(asset));
+    };
 
-        std::string                   t_ip("ip.");
-        cxxtools::Regex               r_outlet_label("^outlet\\.[0-9][0-9]*\\.label$");
-        cxxtools::Regex               r_outlet_group("^outlet\\.[0-9][0-9]*\\.group$");
-        cxxtools::Regex               r_outlet_type("^outlet\\.[0-9][0-9]*\\.type$");
-        cxxtools::Regex               r_outlet_switchable("^outlet\\.[0-9][0-9]*\\.switchable");
-        std::map<std::string, Outlet> outlets;
-
-        // Print extended attributes
-        for (const auto& k : ext_attrs) {
-            if (k.first != "name" && (k.first.compare(0, t_ip.length(), t_ip) != 0)) {
-                // filter location_type (already present)
-                if (k.first == "location_type")
-                    continue;
-
-                // We don't want info use in outlets
-                if (r_outlet_label.match(k.first)) {
-                    auto oNumber = getOutletNumber(k.first);
-                    auto it      = outlets.find(oNumber);
-                    if (it == outlets.cend()) {
-                        auto r1 = outlets.emplace(oNumber, Outlet());
-                        it     = r1.first;
-                    }
-                    it->second.label   = k.second.first;
-                    it->second.label_r = k.second.second;
-                    continue;
-                } else if (r_outlet_group.match(k.first)) {
-                    auto oNumber = getOutletNumber(k.first);
-                    auto it      = outlets.find(oNumber);
-                    if (it == outlets.cend()) {
-                        auto r1 = outlets.emplace(oNumber, Outlet());
-                        it     = r1.first;
-                    }
-                    it->second.group   = k.second.first;
-                    it->second.group_r = k.second.second;
-                    continue;
-                } else if (r_outlet_type.match(k.first)) {
-                    auto oNumber = getOutletNumber(k.first);
-                    auto it      = outlets.find(oNumber);
-                    if (it == outlets.cend()) {
-                        auto r1 = outlets.emplace(oNumber, Outlet());
-                        it     = r1.first;
-                    }
-                    it->second.type   = k.second.first;
-                    it->second.type_r = k.second.second;
-                    continue;
-                }
-                // for ups programmable outlet
-                else if (r_outlet_switchable.match(k.first))
-                {
-                    auto oNumber = getOutletNumber(k.first);
-                    auto it = outlets.find(oNumber);
-                    if (it == outlets.cend())
-                    {
-                        outlets.emplace(oNumber, Outlet());
-                    }
-                }
-                // for ups master outlet
-                else if (k.first == "outlet.switchable") {
-                    auto it = outlets.find("0");
-                    if (it == outlets.cend())
-                    {
-                        outlets.emplace("0", Outlet());
-                    }
-                }
-                else if (k.first == "outlet.label") {
-                    auto it = outlets.find("0");
-                    if (it == outlets.cend())
-                    {
-                        auto r1 = outlets.emplace("0", Outlet());
-                        it = r1.first;
-                    }
-                    it->second.label = k.second.first;
-                    it->second.label_r = k.second.second;
-                }
-                // print valid info
-                cxxtools::SerializationInfo& si_ext_obj = si_asset_ext_list.addMember("");
-                si_ext_obj.addMember(k.first) <<= k.second.first;
-                si_ext_obj.addMember("read_only") <<= k.second.second;
-            }
-        }
+    int rv = DBAssets::select_asset_element_all(conn, process_v_web_asset_element_row_json);
+    if (rv != 0)
+        throw std::runtime_error(msg.c_str());
 
-        // Print Ips
-        cxxtools::SerializationInfo& si_ips_list = si_asset.addMember("ips");
-        si_ips_list.setCategory(cxxtools::SerializationInfo::Category::Array);
-        for (const auto& k : ext_attrs) {
-            if (k.first.compare(0, t_ip.length(), t_ip) == 0) {
-                si_ips_list.addMember("") <<= k.second.first;
-            }
+    // assets changed and tombstones of assets deleted since, unless the id was reused by a new asset
+    std::unordered_set<a_elmnt_id_t> changed;
+    std::vector<AssetTombstone>      tombstones;
+    if (since > 0) {
+        try {
+            changed    = select_changed_assets(conn, *all, since);
+            tombstones = select_asset_tombstones(conn, since);
+        } catch (const std::exception& e) {
+            log_error("%s: %s", msg.c_str(), e.what());
+            throw std::runtime_error(msg.c_str());
         }
+        auto reused = [&assets](const AssetTombstone& tombstone) {
+            return assets.count(tombstone.id) > 0;
+        };
+        tombstones.erase(std::remove_if(tombstones.begin(), tombstones.end(), reused), tombstones.end());
+    }
+    transaction.commit();
 
-        // Print outlets
-        if (!outlets.empty()) {
-            cxxtools::SerializationInfo& si_outlets = si_asset.addMember("outlets");
-            for (auto& oneOutlet : outlets) {
-                cxxtools::SerializationInfo& si_outlet_x = si_outlets.addMember(oneOutlet.first);
-                si_outlet_x.setCategory(cxxtools::SerializationInfo::Category::Array);
-
-                cxxtools::SerializationInfo& si_outlet_label = si_outlet_x.addMember("");
-                si_outlet_label.addMember("name") <<= "label";
-                // if label is empty, get index value
-                if(!oneOutlet.second.label.empty()) {
-                    si_outlet_label.addMember("value") <<= oneOutlet.second.label;
-                    si_outlet_label.addMember("read_only") <<= oneOutlet.second.label_r;
-                }
-                else {
-                    si_outlet_label.addMember("value") <<= oneOutlet.first;
-                    si_outlet_label.addMember("read_only") <<= true;
-                }
-
-                if (!oneOutlet.second.group.empty()) {
-                    cxxtools::SerializationInfo& si_outlet_group = si_outlet_x.addMember("");
-                    si_outlet_group.addMember("name") <<= "group";
-                    si_outlet_group.addMember("value") <<= oneOutlet.second.group;
-                    si_outlet_group.addMember("read_only") <<= oneOutlet.second.group_r;
-                }
-
-                if (!oneOutlet.second.type.empty()) {
-                    cxxtools::SerializationInfo& si_outlet_type = si_outlet_x.addMember("");
-                    si_outlet_type.addMember("name") <<= "type";
-                    si_outlet_type.addMember("value") <<= oneOutlet.second.type;
-                    si_outlet_type.addMember("read_only") <<= oneOutlet.second.type_r;
-                }
+    for (const auto& it : assets) {
+        if (listElements == NULL || listElements->count(it.second.name) == 0)
+            continue;
+        // incremental export, skip assets not changed since
+        if (since > 0 && changed.count(it.first) == 0)
+            continue;
+        selected.push_back(&it.second);
+    }
+    std::sort(selected.begin(), selected.end(), [](const JsonAsset* a, const JsonAsset* b) {
+        return a->id < b->id;
+    });
+
+    // 3. serialize shards of consecutive ids in parallel, the first one in this thread
+    size_t count = selected.size();
+    workers      = std::max<size_t>(1, std::min(workers, (count + MIN_SHARD_SIZE - 1) / MIN_SHARD_SIZE));
+
+    std::vector<std::string>        shards(workers);
+    std::vector<std::exception_ptr> errors(workers);
+    auto                            serialize_shard = [&](size_t shard) {
+        try {
+            size_t            begin = count * shard / workers;
+            size_t            end   = count * (shard + 1) / workers;
+            // elements of the array, merged by JsonWriter::elements()
+            utils::JsonWriter w(shards[shard]);
+            for (size_t i = begin; i != end; ++i) {
+                s_asset_json(w, *selected[i], assets, *all);
             }
+        } catch (...) {
+            errors[shard] = std::current_exception();
         }
     };
 
-    int rv = DBAssets::select_asset_element_all(conn, process_v_web_asset_element_row_json);
-    if (rv != 0)
-        throw std::runtime_error(msg.c_str());
+    std::vector<std::thread> threads;
+    for (size_t shard = 1; shard < workers; ++shard) {
+        threads.emplace_back(serialize_shard, shard);
+    }
+    serialize_shard(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
 
-    serializer.serialize(si).finish();
-    transaction.commit();
+    // 4. merge shards in id order
+    utils::JsonWriter w(out);
+    w.beginArray();
+    for (auto& shard : shards) {
+        w.elements(shard);
+        std::string().swap(shard);
+    }
+    for (const auto& tombstone : tombstones) {
+        w.beginObject();
+        w.member("id", tombstone.name);
+        w.member("name", tombstone.ext_name);
+        w.member("status", "deleted");
+        w.endObject();
+    }
+    w.endArray();
+    if (!w.flush())
+        throw std::runtime_error(TRANSLATE_ME("cannot write json"));
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    log_info(
+        "%zu assets (%zu deleted) exported to json by %zu workers in %" PRIi64 " ms", count + tombstones.size(),
+        tombstones.size(), workers, int64_t(elapsed.count()));
 }
 
 } // namespace persist
@@ -0,0 +1,305 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file import_jobs.cc
+ * \brief Csv import running as a background job
+ */
+#include "db/import_jobs.h"
+#include "shared/configure_inform.h"
+#include "shared/json_writer.h"
+#include <algorithm>
+#include <fty_common.h>
+#include <fty_common_macros.h>
+#include <fty_common_mlm_utils.h>
+#include <fty_log.h>
+#include <sstream>
+
+namespace persist {
+
+static const char* s_state(ImportJobs::State state)
+{
+    switch (state) {
+        case ImportJobs::State::QUEUED:
+            return "queued";
+        case ImportJobs::State::RUNNING:
+            return "running";
+        case ImportJobs::State::DONE:
+            return "done";
+        case ImportJobs::State::FAILED:
+            return "failed";
+    }
+    return "unknown";
+}
+
+ImportJobs& ImportJobs::instance()
+{
+    static ImportJobs jobs;
+    return jobs;
+}
+
+ImportJobs::~ImportJobs()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _queue.clear();
+        _queuedBytes = 0;
+    }
+    _cond.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+std::string ImportJobs::start(std::string csv, const std::string& user, bool skip_unchanged, size_t chunk_size)
+{
+    auto     job  = std::make_shared<Job>();
+    zuuid_t* uuid = zuuid_new();
+    job->status.id = zuuid_str_canonical(uuid);
+    zuuid_destroy(&uuid);
+    job->status.user = user;
+    job->csv            = std::move(csv);
+    job->skip_unchanged = skip_unchanged;
+    job->chunk_size     = chunk_size;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_queue.size() >= IMPORT_JOBS_MAX_QUEUED ||
+        (!_queue.empty() && _queuedBytes + job->csv.size() > IMPORT_JOBS_MAX_QUEUED_BYTES)) {
+        log_warning("import job of user '%s' refused, %zu jobs (%zu bytes) already queued", user.c_str(),
+            _queue.size(), _queuedBytes);
+        return "";
+    }
+    if (_workers.empty()) {
+        for (int i = 0; i != CSV_IMPORT_WORKERS; ++i) {
+            _workers.emplace_back(&ImportJobs::work, this);
+        }
+    }
+    _jobs.emplace(job->status.id, job);
+    _queue.push_back(job);
+    _queuedBytes += job->csv.size();
+    _cond.notify_one();
+    log_info("import job %s of user '%s' queued (%zu bytes)", job->status.id.c_str(), user.c_str(), job->csv.size());
+    return job->status.id;
+}
+
+bool ImportJobs::status(const std::string& id, Status& status) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto                        it = _jobs.find(id);
+    if (it == _jobs.end()) {
+        return false;
+    }
+    status = it->second->status;
+    return true;
+}
+
+std::string ImportJobs::json(const Status& status, bool withErrors)
+{
+    std::string      json;
+    utils::JsonWriter w(json);
+    w.beginObject()
+        .member("id", status.id)
+        .member("state", s_state(status.state))
+        .member("rows_total", int64_t(status.rows_total))
+        .member("rows_done", int64_t(status.rows_done))
+        .member("rows_failed", int64_t(status.rows_failed));
+    if (status.eta < 0) {
+        w.key("eta").null();
+    } else {
+        w.member("eta", status.eta);
+    }
+    if (status.state == State::FAILED) {
+        w.member("error", status.error);
+    }
+    if (status.state == State::DONE) {
+        // same members as the synchronous import reply
+        w.member("imported_lines", int64_t(status.imported));
+        w.member("inserted", int64_t(status.stats.inserted))
+            .member("updated", int64_t(status.stats.updated))
+            .member("unchanged", int64_t(status.stats.unchanged));
+        if (!status.publish_error.empty()) {
+            w.member("publish_error", status.publish_error);
+        }
+        if (withErrors) {
+            w.key("errors").beginArray();
+            for (const auto& row : status.failRows) {
+                w.beginArray().value(row.first).value(row.second).endArray();
+            }
+            w.endArray();
+        }
+    }
+    w.endObject();
+    return json;
+}
+
+void ImportJobs::work()
+{
+    mlm_client_t* client      = mlm_client_new();
+    std::string   client_name = utils::generate_mlm_client_id("web.asset_import");
+    if (!client || mlm_client_connect(client, MLM_ENDPOINT, 1000, client_name.c_str()) == -1 ||
+        mlm_client_set_producer(client, "SSE") == -1) {
+        log_warning("asset import: cannot produce on SSE stream, progress is available by polling only");
+        mlm_client_destroy(&client);
+    }
+
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this]() {
+                return _stop || !_queue.empty();
+            });
+            if (_stop) {
+                break;
+            }
+            job = _queue.front();
+            _queue.pop_front();
+            _queuedBytes -= job->csv.size();
+            job->status.state = State::RUNNING;
+            job->started      = std::chrono::steady_clock::now();
+        }
+        run(*job, client);
+    }
+    mlm_client_destroy(&client);
+}
+
+void ImportJobs::run(Job& job, mlm_client_t* client)
+{
+    log_info("import job %s started", job.status.id.c_str());
+
+    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>> okRows;
+    std::map<int, std::string>                                     failRows;
+    ImportStats                                                    stats;
+    try {
+        // the worker is the only one touching csv of a running job, it is read from the stream from now on
+        std::istringstream input(job.csv);
+        std::string().swap(job.csv);
+        publish(client, job, true);
+
+        load_asset_csv(
+            input, okRows, failRows,
+            [&]() {
+                progress(job, stats.rows, okRows.size() + stats.unchanged, failRows.size());
+                publish(client, job, false);
+            },
+            job.status.user, job.chunk_size, job.skip_unchanged, &stats);
+    } catch (const std::exception& e) {
+        log_error("import job %s failed: %s", job.status.id.c_str(), e.what());
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            job.status.error = e.what();
+        }
+        finish(job, State::FAILED);
+        publish(client, job, true);
+        return;
+    }
+
+    // load_asset_csv() does not publish, agents learn about the assets from us
+    std::string publish_error;
+    std::string agent_name = utils::generate_mlm_client_id("web.asset_import");
+    for (size_t begin = 0; begin < okRows.size(); begin += IMPORT_JOBS_PUBLISH_BATCH) {
+        size_t end = std::min(okRows.size(), begin + IMPORT_JOBS_PUBLISH_BATCH);
+        try {
+            send_configure(
+                std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>(
+                    okRows.begin() + ptrdiff_t(begin), okRows.begin() + ptrdiff_t(end)),
+                agent_name);
+        } catch (const std::exception& e) {
+            log_error(
+                "import job %s: publishing of rows %zu-%zu of %zu imported failed: %s", job.status.id.c_str(), begin,
+                end, okRows.size(), e.what());
+            publish_error = TRANSLATE_ME(
+                "%zu of %zu imported assets were not published: %s", okRows.size() - begin, okRows.size(), e.what());
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        job.status.imported      = okRows.size();
+        job.status.stats         = stats;
+        job.status.rows_done     = okRows.size() + stats.unchanged + failRows.size();
+        job.status.rows_failed   = failRows.size();
+        job.status.failRows      = std::move(failRows);
+        job.status.publish_error = publish_error;
+    }
+    finish(job, State::DONE);
+    publish(client, job, true);
+    log_info(
+        "import job %s done: %zu rows imported, %zu failed", job.status.id.c_str(), job.status.imported,
+        job.status.rows_failed);
+}
+
+void ImportJobs::progress(Job& job, size_t total, size_t ok, size_t failed)
+{
+    auto elapsed = std::chrono::steady_clock::now() - job.started;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    job.status.rows_total  = total;
+    job.status.rows_done   = ok + failed;
+    job.status.rows_failed = failed;
+    if (job.status.rows_done != 0 && job.status.rows_done <= job.status.rows_total) {
+        auto ms        = int64_t(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        auto remaining = int64_t(job.status.rows_total - job.status.rows_done);
+        job.status.eta = ms * remaining / int64_t(job.status.rows_done) / 1000;
+    }
+}
+
+void ImportJobs::finish(Job& job, State state)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    job.status.state = state;
+    job.status.eta   = 0;
+    _finished.push_back(job.status.id);
+    while (_finished.size() > IMPORT_JOBS_KEEP) {
+        _jobs.erase(_finished.front());
+        _finished.pop_front();
+    }
+}
+
+void ImportJobs::publish(mlm_client_t* client, Job& job, bool force)
+{
+    if (!client) {
+        return;
+    }
+
+    auto        now = std::chrono::steady_clock::now();
+    std::string payload;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!force && now - job.published < std::chrono::seconds(1)) {
+            return;
+        }
+        job.published = now;
+        payload       = json(job.status, false);
+    }
+
+    // topic, payload, asset (empty: visible in every datacenter)
+    zmsg_t* msg = zmsg_new();
+    zmsg_addstr(msg, IMPORT_JOBS_SSE_TOPIC);
+    zmsg_addstr(msg, payload.c_str());
+    zmsg_addstr(msg, "");
+    if (mlm_client_send(client, "SSE", &msg) != 0) {
+        log_warning("import job %s: cannot publish progress", job.status.id.c_str());
+    }
+}
+
+} // namespace persist
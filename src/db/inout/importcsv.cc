@@ -25,28 +25,39 @@
 */
 
 #include "cleanup.h"
+#include "db/asset_bulk.h"
+#include "db/asset_element_select.h"
 #include "db/asset_general.h"
+#include "db/asset_names.h"
+#include "db/connection_pool.h"
+#include "db/import_plan.h"
 #include "db/dbhelpers.h"
 #include "db/inout.h"
 #include "persist/assetcrud.h"
+#include "shared/asset_watcher.h"
+#include "shared/csv_reader.h"
 #include "shared/utils.h"
 #include "shared/utils_json.h"
 #include "shared/utilspp.h"
 #include <algorithm>
 #include <cstddef>
 #include <ctype.h>
+#include <exception>
 #include <fty/string-utils.h>
 #include <fty_asset_activator.h>
 #include <fty_common_db.h>
-#include <fty_common_db_dbpath.h>
 #include <fty_common_mlm_pool.h>
 #include <fty_common_mlm_sync_client.h>
 #include <fty_common_rest.h>
 #include <fty_proto.h>
 #include <limits>
+#include <memory>
+#include <numeric>
 #include <regex>
 #include <string>
-#include <tntdb/connect.h>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 
 
@@ -528,15 +539,51 @@ int promote_rc0(MlmClient* client, const CsvMap& cm, touch_cb_t touch_fn)
 }
 
 
+/*
+ * \brief Name resolution by names loaded for the import, or by database if not loaded
+ */
+static int s_extname_to_name(const AssetNames* names, const std::string& ext_name, std::string& name)
+{
+    return names ? names->extname_to_name(ext_name, name) : DBAssets::extname_to_asset_name(ext_name, name);
+}
+
+static db_reply<db_a_elmnt_t> s_select_by_name(
+    tntdb::Connection& conn, const AssetNames* names, const std::string& element_name)
+{
+    if (!names) {
+        return select_asset_element_by_name(conn, element_name.c_str());
+    }
+
+    // only id is used by the import
+    db_a_elmnt_t           item{0, "", "", 0, 5, 0, 0, ""};
+    db_reply<db_a_elmnt_t> ret = db_reply_new(item);
+    int64_t                id  = names->find(element_name);
+    if (id == -1) {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_NOTFOUND;
+        ret.msg        = TRANSLATE_ME("element with specified name was not found");
+    } else {
+        ret.status    = 1;
+        ret.item.id   = a_elmnt_id_t(id);
+        ret.item.name = element_name;
+    }
+    return ret;
+}
+
+
 /*
  * \brief Replace user defined names with internal names
+ *
+ * Names are resolved by names if given, otherwise by database.
  */
-std::map<std::string, std::string> sanitize_row_ext_names(const CsvMap& cm, size_t row_i, bool sanitize)
+std::map<std::string, std::string> sanitize_row_ext_names(
+    const CsvMap& cm, size_t row_i, bool sanitize, const AssetNames* names = nullptr)
 {
     std::map<std::string, std::string> result;
     // make copy of this one line
-    for (auto title : cm.getTitles()) {
-        result[title] = cm.get(row_i, title);
+    for (const auto& it : cm.columns()) {
+        result.emplace_hint(result.end(), it.first, cm.get(row_i, it.second));
     }
     if (sanitize) {
         // sanitize ext names to t_bios_asset_element.name
@@ -551,7 +598,7 @@ std::map<std::string, std::string> sanitize_row_ext_names(const CsvMap& cm, size
                         break;
 
                     std::string name;
-                    int         rv = DBAssets::extname_to_asset_name(it->second, name);
+                    int         rv = s_extname_to_name(names, it->second, name);
                     if (rv != 0) {
                         name = it->second;
                     }
@@ -563,7 +610,7 @@ std::map<std::string, std::string> sanitize_row_ext_names(const CsvMap& cm, size
                 auto it = result.find(item);
                 if (it != result.end()) {
                     std::string name;
-                    int         rv = DBAssets::extname_to_asset_name(it->second, name);
+                    int         rv = s_extname_to_name(names, it->second, name);
                     if (rv != 0) {
                         name = it->second;
                     }
@@ -640,34 +687,426 @@ void get_licensing_limitation(LIMITATIONS_STRUCT& limitations)
 }
 
 
+/*
+ * \brief Row of csv file checked and normalized without database access
+ */
+struct CheckedRow
+{
+    // first error of the row, rethrown when the row is processed
+    std::exception_ptr error;
+
+    std::string ename;
+    std::string type;
+    int         type_id = 0;
+    std::string status;
+    std::string asset_tag;
+    int         priority = 5;
+    std::string subtype;
+    int         subtype_id = 0;
+    // external attributes in column order, values normalized, empty ones dropped
+    std::vector<std::pair<std::string, std::string>> ext;
+};
+
+
+/*
+ * \brief Checks of a row, which need neither the database nor other rows
+ *
+ * Dictionaries and the column layout are prepared once per file, not once
+ * per row.
+ */
+class RowChecker
+{
+public:
+    RowChecker(
+        const CsvMap& cm, const std::map<std::string, int>& TYPES, const std::map<std::string, int>& SUBTYPES);
+
+    CheckedRow check(size_t row_i) const;
+
+    int rack_controller_id() const
+    {
+        return _rack_controller_id;
+    }
+
+private:
+    void fill(size_t row_i, CheckedRow& row) const;
+
+    const CsvMap&                     _cm;
+    const std::map<std::string, int>& _types;
+    const std::map<std::string, int>& _subtypes;
+    // _subtypes with the aliases
+    std::map<std::string, int> _local_subtypes;
+    int                        _rack_controller_id;
+
+    CsvMap::Column _name, _type, _status, _asset_tag, _priority, _sub_type;
+    // columns which are stored as external attributes
+    std::vector<std::pair<std::string, CsvMap::Column>> _ext_columns;
+};
+
+RowChecker::RowChecker(
+    const CsvMap& cm, const std::map<std::string, int>& TYPES, const std::map<std::string, int>& SUBTYPES)
+    : _cm(cm)
+    , _types(TYPES)
+    , _subtypes(SUBTYPES)
+    , _local_subtypes(SUBTYPES)
+    , _rack_controller_id(SUBTYPES.find("rack controller")->second)
+{
+    // Business requirement: be able to write 'rack controller', 'RC', 'rc' as subtype == 'rack controller'
+    int patch_panel_id = SUBTYPES.find("patch panel")->second;
+
+    _local_subtypes.emplace(std::make_pair("rackcontroller", _rack_controller_id));
+    _local_subtypes.emplace(std::make_pair("rackcontroler", _rack_controller_id));
+    _local_subtypes.emplace(std::make_pair("rc", _rack_controller_id));
+    _local_subtypes.emplace(std::make_pair("RC", _rack_controller_id));
+    _local_subtypes.emplace(std::make_pair("RC3", _rack_controller_id));
+
+    _local_subtypes.emplace(std::make_pair("patchpanel", patch_panel_id));
+
+    _name      = _cm.column("name");
+    _type      = _cm.column("type");
+    _status    = _cm.column("status");
+    _asset_tag = _cm.column("asset_tag");
+    _priority  = _cm.column("priority");
+    _sub_type  = _cm.column("sub_type");
+
+    // everything but the columns with a meaning is an external attribute
+    auto unused_columns = _cm.columns();
+    static const char* KNOWN[] = {
+        "create_mode", "id", "name", "type", "status", "asset_tag", "priority", "location", "sub_type"};
+    for (auto column : KNOWN) {
+        unused_columns.erase(column);
+    }
+    for (int i = 1; unused_columns.erase("group." + std::to_string(i)) == 1; ++i) {
+    }
+    for (int i = 1; unused_columns.erase("power_source." + std::to_string(i)) == 1; ++i) {
+        unused_columns.erase("power_plug_src." + std::to_string(i));
+        unused_columns.erase("power_input." + std::to_string(i));
+    }
+    _ext_columns.assign(unused_columns.begin(), unused_columns.end());
+}
+
+CheckedRow RowChecker::check(size_t row_i) const
+{
+    CheckedRow row;
+    try {
+        fill(row_i, row);
+    } catch (...) {
+        row.error = std::current_exception();
+    }
+    return row;
+}
+
+void RowChecker::fill(size_t row_i, CheckedRow& row) const
+{
+    static const std::set<std::string> STATUSES = {"active", "nonactive", "spare", "retired"};
+
+    row.ename = _cm.get(row_i, _name);
+    if (row.ename.empty()) {
+        std::string received = TRANSLATE_ME("empty value");
+        std::string expected = TRANSLATE_ME("unique, non empty value");
+        bios_throw("request-param-bad", "name", received.c_str(), expected.c_str());
+    }
+    if (row.ename.length() > 50) {
+        std::string received = TRANSLATE_ME("too long string");
+        std::string expected = TRANSLATE_ME("unique string from 1 to 50 characters");
+        bios_throw("request-param-bad", "name", received.c_str(), expected.c_str());
+    }
+
+    row.type = _cm.get_strip(row_i, _type);
+    log_debug("type = '%s'", row.type.c_str());
+    auto type = _types.find(row.type);
+    if (type == _types.end()) {
+        std::string received = row.type.empty() ? TRANSLATE_ME("empty value") : JSONIFY(row.type.c_str());
+        std::string expected = JSONIFY(utils::join_keys_map(_types, ", ").c_str());
+        bios_throw("request-param-bad", "type", received.c_str(), expected.c_str());
+    }
+    row.type_id = type->second;
+
+    row.status = _cm.get_strip(row_i, _status);
+    log_debug("status = '%s'", row.status.c_str());
+    if (STATUSES.find(row.status) == STATUSES.end()) {
+        std::string received = row.status.empty() ? TRANSLATE_ME("empty value") : JSONIFY(row.status.c_str());
+        std::string expected = JSONIFY(fty::implode(STATUSES, ", ").c_str());
+        bios_throw("request-param-bad", "status", received.c_str(), expected.c_str());
+    }
+
+    row.asset_tag = _asset_tag.valid() ? _cm.get(row_i, _asset_tag) : "";
+    log_debug("asset_tag = '%s'", row.asset_tag.c_str());
+    if (row.asset_tag.length() > 50) {
+        std::string received = TRANSLATE_ME("too long string");
+        std::string expected = TRANSLATE_ME("unique string from 1 to 50 characters");
+        bios_throw("request-param-bad", "asset_tag", received.c_str(), expected.c_str());
+    }
+
+    row.priority = get_priority(_cm.get_strip(row_i, _priority));
+    log_debug("priority = %d", row.priority);
+
+    row.subtype = _cm.get_strip(row_i, _sub_type);
+    log_debug("subtype = '%s'", row.subtype.c_str());
+    if ((row.type == "device") && (_local_subtypes.find(row.subtype) == _local_subtypes.cend())) {
+        std::string received = row.subtype.empty() ? TRANSLATE_ME("empty value") : JSONIFY(row.subtype.c_str());
+        std::string expected = JSONIFY(utils::join_keys_map(_subtypes, ", ").c_str());
+        bios_throw("request-param-bad", "subtype", received.c_str(), expected.c_str());
+    }
+
+    if ((!row.subtype.empty()) && (row.type != "device") && (row.type != "group")) {
+        log_warning("'%s' - subtype is ignored", row.subtype.c_str());
+    }
+
+    if ((row.subtype.empty()) && (row.type == "group")) {
+        std::string expected = TRANSLATE_ME("subtype (for type group)");
+        bios_throw("request-param-required", expected.c_str());
+    }
+
+    row.subtype_id = _local_subtypes.find(row.subtype)->second;
+
+    for (const auto& column : _ext_columns) {
+        const std::string& key = column.first;
+        // try is not needed, because here are keys that are definitely there
+        std::string value = _cm.get(row_i, column.second);
+
+        // BIOS-1564: sanitize the date for warranty_end -- start
+        if (is_date(key) && !value.empty()) {
+            char* date = sanitize_date(value.c_str());
+            if (!date) {
+                log_info("Cannot sanitize %s '%s' for device '%s'", key.c_str(), value.c_str(), row.ename.c_str());
+                std::string expected = TRANSLATE_ME("ISO date");
+                bios_throw("request-param-bad", key.c_str(), value.c_str(), expected.c_str());
+            }
+            if (date) {
+                value = date;
+                zstr_free(&date);
+            }
+        }
+        // BIOS-1564 -- end
+
+        // BIOS-2302: Check some attributes for sensors
+        // BIOS-2784: Check max_current, max_power
+        // logical_asset needs names, it is checked by process_row()
+        if ((key == "calibration_offset_t" || key == "calibration_offset_h") && !value.empty()) {
+            // we want exceptions to propagate to upper layer
+            sanitize_value_double(key, value);
+        } else if ((key == "max_current" || key == "max_power") && !value.empty()) {
+            // we want exceptions to propagate to upper layer
+            double d_value = sanitize_value_double(key, value);
+            if (d_value < 0) {
+                log_info("Extattribute: %s='%s' is neither positive not zero", key.c_str(), value.c_str());
+                std::string expected = TRANSLATE_ME("value must be a not negative number");
+                bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
+            }
+        }
+        // BIOS-2781
+        if (key == "location_u_pos" && !value.empty()) {
+            unsigned long ul = 0;
+            try {
+                std::size_t pos = 0;
+                ul              = std::stoul(value, &pos);
+                if (pos != value.length()) {
+                    log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
+                    std::string expected = TRANSLATE_ME("value must be an unsigned integer");
+                    bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
+                }
+            } catch (const std::exception& e) {
+                log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
+                std::string expected = TRANSLATE_ME("value must be an unsigned integer");
+                bios_throw("request-param-bad", "location_u_pos", ("'" + value + "'").c_str(), expected.c_str());
+            }
+            if (ul == 0 || ul > 52) {
+                std::string expected = TRANSLATE_ME("value must be between <1, 52>.");
+                bios_throw("request-param-bad", "location_u_pos", ("'" + value + "'").c_str(), expected.c_str());
+            }
+        }
+        // BIOS-2799
+        if (key == "u_size" && !value.empty()) {
+            unsigned long ul = 0;
+            try {
+                std::size_t pos = 0;
+                ul              = std::stoul(value, &pos);
+                if (pos != value.length()) {
+                    log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
+                    std::string expected = TRANSLATE_ME("value must be an unsigned integer");
+                    bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
+                }
+            } catch (const std::exception& e) {
+                log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
+                std::string expected = TRANSLATE_ME("value must be an unsigned integer");
+                bios_throw("request-param-bad", "u_size", ("'" + value + "'").c_str(), expected.c_str());
+            }
+            if (ul == 0 || ul > 52) {
+                std::string expected = TRANSLATE_ME("value must be between <1, 52>.");
+                bios_throw("request-param-bad", "u_size", ("'" + value + "'").c_str(), expected.c_str());
+            }
+        }
+
+        if (match_ext_attr(value, key)) {
+            // ACE: temporary disabled
+            // for testing purposes for rabobank usecase
+            // IMHO: There is no sense to check it at all
+            //   * as we cannot guarantee that manufacturers in the whole world use UNIQUE serial numbers
+            //   * not unique serial number of the device should not forbid users to monitor their devices
+            /*
+            if ( key == "serial_no" )
+            {
+
+                if  ( unique_keytag (conn, key, value, id) == 0 )
+                    zhash_insert (extattributes, key.c_str(), (void*)value.c_str());
+                else
+                {
+                    bios_throw("request-param-bad", "serial_no", value.c_str(), "<unique string>");
+                }
+                continue;
+            }
+            */
+            row.ext.emplace_back(key, std::move(value));
+        }
+    }
+}
+
+
+/*
+ * \brief Checks all data rows of csv file
+ *
+ * \return checked rows indexed by row number, row 0 (titles) is left empty
+ */
+static std::vector<CheckedRow> check_rows(const CsvMap& cm, const RowChecker& checker)
+{
+    std::vector<CheckedRow> checked(cm.rows());
+    for (size_t row_i = 1; row_i < cm.rows(); ++row_i) {
+        checked[row_i] = checker.check(row_i);
+    }
+    return checked;
+}
+
+
+/*
+ * \brief New assets inserted by one chunk of bulk import
+ */
+struct BulkChunk
+{
+    explicit BulkChunk(tntdb::Connection& conn)
+        : writer(conn)
+    {
+    }
+
+    AssetBulkInsert writer;
+    // rows of the chunk with their results, reported once the chunk is committed
+    std::vector<std::pair<size_t, std::pair<db_a_elmnt_t, persist::asset_operation>>> rows;
+    // devices to activate once the chunk is committed
+    std::set<a_elmnt_id_t> activate;
+};
+
+
+/*
+ * \brief Stored state of assets updated by the import, by id
+ */
+using CurrentAssets = std::map<a_elmnt_id_t, db_web_element_t>;
+
+
+/*
+ * \brief Fields of the stored asset, which would be changed by the update
+ *
+ * Read-only ext attributes (update_ts, update_user, ...) are not compared,
+ * they are only a consequence of the update. Nor are ext attributes in
+ * ignored, which are left out of extattributes (hardware attributes of
+ * rackcontroller-0).
+ *
+ * \return names of changed fields, empty if the row matches the stored asset
+ */
+static std::vector<std::string> s_changed_fields(
+    const db_web_element_t&       current,
+    a_elmnt_id_t                  parent_id,
+    const std::string&            status,
+    int                           priority,
+    const std::string&            asset_tag,
+    zhash_t*                      extattributes,
+    const std::set<a_elmnt_id_t>& groups,
+    const std::vector<link_t>&    links,
+    const std::set<std::string>&  ignored)
+{
+    std::vector<std::string> changed;
+    if (current.basic.parent_id != parent_id) {
+        changed.push_back("location");
+    }
+    if (current.basic.status != status) {
+        changed.push_back("status");
+    }
+    if (current.basic.priority != priority) {
+        changed.push_back("priority");
+    }
+    if (current.basic.asset_tag != asset_tag) {
+        changed.push_back("asset_tag");
+    }
+
+    std::map<std::string, std::string> stored_ext, new_ext;
+    for (const auto& attr : current.ext) {
+        if (!attr.second.second && ignored.count(attr.first) == 0) {
+            stored_ext.emplace(attr.first, attr.second.first);
+        }
+    }
+    for (void* it = zhash_first(extattributes); it != NULL; it = zhash_next(extattributes)) {
+        new_ext.emplace(zhash_cursor(extattributes), static_cast<const char*>(it));
+    }
+    if (stored_ext != new_ext) {
+        changed.push_back("ext attributes");
+    }
+
+    std::set<a_elmnt_id_t> stored_groups;
+    for (const auto& group : current.groups) {
+        stored_groups.insert(group.first);
+    }
+    if (stored_groups != groups) {
+        changed.push_back("groups");
+    }
+
+    // both are empty for other types than device
+    std::set<std::tuple<a_elmnt_id_t, std::string, std::string>> stored_links, new_links;
+    for (const auto& link : current.powers) {
+        stored_links.emplace(link.src_id, link.src_socket, link.dest_socket);
+    }
+    for (const auto& link : links) {
+        new_links.emplace(link.src, link.src_out ? link.src_out : "", link.dest_in ? link.dest_in : "");
+    }
+    if (stored_links != new_links) {
+        changed.push_back("power sources");
+    }
+    return changed;
+}
+
+
 /*
  * \brief Processes a single row from csv file
  *
  * \param[in] conn     - a connection to DB
  * \param[in] cm       - already parsed csv file
  * \param[in] row_i    - number of row to process
- * \param[in] TYPES    - list of available types
- * \param[in] SUBTYPES - list of available subtypes
+ * \param[in] checker  - checker of the csv file
+ * \param[in] checked  - the row checked by checker
  * \param[in][out] ids - list of already seen asset ids
+ * \param[in][out] names - if set, names are resolved by it and it's updated by the row
+ * \param[in][out] chunk - if set, new asset is inserted into this chunk (requires names)
+ * \param[in] current  - if set, an update equal to the stored asset is not written
+ * \param[out] unchanged - set to true if the update was not written (requires current)
  *
  */
 static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
-    tntdb::Connection&                conn,
-    const CsvMap&                     cm,
-    size_t                            row_i,
-    const std::map<std::string, int>& TYPES,
-    const std::map<std::string, int>& SUBTYPES,
-    std::set<a_elmnt_id_t>&           ids,
-    bool                              sanitize,
-    size_t                            rc_0,
-    LIMITATIONS_STRUCT                limitations,
-    std::string&                      warningMessages)
+    tntdb::Connection&      conn,
+    const CsvMap&           cm,
+    size_t                  row_i,
+    const RowChecker&       checker,
+    const CheckedRow&       checked,
+    std::set<a_elmnt_id_t>& ids,
+    bool                    sanitize,
+    size_t                  rc_0,
+    LIMITATIONS_STRUCT      limitations,
+    std::string&            warningMessages,
+    AssetNames*             names     = nullptr,
+    BulkChunk*              chunk     = nullptr,
+    const CurrentAssets*    current   = nullptr,
+    bool*                   unchanged = nullptr)
 {
     LOG_START;
     warningMessages = "";
 
     log_debug("################ Row number is %zu", row_i);
-    static const std::set<std::string> STATUSES = {"active", "nonactive", "spare", "retired"};
 
     if (0 == limitations.global_configurability) {
         std::string action = TRANSLATE_ME("Asset handling");
@@ -676,24 +1115,15 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
     }
 
     // get location, powersource etc as name from ext.name
-    auto sanitizedAssetNames = sanitize_row_ext_names(cm, row_i, sanitize);
-
-    // This is used to track, which columns had been already processed,
-    // because if they was't processed yet,
-    // then they should be treated as external attributes
-    auto unused_columns = cm.getTitles();
+    auto sanitizedAssetNames = sanitize_row_ext_names(cm, row_i, sanitize, names);
 
-    if (unused_columns.empty()) {
+    const auto& columns = cm.columns();
+    if (columns.empty()) {
         std::string err = TRANSLATE_ME("Cannot import empty document.");
         bios_throw("bad-request-document", err.c_str());
     }
 
-    // remove the column 'create_mode' which is set to a different value anyway
-    if (unused_columns.count("create_mode"))
-        unused_columns.erase("create_mode");
-
-    // because id is definitely not an external attribute
-    auto id_str = unused_columns.count("id") ? cm.get(row_i, "id") : "";
+    auto id_str = columns.count("id") ? cm.get(row_i, columns.at("id")) : "";
     log_debug("id_str = %s, rc_0 = %d", id_str.c_str(), rc_0);
     if (rc_0 != row_i && "rackcontroller-0" == id_str && rc_0 != std::numeric_limits<std::size_t>::max()) {
         // we got RC-0 but it don't match "myself", change it to something else ("")
@@ -704,11 +1134,10 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         id_str = "rackcontroller-0";
     }
 
-    unused_columns.erase("id");
     persist::asset_operation operation = persist::asset_operation::INSERT;
     int64_t                  id        = 0;
     if (!id_str.empty()) {
-        id = DBAssets::name_to_asset_id(id_str);
+        id = names ? names->name_to_id(id_str) : DBAssets::name_to_asset_id(id_str);
         if (id == -1) {
             bios_throw("element-not-found", id_str.c_str());
         }
@@ -723,19 +1152,14 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         operation = persist::asset_operation::UPDATE;
     }
 
-    auto ename = cm.get(row_i, "name");
-    if (ename.empty()) {
-        std::string received = TRANSLATE_ME("empty value");
-        std::string expected = TRANSLATE_ME("unique, non empty value");
-        bios_throw("request-param-bad", "name", received.c_str(), expected.c_str());
+    // name, type, status, subtype and the format of values were checked by checker
+    if (checked.error) {
+        std::rethrow_exception(checked.error);
     }
-    if (ename.length() > 50) {
-        std::string received = TRANSLATE_ME("too long string");
-        std::string expected = TRANSLATE_ME("unique string from 1 to 50 characters");
-        bios_throw("request-param-bad", "name", received.c_str(), expected.c_str());
-    }
-    std::string iname;
-    int         rv = DBAssets::extname_to_asset_name(ename, iname);
+
+    const std::string& ename = checked.ename;
+    std::string        iname;
+    int                rv = s_extname_to_name(names, ename, iname);
     if (!id_str.empty() && rv == 0) {
         // internal name from DB must be the same as internal name from CSV
         if (iname != id_str) {
@@ -749,45 +1173,18 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         std::string err = TRANSLATE_ME("Database failure");
         bios_throw("internal-error", err.c_str());
     }
-    unused_columns.erase("name");
-
-    auto type = cm.get_strip(row_i, "type");
-    log_debug("type = '%s'", type.c_str());
-    if (TYPES.find(type) == TYPES.end()) {
-        std::string received = type.empty() ? TRANSLATE_ME("empty value") : JSONIFY(type.c_str());
-        std::string expected = JSONIFY(utils::join_keys_map(TYPES, ", ").c_str());
-        bios_throw("request-param-bad", "type", received.c_str(), expected.c_str());
-    }
-    auto type_id = TYPES.find(type)->second;
-    unused_columns.erase("type");
 
-    auto status = cm.get_strip(row_i, "status");
-    log_debug("status = '%s'", status.c_str());
-    if (STATUSES.find(status) == STATUSES.end()) {
-        std::string received = status.empty() ? TRANSLATE_ME("empty value") : JSONIFY(status.c_str());
-        std::string expected = JSONIFY(fty::implode(STATUSES, ", ").c_str());
-        bios_throw("request-param-bad", "status", received.c_str(), expected.c_str());
-    }
-    unused_columns.erase("status");
-
-    auto asset_tag = unused_columns.count("asset_tag") ? cm.get(row_i, "asset_tag") : "";
-    log_debug("asset_tag = '%s'", asset_tag.c_str());
-    if (asset_tag.length() > 50) {
-        std::string received = TRANSLATE_ME("too long string");
-        std::string expected = TRANSLATE_ME("unique string from 1 to 50 characters");
-        bios_throw("request-param-bad", "asset_tag", received.c_str(), expected.c_str());
-    }
-    unused_columns.erase("asset_tag");
-
-    int priority = get_priority(cm.get_strip(row_i, "priority"));
-    log_debug("priority = %d", priority);
-    unused_columns.erase("priority");
+    const std::string& type      = checked.type;
+    int                type_id   = checked.type_id;
+    std::string        status    = checked.status;
+    const std::string& asset_tag = checked.asset_tag;
+    int                priority  = checked.priority;
 
     auto location = sanitizedAssetNames["location"];
     log_debug("location = '%s'", location.c_str());
     a_elmnt_id_t parent_id = 0;
     if (!location.empty()) {
-        auto ret = select_asset_element_by_name(conn, location.c_str());
+        auto ret = s_select_by_name(conn, names, location);
         if (ret.status == 1)
             parent_id = ret.item.id;
         else {
@@ -800,41 +1197,10 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
             }
         }
     }
-    unused_columns.erase("location");
-
-    // Business requirement: be able to write 'rack controller', 'RC', 'rc' as subtype == 'rack controller'
-    std::map<std::string, int> local_SUBTYPES     = SUBTYPES;
-    int                        rack_controller_id = SUBTYPES.find("rack controller")->second;
-    int                        patch_panel_id     = SUBTYPES.find("patch panel")->second;
-
-    local_SUBTYPES.emplace(std::make_pair("rackcontroller", rack_controller_id));
-    local_SUBTYPES.emplace(std::make_pair("rackcontroler", rack_controller_id));
-    local_SUBTYPES.emplace(std::make_pair("rc", rack_controller_id));
-    local_SUBTYPES.emplace(std::make_pair("RC", rack_controller_id));
-    local_SUBTYPES.emplace(std::make_pair("RC3", rack_controller_id));
-
-    local_SUBTYPES.emplace(std::make_pair("patchpanel", patch_panel_id));
-
-    auto subtype = cm.get_strip(row_i, "sub_type");
-
-    log_debug("subtype = '%s'", subtype.c_str());
-    if ((type == "device") && (local_SUBTYPES.find(subtype) == local_SUBTYPES.cend())) {
-        std::string received = subtype.empty() ? TRANSLATE_ME("empty value") : JSONIFY(subtype.c_str());
-        std::string expected = JSONIFY(utils::join_keys_map(SUBTYPES, ", ").c_str());
-        bios_throw("request-param-bad", "subtype", received.c_str(), expected.c_str());
-    }
-
-    if ((!subtype.empty()) && (type != "device") && (type != "group")) {
-        log_warning("'%s' - subtype is ignored", subtype.c_str());
-    }
-
-    if ((subtype.empty()) && (type == "group")) {
-        std::string expected = TRANSLATE_ME("subtype (for type group)");
-        bios_throw("request-param-required", expected.c_str());
-    }
 
-    auto subtype_id = local_SUBTYPES.find(subtype)->second;
-    unused_columns.erase("sub_type");
+    const std::string& subtype            = checked.subtype;
+    int                subtype_id         = checked.subtype_id;
+    int                rack_controller_id = checker.rack_controller_id();
 
     // now we have read all basic information about element
     // if id is set, then it is right time to check what is going on in DB
@@ -868,8 +1234,6 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         try {
             // column name
             grp_col_name = "group." + std::to_string(group_index);
-            // remove from unused
-            unused_columns.erase(grp_col_name);
             // take value
             group = sanitizedAssetNames.at(grp_col_name);
         } catch (const std::out_of_range& e)
@@ -883,7 +1247,7 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         // if group was not specified, just skip it
         if (!group.empty()) {
             // find an id from DB
-            auto ret = select_asset_element_by_name(conn, group.c_str());
+            auto ret = s_select_by_name(conn, names, group);
             if (ret.status == 1)
                 groups.insert(ret.item.id); // if OK, then take ID
             else {
@@ -906,8 +1270,6 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         try {
             // column name
             link_col_name = "power_source." + std::to_string(link_index);
-            // remove from unused
-            unused_columns.erase(link_col_name);
             // take value
             link_source = sanitizedAssetNames.at(link_col_name);
         } catch (const std::out_of_range& e)
@@ -921,13 +1283,7 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         // prevent power source being myself
         if (link_source == ename) {
             log_debug("Ignoring power source=myself");
-            link_source         = "";
-            auto link_col_name1 = "power_plug_src." + std::to_string(link_index);
-            auto link_col_name2 = "power_input." + std::to_string(link_index);
-            if (!link_col_name1.empty())
-                unused_columns.erase(link_col_name1);
-            if (!link_col_name2.empty())
-                unused_columns.erase(link_col_name2);
+            link_source = "";
             continue;
         }
 
@@ -935,7 +1291,7 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         if (!link_source.empty()) // if power source is not specified
         {
             // find an id from DB
-            auto ret = select_asset_element_by_name(conn, link_source.c_str());
+            auto ret = s_select_by_name(conn, names, link_source);
             if (ret.status == 1)
                 one_link.src = ret.item.id; // if OK, then take ID
             else {
@@ -952,8 +1308,6 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         // column name
         auto link_col_name1 = "power_plug_src." + std::to_string(link_index);
         try {
-            // remove from unused
-            unused_columns.erase(link_col_name1);
             // take value
             auto link_source1 = cm.get(row_i, link_col_name1);
             // TODO: bad idea, char = byte
@@ -968,189 +1322,66 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         // column name
         auto link_col_name2 = "power_input." + std::to_string(link_index);
         try {
-            unused_columns.erase(link_col_name2);              // remove from unused
             auto link_source2 = cm.get(row_i, link_col_name2); // take value
             // TODO: bad idea, char = byte
-            // FIXME: THIS IS MEMORY LEAK!!!
-            one_link.dest_in = new char[4];
-            strcpy(one_link.dest_in, link_source2.substr(0, 4).c_str());
-        } catch (const std::out_of_range& e) {
-            log_debug("'%s' - is missing at all", link_col_name2.c_str());
-            log_debug("%s", e.what());
-        }
-
-        if (one_link.src != 0) // if first column was ok
-        {
-            if (type == "device") {
-                one_link.type = 1; // TODO remove hardcoded constant
-                links.push_back(one_link);
-            } else {
-                log_warning("information about power sources is ignored for type '%s'", type.c_str());
-            }
-        }
-    }
-
-    // sanity check, for RC-0 always skip HW attributes
-    if (rc_0 == row_i && id_str != "rackcontroller-0") {
-        int i;
-        // remove all ip.X
-        for (i = 1;; ++i) {
-            std::string what = "ip." + std::to_string(i);
-            if (unused_columns.count(what)) {
-                unused_columns.erase(what); // remove from unused
-            } else {
-                break;
-            }
-        }
-        // remove all ipv6.X
-        for (i = 1;; ++i) {
-            std::string what = "ipv6." + std::to_string(i);
-            if (unused_columns.count(what)) {
-                unused_columns.erase(what); // remove from unused
-            } else {
-                break;
-            }
-        }
-        // remove fqdn
-        if (unused_columns.count("fqdn")) {
-            unused_columns.erase("fqdn"); // remove from unused
-        }
-        // remove serial_no
-        if (unused_columns.count("serial_no")) {
-            unused_columns.erase("serial_no"); // remove from unused
-        }
-        // remove model
-        if (unused_columns.count("model")) {
-            unused_columns.erase("model"); // remove from unused
-        }
-        // remove manufacturer
-        if (unused_columns.count("manufacturer")) {
-            unused_columns.erase("manufacturer"); // remove from unused
-        }
-        // remove uuid
-        if (unused_columns.count("uuid")) {
-            unused_columns.erase("uuid"); // remove from unused
-        }
-    }
-
-    _scoped_zhash_t* extattributes = zhash_new();
-    zhash_autofree(extattributes);
-    zhash_insert(extattributes, "name", const_cast<char*>(ename.c_str()));
-    for (auto& key : unused_columns) {
-        // try is not needed, because here are keys that are definitely there
-        std::string value = cm.get(row_i, key);
-
-        // BIOS-1564: sanitize the date for warranty_end -- start
-        if (is_date(key) && !value.empty()) {
-            char* date = sanitize_date(value.c_str());
-            if (!date) {
-                log_info("Cannot sanitize %s '%s' for device '%s'", key.c_str(), value.c_str(), ename.c_str());
-                std::string expected = TRANSLATE_ME("ISO date");
-                bios_throw("request-param-bad", key.c_str(), value.c_str(), expected.c_str());
-            }
-            if (date) {
-                value = date;
-                zstr_free(&date);
-            }
-        }
-        // BIOS-1564 -- end
-
-        // BIOS-2302: Check some attributes for sensors
-        // BIOS-2784: Check max_current, max_power
-        if (key == "logical_asset" && !value.empty()) {
-            // check, that this asset exists
-
-            value = sanitizedAssetNames.at("logical_asset");
-
-            auto ret = select_asset_element_by_name(conn, value.c_str());
-            if (ret.status == 0) {
-                if (ret.errsubtype == DB_ERROR_NOTFOUND) {
-                    log_info("logical_asset '%s' does not present in DB, rejected", value.c_str());
-                    bios_throw("element-not-found", value.c_str());
-                } else {
-                    std::string err = TRANSLATE_ME("Database failure");
-                    bios_throw("internal-error", err.c_str());
-                }
-
-                log_info("logical_asset '%s' does not present in DB, rejected", value.c_str());
-                bios_throw("element-not-found", value.c_str());
-            }
-        } else if ((key == "calibration_offset_t" || key == "calibration_offset_h") && !value.empty()) {
-            // we want exceptions to propagate to upper layer
-            sanitize_value_double(key, value);
-        } else if ((key == "max_current" || key == "max_power") && !value.empty()) {
-            // we want exceptions to propagate to upper layer
-            double d_value = sanitize_value_double(key, value);
-            if (d_value < 0) {
-                log_info("Extattribute: %s='%s' is neither positive not zero", key.c_str(), value.c_str());
-                std::string expected = TRANSLATE_ME("value must be a not negative number");
-                bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
-            }
-        }
-        // BIOS-2781
-        if (key == "location_u_pos" && !value.empty()) {
-            unsigned long ul = 0;
-            try {
-                std::size_t pos = 0;
-                ul              = std::stoul(value, &pos);
-                if (pos != value.length()) {
-                    log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
-                    std::string expected = TRANSLATE_ME("value must be an unsigned integer");
-                    bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
-                }
-            } catch (const std::exception& e) {
-                log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
-                std::string expected = TRANSLATE_ME("value must be an unsigned integer");
-                bios_throw("request-param-bad", "location_u_pos", ("'" + value + "'").c_str(), expected.c_str());
-            }
-            if (ul == 0 || ul > 52) {
-                std::string expected = TRANSLATE_ME("value must be between <1, 52>.");
-                bios_throw("request-param-bad", "location_u_pos", ("'" + value + "'").c_str(), expected.c_str());
-            }
-        }
-        // BIOS-2799
-        if (key == "u_size" && !value.empty()) {
-            unsigned long ul = 0;
-            try {
-                std::size_t pos = 0;
-                ul              = std::stoul(value, &pos);
-                if (pos != value.length()) {
-                    log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
-                    std::string expected = TRANSLATE_ME("value must be an unsigned integer");
-                    bios_throw("request-param-bad", key.c_str(), ("'" + value + "'").c_str(), expected.c_str());
-                }
-            } catch (const std::exception& e) {
-                log_info("Extattribute: %s='%s' is not unsigned integer", key.c_str(), value.c_str());
-                std::string expected = TRANSLATE_ME("value must be an unsigned integer");
-                bios_throw("request-param-bad", "u_size", ("'" + value + "'").c_str(), expected.c_str());
-            }
-            if (ul == 0 || ul > 52) {
-                std::string expected = TRANSLATE_ME("value must be between <1, 52>.");
-                bios_throw("request-param-bad", "u_size", ("'" + value + "'").c_str(), expected.c_str());
+            // FIXME: THIS IS MEMORY LEAK!!!
+            one_link.dest_in = new char[4];
+            strcpy(one_link.dest_in, link_source2.substr(0, 4).c_str());
+        } catch (const std::out_of_range& e) {
+            log_debug("'%s' - is missing at all", link_col_name2.c_str());
+            log_debug("%s", e.what());
+        }
+
+        if (one_link.src != 0) // if first column was ok
+        {
+            if (type == "device") {
+                one_link.type = 1; // TODO remove hardcoded constant
+                links.push_back(one_link);
+            } else {
+                log_warning("information about power sources is ignored for type '%s'", type.c_str());
             }
         }
+    }
 
-        if (match_ext_attr(value, key)) {
-            // ACE: temporary disabled
-            // for testing purposes for rabobank usecase
-            // IMHO: There is no sense to check it at all
-            //   * as we cannot guarantee that manufacturers in the whole world use UNIQUE serial numbers
-            //   * not unique serial number of the device should not forbid users to monitor their devices
-            /*
-            if ( key == "serial_no" )
-            {
+    // sanity check, for RC-0 always skip HW attributes
+    std::set<std::string> hw_columns;
+    if (rc_0 == row_i && id_str != "rackcontroller-0") {
+        // all ip.X and ipv6.X
+        for (int i = 1; columns.count("ip." + std::to_string(i)); ++i) {
+            hw_columns.insert("ip." + std::to_string(i));
+        }
+        for (int i = 1; columns.count("ipv6." + std::to_string(i)); ++i) {
+            hw_columns.insert("ipv6." + std::to_string(i));
+        }
+        hw_columns.insert({"fqdn", "serial_no", "model", "manufacturer", "uuid"});
+    }
 
-                if  ( unique_keytag (conn, key, value, id) == 0 )
-                    zhash_insert (extattributes, key.c_str(), (void*)value.c_str());
-                else
-                {
-                    bios_throw("request-param-bad", "serial_no", value.c_str(), "<unique string>");
+    _scoped_zhash_t* extattributes = zhash_new();
+    zhash_autofree(extattributes);
+    zhash_insert(extattributes, "name", const_cast<char*>(ename.c_str()));
+    for (const auto& attribute : checked.ext) {
+        const std::string& key = attribute.first;
+        if (hw_columns.count(key)) {
+            continue;
+        }
+        std::string value = attribute.second;
+
+        if (key == "logical_asset") {
+            // check, that this asset exists
+            value = sanitizedAssetNames.at("logical_asset");
+
+            auto ret = s_select_by_name(conn, names, value);
+            if (ret.status == 0) {
+                if (ret.errsubtype == DB_ERROR_NOTFOUND) {
+                    log_info("logical_asset '%s' does not present in DB, rejected", value.c_str());
+                    bios_throw("element-not-found", value.c_str());
+                } else {
+                    std::string err = TRANSLATE_ME("Database failure");
+                    bios_throw("internal-error", err.c_str());
                 }
-                continue;
             }
-            */
-            zhash_insert(extattributes, key.c_str(), const_cast<char*>(value.c_str()));
         }
+        zhash_insert(extattributes, key.c_str(), const_cast<char*>(value.c_str()));
     }
     // if the row represents group, the subtype represents a type
     // of the group.
@@ -1162,7 +1393,25 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
 
     db_a_elmnt_t m;
 
-    if (!id_str.empty()) // update operation
+    bool skip = false;
+    if (!id_str.empty() && current) {
+        auto it = current->find(uint32_t(id));
+        if (it != current->end()) {
+            auto changed = s_changed_fields(
+                it->second, parent_id, status, priority, asset_tag, extattributes, groups, links, hw_columns);
+            skip = changed.empty();
+            log_debug("asset '%s' changed fields: %s", id_str.c_str(), fty::implode(changed, ", ").c_str());
+        }
+    }
+    if (unchanged) {
+        *unchanged = skip;
+    }
+
+    if (skip) {
+        // nothing to write and nothing to publish
+        log_info("asset '%s' is unchanged, skipped", id_str.c_str());
+        m.id = uint32_t(id);
+    } else if (!id_str.empty()) // update operation
     {
         _scoped_zhash_t* extattributesRO = zhash_new();
         zhash_autofree(extattributesRO);
@@ -1244,7 +1493,33 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
             zhash_insert(extattributesRO, "create_mode", const_cast<char*>(std::to_string(cm.getCreateMode()).c_str()));
         if (cm.getCreateUser() != "")
             zhash_insert(extattributesRO, "create_user", const_cast<char*>(cm.getCreateUser().c_str()));
-        if (type != "device") {
+        // time of the import, an incremental export lists the asset from then on (bulk insert included)
+        if (cm.getUpdateTs() != "")
+            zhash_insert(extattributesRO, "create_ts", const_cast<char*>(cm.getUpdateTs().c_str()));
+        if (chunk) {
+            // not checked by the chunk, all existing names are known here
+            if (rv == 0) {
+                std::string err = TRANSLATE_ME(
+                    "Element '%s' cannot be processed because of conflict. Most likely duplicate entry.",
+                    ename.c_str());
+                throw BiosError(8, err);
+            }
+            // activation needs committed data, it is done once the chunk is flushed
+            bool activate = type == "device" && subtype_id != rack_controller_id && status == "active";
+            if (activate) {
+                status = "nonactive";
+            }
+            auto ret = chunk->writer.insert(
+                ename.c_str(), uint16_t(type_id), uint16_t(subtype_id), parent_id, extattributes, status.c_str(),
+                uint16_t(priority), groups, links, asset_tag, extattributesRO, m.name);
+            if (ret.status != 1) {
+                throw BiosError(ret.rowid, ret.msg);
+            }
+            m.id = uint32_t(ret.rowid);
+            if (activate) {
+                chunk->activate.insert(m.id);
+            }
+        } else if (type != "device") {
             // this is a transaction
             auto ret = insert_dc_room_row_rack_group(
                 conn, ename.c_str(), uint16_t(type_id), parent_id, extattributes, status.c_str(), uint16_t(priority),
@@ -1300,10 +1575,20 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
         }
     }
 
-    rv = DBAssets::extname_to_asset_name(ename, m.name);
-    if (rv != 0) {
-        std::string err = TRANSLATE_ME("Database failure");
-        bios_throw("internal-error", err.c_str());
+    if (chunk) {
+        // m.name set by the chunk
+    } else if (names && !id_str.empty()) {
+        // internal name does not change on update
+        m.name = id_str;
+    } else {
+        rv = DBAssets::extname_to_asset_name(ename, m.name);
+        if (rv != 0) {
+            std::string err = TRANSLATE_ME("Database failure");
+            bios_throw("internal-error", err.c_str());
+        }
+    }
+    if (names) {
+        names->set(m.id, m.name, ename);
     }
 
     m.status     = status;
@@ -1339,7 +1624,7 @@ static std::pair<db_a_elmnt_t, persist::asset_operation> process_row(
 static std::vector<std::string> MANDATORY = {"name", "type", "sub_type", "location", "status", "priority"};
 static std::string              mandatory_missing(const CsvMap& cm)
 {
-    auto all_fields = cm.getTitles();
+    const auto& all_fields = cm.columns();
     for (const auto& s : MANDATORY) {
         if (all_fields.count(s) == 0)
             return s;
@@ -1348,42 +1633,6 @@ static std::string              mandatory_missing(const CsvMap& cm)
     return "";
 }
 
-void load_asset_csv(
-    std::istream&                                                   input,
-    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
-    std::map<int, std::string>&                                     failRows,
-    touch_cb_t                                                      touch_fn,
-    std::string                                                     user)
-{
-    LOG_START;
-
-    std::vector<std::vector<std::string>> data;
-    cxxtools::CsvDeserializer             deserializer(input);
-    char                                  delimiter = findDelimiter(input);
-    if (delimiter == '\x0') {
-        std::string msg{TRANSLATE_ME("Cannot detect the delimiter, use comma (,) semicolon (;) or tabulator")};
-        log_error("%s", msg.c_str());
-        LOG_END;
-        bios_throw("bad-request-document", msg.c_str());
-    }
-    log_debug("Using delimiter '%c'", delimiter);
-    deserializer.delimiter(delimiter);
-    deserializer.readTitle(false);
-    deserializer.deserialize(data);
-    CsvMap cm{data};
-    cm.deserialize();
-
-    cm.setCreateMode(CREATE_MODE_CSV);
-    cm.setCreateUser(user);
-    cm.setUpdateUser(user);
-    std::time_t timestamp = std::time(NULL);
-    char        mbstr[100];
-    if (std::strftime(mbstr, sizeof(mbstr), "%FT%T%z", std::localtime(&timestamp))) {
-        cm.setUpdateTs(std::string(mbstr));
-    }
-    return load_asset_csv(cm, okRows, failRows, touch_fn);
-}
-
 std::pair<db_a_elmnt_t, persist::asset_operation> process_one_asset(const CsvMap& cm)
 {
     LOG_START;
@@ -1396,10 +1645,10 @@ std::pair<db_a_elmnt_t, persist::asset_operation> process_one_asset(const CsvMap
         bios_throw("request-param-required", m.c_str());
     }
 
-    tntdb::Connection conn;
-    std::string       msg{"No connection to database"};
+    persist::PooledConnection conn;
+    std::string               msg{"No connection to database"};
     try {
-        conn = tntdb::connect(DBConn::url);
+        conn = persist::ConnectionPool::instance().acquire();
     } catch (...) {
         log_error("%s", msg.c_str());
         LOG_END;
@@ -1416,7 +1665,7 @@ std::pair<db_a_elmnt_t, persist::asset_operation> process_one_asset(const CsvMap
 
     std::set<a_elmnt_id_t> ids{};
     int                    rc_0           = -1;
-    auto                   unused_columns = cm.getTitles();
+    const auto&            unused_columns = cm.columns();
     if (unused_columns.empty()) {
         bios_throw("bad-request-document", "Cannot import empty document.");
     }
@@ -1431,89 +1680,501 @@ std::pair<db_a_elmnt_t, persist::asset_operation> process_one_asset(const CsvMap
     LIMITATIONS_STRUCT limitations;
     get_licensing_limitation(limitations);
     std::string warningMessage;
-    auto        ret = process_row(conn, cm, 1, TYPES, SUBTYPES, ids, true, size_t(rc_0), limitations, warningMessage);
+    RowChecker  checker(cm, TYPES, SUBTYPES);
+    auto        ret = process_row(
+        conn, cm, 1, checker, checker.check(1), ids, true, size_t(rc_0), limitations, warningMessage);
     LOG_END;
     return ret;
 }
 
-void load_asset_csv(
-    const CsvMap&                                                   cm,
-    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
-    std::map<int, std::string>&                                     failRows,
-    touch_cb_t                                                      touch_fn)
+
+/*
+ * \brief Columns of the csv file the RowRefs are taken from
+ */
+struct RefColumns
 {
-    LOG_START;
+    CsvMap::Column              name;
+    CsvMap::Column              id;
+    std::vector<CsvMap::Column> refs;
 
-    auto m = mandatory_missing(cm);
-    if (m != "") {
-        std::string msg{"column '" + m + "' is missing, import is aborted"};
-        log_error("%s", msg.c_str());
-        LOG_END;
-        std::string msg_received = TRANSLATE_ME("<missing column '%s'>", m.c_str());
-        std::string msg_expected = TRANSLATE_ME("<column '%s' is present in csv>", m.c_str());
-        bios_throw("request-param-bad", m.c_str(), msg_received.c_str(), msg_expected.c_str());
+    explicit RefColumns(const CsvMap& cm)
+        : name(cm.column("name"))
+        , id(cm.column("id"))
+    {
+        for (const char* title : {"location", "logical_asset"}) {
+            if (cm.hasTitle(title)) {
+                refs.push_back(cm.column(title));
+            }
+        }
+        for (const char* prefix : {"power_source.", "group."}) {
+            for (int i = 1; cm.hasTitle(prefix + std::to_string(i)); ++i) {
+                refs.push_back(cm.column(prefix + std::to_string(i)));
+            }
+        }
+    }
+
+    // value(column) returns the value of the row in the column, empty if there is none
+    template <typename Value>
+    RowRefs row(Value value) const
+    {
+        RowRefs row;
+        row.name = value(name);
+        row.id   = value(id);
+        for (auto column : refs) {
+            std::string ref = value(column);
+            if (!ref.empty()) {
+                row.refs.push_back(std::move(ref));
+            }
+        }
+        return row;
     }
+};
+
 
-    tntdb::Connection conn;
-    std::string       msg{TRANSLATE_ME("No connection to database")};
+/*
+ * \brief Import of csv rows, fed by parts of the file
+ *
+ * Each import() gets some rows of the file in a CsvMap, which is needed only
+ * until import() returns: rows are checked, then imported one by one or put
+ * into chunks of new assets (see AssetBulkInsert), the last chunk is flushed
+ * before import() returns. A chunk failing as a whole is imported again row
+ * by row, so failRows always gets the error of the row.
+ */
+class CsvImport
+{
+public:
+    CsvImport(
+        std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
+        std::map<int, std::string>&                                     failRows,
+        touch_cb_t                                                      touch_fn,
+        size_t                                                          chunk_size,
+        bool                                                            skip_unchanged,
+        const std::map<size_t, std::string>&                            cycles,
+        ImportStats*                                                    stats);
+
+    /// Import rows of cm in the order (of rows of cm), rows gives their row number in the file
+    void import(const CsvMap& cm, const std::vector<size_t>& rows, const std::vector<size_t>& order);
+
+    /// Add inserted and updated rows to stats, once all rows are imported
+    void finish();
+
+private:
+    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& _okRows;
+    std::map<int, std::string>&                                     _failRows;
+    touch_cb_t                                                      _touch_fn;
+    bool                                                            _skip_unchanged;
+    const std::map<size_t, std::string>&                            _cycles;
+    ImportStats*                                                    _stats;
+    size_t                                                          _first_ok;
+
+    PooledConnection            _conn;
+    std::map<std::string, int>  _types;
+    std::map<std::string, int>  _subtypes;
+    std::set<a_elmnt_id_t>      _ids;
+    size_t                      _rc0;
+    LIMITATIONS_STRUCT          _limitations;
+    std::unique_ptr<AssetNames> _names;
+    std::unique_ptr<BulkChunk>  _chunk;
+    size_t                      _chunk_size;
+};
+
+CsvImport::CsvImport(
+    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
+    std::map<int, std::string>&                                     failRows,
+    touch_cb_t                                                      touch_fn,
+    size_t                                                          chunk_size,
+    bool                                                            skip_unchanged,
+    const std::map<size_t, std::string>&                            cycles,
+    ImportStats*                                                    stats)
+    : _okRows(okRows)
+    , _failRows(failRows)
+    , _touch_fn(touch_fn)
+    , _skip_unchanged(skip_unchanged)
+    , _cycles(cycles)
+    , _stats(stats)
+    , _first_ok(okRows.size())
+    , _chunk_size(chunk_size)
+{
+    std::string msg{TRANSLATE_ME("No connection to database")};
     try {
-        conn = tntdb::connect(DBConn::url);
+        _conn = ConnectionPool::instance().acquire();
     } catch (...) {
         log_error("%s", msg.c_str());
-        LOG_END;
         bios_throw("internal-error", msg.c_str());
     }
 
-    auto TYPES = read_element_types(conn);
-
-    if (TYPES.empty())
+    _types = read_element_types(_conn);
+    if (_types.empty())
         bios_throw("internal-error", msg.c_str());
 
-    auto SUBTYPES = read_device_types(conn);
-    if (SUBTYPES.empty())
+    _subtypes = read_device_types(_conn);
+    if (_subtypes.empty())
         bios_throw("internal-error", msg.c_str());
 
-    // BIOS-2506
-    std::set<a_elmnt_id_t> ids{};
-
-    // if there are rackcontroller in the import, promote one of it to rackcontroller-0 if not done already
-    MlmClient client;
     // rc0 promotion disabled due to multiple datacenter support
     // - hard to decide whether it's import of DC after crash or another DC, RC location must be set manually
-    size_t rc0 = std::numeric_limits<std::size_t>::max();
+    _rc0 = std::numeric_limits<std::size_t>::max();
     // int rc0 = promote_rc0(&client, cm, touch_fn);
     // get licensing limitation, if any
-    LIMITATIONS_STRUCT limitations;
-    get_licensing_limitation(limitations);
+    get_licensing_limitation(_limitations);
 
-    std::set<size_t> processedRows;
-    bool             somethingProcessed;
-    do {
-        somethingProcessed = false;
-        failRows.clear();
-        for (size_t row_i = 1; row_i != cm.rows(); ++row_i) {
-            if (processedRows.find(row_i) != processedRows.end())
-                continue;
-            try {
-                std::string warningMessages;
-                auto ret = process_row(conn, cm, row_i, TYPES, SUBTYPES, ids, true, rc0, limitations, warningMessages);
-                touch_fn();
-                if (warningMessages.empty()) {
-                    okRows.push_back(ret);
-                    log_info("row %zu was imported successfully", row_i);
-                } else {
-                    failRows.insert(std::make_pair(row_i + 1, warningMessages));
-                    log_error("row %zu imported with issue: %s", row_i, warningMessages.c_str());
+    _failRows.clear();
+
+    // all names at once, rows are then resolved without database round-trips
+    try {
+        _names.reset(new AssetNames(_conn));
+    } catch (const std::exception& e) {
+        log_error("loading of asset names failed: %s", e.what());
+        std::string err = TRANSLATE_ME("Database failure");
+        bios_throw("internal-error", err.c_str());
+    }
+
+    // new assets are inserted by chunks, rows with id (updates) one by one as before
+    if (chunk_size > 1) {
+        _chunk.reset(new BulkChunk(_conn));
+    }
+}
+
+void CsvImport::import(const CsvMap& cm, const std::vector<size_t>& rows, const std::vector<size_t>& order)
+{
+    // rows are checked first, only resolution of names and writes are left for the pass over the rows
+    RowChecker              checker(cm, _types, _subtypes);
+    std::vector<CheckedRow> checked = check_rows(cm, checker);
+    _touch_fn();
+
+    // stored state of all assets to update at once, rows which would not change them are skipped
+    CurrentAssets current;
+    auto          id_column = cm.column("id");
+    if (_skip_unchanged && id_column.valid()) {
+        std::vector<a_elmnt_id_t> update_ids;
+        for (size_t row_i = 1; row_i < cm.rows(); ++row_i) {
+            int64_t id = _names->name_to_id(cm.get(row_i, id_column));
+            if (id != -1) {
+                update_ids.push_back(a_elmnt_id_t(id));
+            }
+        }
+        try {
+            current = select_web_elements(_conn, update_ids);
+        } catch (const std::exception& e) {
+            log_error("loading of assets to update failed: %s", e.what());
+            std::string err = TRANSLATE_ME("Database failure");
+            bios_throw("internal-error", err.c_str());
+        }
+        _touch_fn();
+    }
+
+    // caches of this process must not wait for the ASSETS stream to see the written rows
+    auto changed = [](const std::pair<db_a_elmnt_t, persist::asset_operation>& row) {
+        AssetWatcher::instance().changed(row.first.name,
+            row.second == persist::asset_operation::INSERT ? FTY_PROTO_ASSET_OP_CREATE : FTY_PROTO_ASSET_OP_UPDATE);
+    };
+
+    auto import_row = [&](size_t row_i, BulkChunk* chunk) {
+        // row number in the file, logged and reported to the user
+        size_t line = rows[row_i];
+        try {
+            std::string warningMessages;
+            bool        unchanged = false;
+            auto        ret       = process_row(
+                _conn, cm, row_i, checker, checked[row_i], _ids, true, _rc0, _limitations, warningMessages,
+                _names.get(), chunk, _skip_unchanged ? &current : nullptr, &unchanged);
+            _touch_fn();
+            if (unchanged) {
+                if (_stats) {
+                    ++_stats->unchanged;
                 }
+                log_info("row %zu is unchanged", line);
+                return;
+            }
+            if (chunk) {
+                chunk->rows.emplace_back(row_i, ret);
+                return;
+            }
+            // written even when a warning follows
+            changed(ret);
+            if (warningMessages.empty()) {
+                _okRows.push_back(ret);
+                log_info("row %zu was imported successfully", line);
+            } else {
+                _failRows.insert(std::make_pair(line + 1, warningMessages));
+                log_error("row %zu imported with issue: %s", line, warningMessages.c_str());
+            }
+        } catch (const std::invalid_argument& e) {
+            _touch_fn();
+            auto        cycle = _cycles.find(line);
+            std::string error = cycle == _cycles.end() ? e.what() : cycle->second + ": " + e.what();
+            _failRows.insert(std::make_pair(line + 1, error));
+            log_error("row %zu not imported: %s", line, error.c_str());
+        }
+    };
+
+    auto flush_chunk = [&]() {
+        if (!_chunk || _chunk->rows.empty()) {
+            return;
+        }
+        auto ret = _chunk->writer.flush();
+        _touch_fn();
+        auto chunk_rows = std::move(_chunk->rows);
+        auto activate   = std::move(_chunk->activate);
+        _chunk->rows.clear();
+        _chunk->activate.clear();
+        if (ret.status != 1) {
+            // nothing was written, get the exact error of each row
+            log_warning(
+                "bulk insert of %zu rows failed (%s), importing them one by one", chunk_rows.size(), ret.msg.c_str());
+            for (const auto& row : chunk_rows) {
+                _names->erase(row.second.first.id);
+            }
+            for (const auto& row : chunk_rows) {
+                import_row(row.first, nullptr);
+            }
+            return;
+        }
+
+        std::unique_ptr<mlm::MlmSyncClient>  client;
+        std::unique_ptr<fty::AssetActivator> activationAccessor;
+        for (const auto& row : chunk_rows) {
+            changed(row.second);
+        }
+        for (const auto& row : chunk_rows) {
+            const auto& m = row.second.first;
+            if (activate.count(m.id)) {
+                try {
+                    if (!activationAccessor) {
+                        client.reset(new mlm::MlmSyncClient(AGENT_FTY_ASSET, AGENT_ASSET_ACTIVATOR));
+                        activationAccessor.reset(new fty::AssetActivator(*client));
+                    }
+                    std::string asset_json = getJsonAsset(NULL, m.id);
+                    activationAccessor->activate(asset_json);
+                } catch (const std::exception& e) {
+                    std::string warningMessages = TRANSLATE_ME(
+                        "Element '%s' is updated but a licensing error occured: %s", m.name.c_str(), e.what());
+                    _failRows.insert(std::make_pair(rows[row.first] + 1, warningMessages));
+                    log_error("row %zu imported with issue: %s", rows[row.first], warningMessages.c_str());
+                    continue;
+                }
+                _touch_fn();
+            }
+            _okRows.push_back(row.second);
+            log_info("row %zu was imported successfully", rows[row.first]);
+        }
+    };
+
+    for (size_t row_i : order) {
+        bool is_update = id_column.valid() && !cm.get(row_i, id_column).empty();
+        if (!_chunk || is_update) {
+            // updates are looking up committed data
+            flush_chunk();
+            import_row(row_i, nullptr);
+            continue;
+        }
+        import_row(row_i, _chunk.get());
+        if (_chunk->writer.size() >= _chunk_size) {
+            flush_chunk();
+        }
+    }
+    // rows of the chunk are rows of cm
+    flush_chunk();
+}
+
+void CsvImport::finish()
+{
+    if (!_stats) {
+        return;
+    }
+    for (size_t i = _first_ok; i < _okRows.size(); ++i) {
+        if (_okRows[i].second == persist::asset_operation::UPDATE) {
+            ++_stats->updated;
+        } else {
+            ++_stats->inserted;
+        }
+    }
+}
+
+
+/*
+ * \brief Check the mandatory columns of the csv file
+ */
+static void check_mandatory(const CsvMap& cm)
+{
+    auto m = mandatory_missing(cm);
+    if (m != "") {
+        std::string msg{"column '" + m + "' is missing, import is aborted"};
+        log_error("%s", msg.c_str());
+        LOG_END;
+        std::string msg_received = TRANSLATE_ME("<missing column '%s'>", m.c_str());
+        std::string msg_expected = TRANSLATE_ME("<column '%s' is present in csv>", m.c_str());
+        bios_throw("request-param-bad", m.c_str(), msg_received.c_str(), msg_expected.c_str());
+    }
+}
+
+void load_asset_csv(
+    const CsvMap&                                                   cm,
+    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
+    std::map<int, std::string>&                                     failRows,
+    touch_cb_t                                                      touch_fn,
+    size_t                                                          chunk_size,
+    bool                                                            skip_unchanged,
+    ImportStats*                                                    stats)
+{
+    LOG_START;
+    check_mandatory(cm);
 
-                somethingProcessed = true;
-                processedRows.insert(row_i);
-            } catch (const std::invalid_argument& e) {
-                failRows.insert(std::make_pair(row_i + 1, e.what()));
-                log_error("row %zu not imported: %s", row_i, e.what());
+    RefColumns           columns(cm);
+    std::vector<RowRefs> refs(cm.rows() > 0 ? cm.rows() : 1);
+    for (size_t row_i = 1; row_i < cm.rows(); ++row_i) {
+        refs[row_i] = columns.row([&](CsvMap::Column column) {
+            try {
+                return column.valid() ? cm.get(row_i, column) : std::string();
+            } catch (const std::out_of_range&) {
+                // short row, reported when it is imported
+                return std::string();
             }
+        });
+    }
+    ImportPlan plan = import_plan(refs);
+    std::vector<RowRefs>().swap(refs);
+
+    std::vector<size_t> rows(cm.rows() > 0 ? cm.rows() : 1);
+    if (stats) {
+        stats->rows += rows.size() - 1;
+    }
+
+    CsvImport importer(okRows, failRows, touch_fn, chunk_size, skip_unchanged, plan.cycles, stats);
+    std::vector<size_t> order;
+    for (size_t row_i = 0; row_i != rows.size(); ++row_i) {
+        rows[row_i] = row_i;
+        if (row_i != 0 && plan.in_order[row_i]) {
+            order.push_back(row_i);
+        }
+    }
+    order.insert(order.end(), plan.deferred.begin(), plan.deferred.end());
+    importer.import(cm, rows, order);
+    importer.finish();
+    LOG_END;
+}
+
+/*
+ * \brief Rows of the csv file held in memory, with the titles and import metadata of the file
+ */
+static CsvMap csv_part(const CsvMap& titles, CsvMap::Data&& data)
+{
+    CsvMap cm{std::move(data)};
+    cm.deserialize();
+    cm.setCreateMode(titles.getCreateMode());
+    cm.setCreateUser(titles.getCreateUser());
+    cm.setUpdateUser(titles.getUpdateUser());
+    cm.setUpdateTs(titles.getUpdateTs());
+    return cm;
+}
+
+void load_asset_csv(
+    std::istream&                                                   input,
+    std::vector<std::pair<db_a_elmnt_t, persist::asset_operation>>& okRows,
+    std::map<int, std::string>&                                     failRows,
+    touch_cb_t                                                      touch_fn,
+    std::string                                                     user,
+    size_t                                                          chunk_size,
+    bool                                                            skip_unchanged,
+    ImportStats*                                                    stats)
+{
+    LOG_START;
+    CsvDialect dialect = sniffDialect(input);
+    if (dialect.delimiter == '\x0') {
+        std::string msg{TRANSLATE_ME("Cannot detect the delimiter, use comma (,) semicolon (;) or tabulator")};
+        log_error("%s", msg.c_str());
+        LOG_END;
+        bios_throw("bad-request-document", msg.c_str());
+    }
+    log_debug("Using delimiter '%c'", dialect.delimiter);
+    std::streampos data = input.tellg();
+
+    // first pass, titles and references of the rows only
+    std::vector<std::string_view> fields;
+    CsvReader                     reader(input, dialect.delimiter);
+    reader.next(fields);
+    std::vector<std::string> title_row(fields.begin(), fields.end());
+    CsvMap                   titles{CsvMap::Data{title_row}};
+    titles.deserialize();
+    titles.setCreateMode(CREATE_MODE_CSV);
+    titles.setCreateUser(user);
+    titles.setUpdateUser(user);
+    std::time_t timestamp = std::time(NULL);
+    char        mbstr[100];
+    if (std::strftime(mbstr, sizeof(mbstr), "%FT%T%z", std::localtime(&timestamp))) {
+        titles.setUpdateTs(std::string(mbstr));
+    }
+    check_mandatory(titles);
+
+    RefColumns           columns(titles);
+    std::vector<RowRefs> refs(1);
+    while (reader.next(fields)) {
+        refs.push_back(columns.row([&](CsvMap::Column column) {
+            return column.valid() && column.index < fields.size() ? std::string(fields[column.index]) : std::string();
+        }));
+    }
+    ImportPlan plan = import_plan(refs);
+    size_t     count = refs.size() - 1;
+    std::vector<RowRefs>().swap(refs);
+    if (stats) {
+        stats->rows += count;
+    }
+
+    CsvImport importer(okRows, failRows, touch_fn, chunk_size, skip_unchanged, plan.cycles, stats);
+
+    // second pass, rows in csv order are imported by parts of part_size rows, deferred ones are kept for the end
+    const size_t part_size = chunk_size > 1 ? chunk_size : CSV_IMPORT_CHUNK_SIZE;
+    CsvMap::Data part{title_row};
+    CsvMap::Data deferred{title_row};
+    std::vector<size_t> part_rows{0};
+    std::vector<size_t> deferred_rows{0};
+    auto                import_part = [&]() {
+        std::vector<size_t> order(part_rows.size() - 1);
+        std::iota(order.begin(), order.end(), 1);
+        importer.import(csv_part(titles, std::move(part)), part_rows, order);
+        part = CsvMap::Data{title_row};
+        part_rows.resize(1);
+    };
+
+    input.clear();
+    input.seekg(data);
+    CsvReader again(input, dialect.delimiter);
+    again.next(fields);
+    for (size_t row_i = 1; again.next(fields); ++row_i) {
+        if (row_i >= plan.in_order.size()) {
+            // the input changed between the passes
+            std::string err = TRANSLATE_ME("Cannot read the csv file again");
+            bios_throw("internal-error", err.c_str());
+        }
+        if (!plan.in_order[row_i]) {
+            deferred.emplace_back(fields.begin(), fields.end());
+            deferred_rows.push_back(row_i);
+            continue;
+        }
+        part.emplace_back(fields.begin(), fields.end());
+        part_rows.push_back(row_i);
+        if (part_rows.size() > part_size) {
+            import_part();
+        }
+    }
+    if (part_rows.size() > 1) {
+        import_part();
+    }
+
+    if (deferred_rows.size() > 1) {
+        log_info("importing %zu rows referencing rows after them", deferred_rows.size() - 1);
+        std::unordered_map<size_t, size_t> local;
+        for (size_t i = 1; i != deferred_rows.size(); ++i) {
+            local.emplace(deferred_rows[i], i);
         }
-    } while (somethingProcessed);
+        std::vector<size_t> order;
+        order.reserve(plan.deferred.size());
+        for (size_t row_i : plan.deferred) {
+            order.push_back(local.at(row_i));
+        }
+        importer.import(csv_part(titles, std::move(deferred)), deferred_rows, order);
+    }
+    importer.finish();
     LOG_END;
 }
 
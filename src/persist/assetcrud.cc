@@ -446,3 +446,74 @@ db_reply <std::set <std::pair<a_elmnt_id_t ,a_elmnt_id_t>>>
         return ret;
     }
 }
+
+//=============================================================================
+db_reply <std::map<a_elmnt_id_t, std::pair<std::string, std::string>>>
+    select_names_ext_names
+        (tntdb::Connection &conn,
+         const std::set<a_elmnt_id_t> &ids)
+{
+    LOG_START;
+
+    std::map<a_elmnt_id_t, std::pair<std::string, std::string>> item{};
+    db_reply <std::map<a_elmnt_id_t, std::pair<std::string, std::string>>> ret = db_reply_new(item);
+
+    if ( ids.empty() )
+    {
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+
+    // ids are numbers, so it is safe to put them in the query
+    std::string inlist;
+    for ( const auto id : ids )
+    {
+        if ( !inlist.empty() )
+            inlist += ",";
+        inlist += std::to_string(id);
+    }
+
+    try{
+        // Can return more than one row.
+        tntdb::Statement st = conn.prepare(
+            " SELECT"
+            "   v.id, v.name, ext.value"
+            " FROM"
+            "   v_bios_asset_element v"
+            " LEFT JOIN"
+            "   v_bios_asset_ext_attributes ext"
+            " ON"
+            "   ext.id_asset_element = v.id AND ext.keytag = 'name'"
+            " WHERE v.id IN (" + inlist + ")"
+        );
+
+        tntdb::Result result = st.select();
+        log_debug("[v_bios_asset_element]: were selected %" PRIu32 " rows",
+                                                            result.size());
+
+        for ( auto &row: result )
+        {
+            a_elmnt_id_t id = 0;
+            row[0].get(id);
+
+            std::pair<std::string, std::string> names;
+            row[1].get(names.first);
+            row[2].get(names.second);
+
+            ret.item.emplace(id, names);
+        }
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+    catch (const std::exception &e) {
+        ret.status        = 0;
+        ret.errtype       = DB_ERR;
+        ret.errsubtype    = DB_ERROR_INTERNAL;
+        ret.msg           = JSONIFY(e.what());
+        ret.item.clear();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
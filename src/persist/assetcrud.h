@@ -61,3 +61,12 @@ db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(tntdb::Connect
 /// Selects all links, where at least one end is inside the container
 db_reply<std::set<std::pair<a_elmnt_id_t, a_elmnt_id_t>>> select_links_by_container(
     tntdb::Connection& conn, a_elmnt_id_t element_id);
+
+/// Selects names and ext names of several elements in one query
+///
+/// @param[in] conn - the connection to database.
+/// @param[in] ids - ids of the elements.
+///
+/// @return a database reply where item maps ids at pairs (name, ext name). Unknown ids are missing.
+db_reply<std::map<a_elmnt_id_t, std::pair<std::string, std::string>>> select_names_ext_names(
+    tntdb::Connection& conn, const std::set<a_elmnt_id_t>& ids);
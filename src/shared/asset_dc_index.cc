@@ -0,0 +1,262 @@
+/*
+ *
+ * Copyright (C) 2018 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_dc_index.cc
+ * \brief Process-wide index asset name -> datacenter
+ */
+#include "shared/asset_dc_index.h"
+#include "shared/asset_watcher.h"
+#include <fty_common_asset_types.h>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+static constexpr int MAX_PARENTS = 10;
+
+AssetDcIndex& AssetDcIndex::instance()
+{
+    static AssetDcIndex index;
+    return index;
+}
+
+AssetDcIndex::AssetDcIndex()
+{
+    _noLocation = intern("");
+}
+
+AssetDcIndex::Dc AssetDcIndex::intern(const std::string& name)
+{
+    auto it = _names.emplace(name, 0).first;
+    ++it->second;
+    return &it->first;
+}
+
+void AssetDcIndex::unintern(Dc name)
+{
+    auto it = _names.find(*name);
+    if (it != _names.end() && --it->second == 0) {
+        _names.erase(it);
+    }
+}
+
+void AssetDcIndex::index(const std::string& name, Dc dc)
+{
+    auto it = _assets.find(name);
+    if (it != _assets.end()) {
+        unintern(it->second);
+        it->second = dc;
+        return;
+    }
+    _assets.emplace(*intern(name), dc);
+}
+
+void AssetDcIndex::unindex(Assets::iterator it)
+{
+    Dc key = &_names.find(std::string(it->first))->first;
+    Dc dc  = it->second;
+    _assets.erase(it);
+    unintern(key);
+    unintern(dc);
+}
+
+AssetDcIndex::Dc AssetDcIndex::datacenter(const std::string& name)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    return intern(name);
+}
+
+void AssetDcIndex::release(Dc dc)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    unintern(dc);
+}
+
+std::string AssetDcIndex::load(tntdb::Connection& conn)
+{
+    // not under the lock, the watcher calls apply() with its own lock held
+    std::call_once(_subscribed, [this]() {
+        AssetWatcher::instance().subscribe([this](const AssetWatcher::Event& event) {
+            if (event.name.empty()) {
+                lost();
+                return;
+            }
+            // changes announced by writers of this process are followed by the stream message
+            if (!event.asset) {
+                return;
+            }
+            Change change = apply(event.asset);
+
+            std::lock_guard<std::mutex> lock(_listenersMutex);
+            for (const auto& listener : _listeners) {
+                listener.second(event.asset, change);
+            }
+        });
+    });
+    // the watcher reconnects by itself, next calls succeed once it is back
+    if (!AssetWatcher::instance().watching()) {
+        log_warning("asset datacenter index: ASSETS stream is not consumed, index not loaded");
+        return TRANSLATE_ME("ASSETS stream is not consumed now, please try again after a while.");
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    if (_loaded) {
+        return "";
+    }
+
+    try {
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   v.name, v.id_type,"
+            "   v.parent_name1, v.parent_name2, v.parent_name3, v.parent_name4, v.parent_name5,"
+            "   v.parent_name6, v.parent_name7, v.parent_name8, v.parent_name9, v.parent_name10,"
+            "   v.id_type_parent1, v.id_type_parent2, v.id_type_parent3, v.id_type_parent4, v.id_type_parent5,"
+            "   v.id_type_parent6, v.id_type_parent7, v.id_type_parent8, v.id_type_parent9, v.id_type_parent10"
+            " FROM"
+            "   v_bios_asset_element_super_parent v");
+
+        for (const auto& row : st.select()) {
+            std::string name;
+            row[0].get(name);
+            uint16_t type_id = 0;
+            row[1].get(type_id);
+
+            Dc   dc        = nullptr;
+            bool hasParent = false;
+            if (type_id == persist::asset_type::DATACENTER) {
+                dc = intern(name);
+            }
+            for (int i = 0; i < MAX_PARENTS && !dc; ++i) {
+                std::string parent;
+                row[2 + i].get(parent);
+                uint16_t parent_type_id = 0;
+                row[2 + MAX_PARENTS + i].get(parent_type_id);
+                hasParent = hasParent || !parent.empty();
+                if (parent_type_id == persist::asset_type::DATACENTER) {
+                    dc = intern(parent);
+                }
+            }
+            if (!dc && !hasParent && type_id == persist::asset_type::DEVICE) {
+                dc = intern("");
+            }
+            if (dc) {
+                index(name, dc);
+            }
+        }
+    } catch (const std::exception& e) {
+        log_error("loading of asset datacenter index failed: %s", e.what());
+        return JSONIFY(e.what());
+    }
+
+    _loaded = true;
+    log_debug("asset datacenter index loaded (%zu assets)", _assets.size());
+    return "";
+}
+
+AssetDcIndex::Dc AssetDcIndex::find(const std::string& name) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto                                it = _assets.find(name);
+    return it == _assets.end() ? nullptr : it->second;
+}
+
+size_t AssetDcIndex::subscribe(Listener listener)
+{
+    std::lock_guard<std::mutex> lock(_listenersMutex);
+    size_t                      id = _nextListener++;
+    _listeners.emplace(id, std::move(listener));
+    return id;
+}
+
+void AssetDcIndex::unsubscribe(size_t id)
+{
+    std::lock_guard<std::mutex> lock(_listenersMutex);
+    _listeners.erase(id);
+}
+
+void AssetDcIndex::lost()
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        while (!_assets.empty()) {
+            unindex(_assets.begin());
+        }
+        _loaded = false;
+    }
+    log_error("asset datacenter index: ASSETS stream lost, index dropped");
+
+    std::lock_guard<std::mutex> lock(_listenersMutex);
+    for (const auto& listener : _listeners) {
+        listener.second(nullptr, Change());
+    }
+}
+
+AssetDcIndex::Change AssetDcIndex::apply(fty_proto_t* asset)
+{
+    const char* operation = fty_proto_operation(asset);
+    std::string name      = fty_proto_name(asset);
+
+    // inventory messages change ext attributes only and carry no location
+    if (streq(operation, FTY_PROTO_ASSET_OP_INVENTORY)) {
+        Dc dc = find(name);
+        return Change{dc, dc};
+    }
+
+    const char* type = fty_proto_aux_string(asset, "type", "none");
+
+    // last parent is the top most one
+    std::string topParent;
+    for (int i = 1; i <= MAX_PARENTS; ++i) {
+        const char* parent = fty_proto_aux_string(asset, ("parent_name." + std::to_string(i)).c_str(), nullptr);
+        if (!parent) {
+            break;
+        }
+        topParent = parent;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    Dc after = nullptr;
+    if (streq(operation, FTY_PROTO_ASSET_OP_DELETE)) {
+        after = nullptr;
+    } else if (streq(type, "datacenter")) {
+        after = intern(name);
+    } else if (!topParent.empty()) {
+        // only a datacenter (indexed as its own datacenter) locates the asset
+        auto top = _assets.find(topParent);
+        if (top != _assets.end() && *top->second == topParent) {
+            after = intern(topParent);
+        }
+    } else if (streq(type, "device") || streq(type, "none")) {
+        // XXX: autodiscovered items seems to not have a type
+        after = intern("");
+    }
+
+    auto   it = _assets.find(name);
+    Change change{it == _assets.end() ? nullptr : it->second, after};
+    if (after) {
+        index(name, after);
+    } else if (it != _assets.end()) {
+        unindex(it);
+    }
+    return change;
+}
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright (C) 2018 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_dc_index.h
+/// @brief Process-wide index asset name -> datacenter
+///
+/// How it works
+/// ============
+/// The index is loaded from the database once (one query on
+/// v_bios_asset_element_super_parent) and then kept current by the
+/// AssetWatcher, whether sse hubs are running or not. Names are interned,
+/// so that the datacenter of an asset is a pointer comparison away. Interned
+/// names are counted and freed when neither the index nor a caller of
+/// datacenter() refers to them anymore.
+///
+/// Each message of the ASSETS stream is applied once and the computed
+/// change of location is passed to the subscribers (the sse hubs):
+///
+///     auto id = AssetDcIndex::instance().subscribe([](fty_proto_t* asset, const AssetDcIndex::Change& change) {
+///         ...
+///     });
+///
+/// Inventory messages change ext attributes only, the location is left
+/// as is. If the stream is lost, the index is dropped and subscribers get a
+/// nullptr asset. load() fails while the stream is not consumed and loads the
+/// index again once the AssetWatcher has reconnected, so a broker outage
+/// makes sse connections fail only until the broker is back.
+///
+/// A datacenter maps to itself, a device without location maps to
+/// AssetDcIndex::noLocation(), anything else not under a datacenter is not
+/// indexed.
+
+#pragma once
+
+#include <cstddef>
+#include <fty_proto.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tntdb/connection.h>
+#include <unordered_map>
+
+class AssetDcIndex
+{
+public:
+    /// Interned datacenter name; nullptr for "not in any datacenter"
+    using Dc = const std::string*;
+
+    /// Location of an asset before and after an ASSETS message, to compare
+    /// with a name got by datacenter() only (before may be released already)
+    struct Change
+    {
+        Dc before = nullptr;
+        Dc after  = nullptr;
+    };
+
+    /// Called from the watcher thread, must not call back the index listeners
+    using Listener = std::function<void(fty_proto_t* asset, const Change& change)>;
+
+    static AssetDcIndex& instance();
+
+    /// Load the index from database, only the first call (after a loss of the
+    /// stream) hits the database
+    /// @return empty string or an error message, to retry later if the stream is not consumed
+    std::string load(tntdb::Connection& conn);
+
+    /// Interned marker of devices without location
+    Dc noLocation() const
+    {
+        return _noLocation;
+    }
+
+    /// Interned datacenter name (never nullptr), to give back by release()
+    Dc datacenter(const std::string& name);
+
+    /// Release a name got by datacenter()
+    void release(Dc dc);
+
+    /// Datacenter of the asset, nullptr if unknown
+    Dc find(const std::string& name) const;
+
+    /// Register the listener of changes
+    /// @return id for unsubscribe()
+    size_t subscribe(Listener listener);
+
+    /// Unregister the listener, it is not running anymore on return
+    void unsubscribe(size_t id);
+
+private:
+    AssetDcIndex();
+
+    using Assets = std::unordered_map<std::string_view, Dc>;
+
+    Dc     intern(const std::string& name);
+    void   unintern(Dc name);
+    void   index(const std::string& name, Dc dc);
+    void   unindex(Assets::iterator it);
+    Change apply(fty_proto_t* asset);
+    void   lost();
+
+    std::once_flag                           _subscribed;
+    mutable std::shared_mutex                _mutex;
+    bool                                     _loaded = false;
+    std::unordered_map<std::string, size_t>  _names;
+    Assets                                   _assets;
+    Dc                                       _noLocation = nullptr;
+
+    std::mutex                 _listenersMutex;
+    std::map<size_t, Listener> _listeners;
+    size_t                     _nextListener = 1;
+};
@@ -0,0 +1,312 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_delete_plan.cc
+ * \brief Order of deletion of many assets at once
+ */
+#include "shared/asset_delete_plan.h"
+#include "db/asset_general.h"
+#include <algorithm>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <functional>
+#include <queue>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+#include <unordered_map>
+#include <unordered_set>
+
+using Adjacency = std::unordered_map<uint32_t, std::vector<uint32_t>>;
+
+static const std::vector<uint32_t>& s_list(const Adjacency& adjacency, uint32_t id)
+{
+    static const std::vector<uint32_t> empty;
+
+    auto it = adjacency.find(id);
+    return it == adjacency.end() ? empty : it->second;
+}
+
+static db_reply_t s_rejected(const std::string& msg, db_err_nos errsubtype = DB_ERROR_UNKNOWN)
+{
+    db_reply_t ret = db_reply_new();
+    ret.status     = 0;
+    ret.errtype    = DB_ERR;
+    ret.errsubtype = errsubtype;
+    ret.msg        = msg;
+    log_warning("%s", msg.c_str());
+    return ret;
+}
+
+static std::vector<db_a_elmnt_t> s_elements(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, id_parent, id_type, id_subtype, name, status"
+        " FROM"
+        "   t_bios_asset_element");
+
+    std::vector<db_a_elmnt_t> elements;
+    for (const auto& row : st.select()) {
+        db_a_elmnt_t el{};
+        row[0].get(el.id);
+        row[1].get(el.parent_id);
+        row[2].get(el.type_id);
+        row[3].get(el.subtype_id);
+        row[4].get(el.name);
+        row[5].get(el.status);
+        elements.push_back(std::move(el));
+    }
+    return elements;
+}
+
+static std::vector<std::pair<uint32_t, uint32_t>> s_links(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_device_src, id_asset_device_dest"
+        " FROM"
+        "   t_bios_asset_link");
+
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    for (const auto& row : st.select()) {
+        uint32_t src = 0, dest = 0;
+        row[0].get(src);
+        row[1].get(dest);
+        links.emplace_back(src, dest);
+    }
+    return links;
+}
+
+AssetDeletePlan::AssetDeletePlan(tntdb::Connection& conn, const std::vector<uint32_t>& ids)
+    : AssetDeletePlan(s_elements(conn), s_links(conn), ids)
+{
+}
+
+AssetDeletePlan::AssetDeletePlan(const std::vector<db_a_elmnt_t>& all,
+    const std::vector<std::pair<uint32_t, uint32_t>>& all_links, const std::vector<uint32_t>& ids)
+{
+    std::unordered_map<uint32_t, db_a_elmnt_t> elements;
+    Adjacency                                  children;
+    Adjacency                                  links;   // source -> powered devices
+    Adjacency                                  sources; // powered device -> sources
+
+    for (const auto& el : all) {
+        if (el.parent_id != 0) {
+            children[el.parent_id].push_back(el.id);
+        }
+        elements.emplace(el.id, el);
+    }
+    for (const auto& link : all_links) {
+        links[link.first].push_back(link.second);
+        sources[link.second].push_back(link.first);
+    }
+
+    // requested assets without duplicates, position in the request breaks ties
+    std::vector<uint32_t>                    requested;
+    std::unordered_map<uint32_t, size_t>     position;
+    std::unordered_map<uint32_t, db_reply_t> rejected;
+    for (uint32_t id : ids) {
+        auto it = elements.find(id);
+        if (it == elements.end()) {
+            rejected.emplace(id, s_rejected(TRANSLATE_ME("problem with selecting basic info"), DB_ERROR_NOTFOUND));
+            continue;
+        }
+        _found.push_back(it->second);
+        if (position.emplace(id, requested.size()).second) {
+            requested.push_back(id);
+        }
+    }
+
+    // requested dependencies of a requested asset
+    auto successors = [&](uint32_t id) {
+        std::vector<uint32_t> next;
+        for (uint32_t child : s_list(children, id)) {
+            if (position.count(child)) {
+                next.push_back(child);
+            }
+        }
+        for (uint32_t dest : s_list(links, id)) {
+            if (dest != id && position.count(dest)) {
+                next.push_back(dest);
+            }
+        }
+        return next;
+    };
+
+    // strongly connected components of the requested assets (Tarjan's
+    // algorithm, iterative): assets of one component depend on each other
+    // through a cycle of power links
+    std::unordered_map<uint32_t, size_t> component;
+    size_t                               cyclic = 0;
+    {
+        struct Frame
+        {
+            uint32_t              id;
+            std::vector<uint32_t> next;
+            size_t                i;
+        };
+        std::unordered_map<uint32_t, size_t> index, lowlink;
+        std::unordered_set<uint32_t>         onStack;
+        std::vector<uint32_t>                stack;
+        std::vector<Frame>                   frames;
+        size_t                               counter = 0, components = 0;
+
+        auto visit = [&](uint32_t id) {
+            index[id] = lowlink[id] = counter++;
+            stack.push_back(id);
+            onStack.insert(id);
+            frames.push_back({id, successors(id), 0});
+        };
+        for (uint32_t root : requested) {
+            if (index.count(root)) {
+                continue;
+            }
+            visit(root);
+            while (!frames.empty()) {
+                Frame& frame = frames.back();
+                if (frame.i < frame.next.size()) {
+                    uint32_t next = frame.next[frame.i++];
+                    if (!index.count(next)) {
+                        visit(next);
+                    } else if (onStack.count(next)) {
+                        lowlink[frame.id] = std::min(lowlink[frame.id], index[next]);
+                    }
+                    continue;
+                }
+
+                uint32_t id = frame.id;
+                frames.pop_back();
+                if (!frames.empty()) {
+                    lowlink[frames.back().id] = std::min(lowlink[frames.back().id], lowlink[id]);
+                }
+                if (lowlink[id] == index[id]) {
+                    size_t   size = 0;
+                    uint32_t member;
+                    do {
+                        member = stack.back();
+                        stack.pop_back();
+                        onStack.erase(member);
+                        component[member] = components;
+                        ++size;
+                    } while (member != id);
+                    cyclic += size > 1 ? size : 0;
+                    ++components;
+                }
+            }
+        }
+    }
+    if (cyclic != 0) {
+        log_warning("%zu assets to delete are in cycles of power links", cyclic);
+    }
+
+    // power links inside a cycle are not dependencies, nothing could be deleted first
+    auto isDependency = [&](uint32_t src, uint32_t dest) {
+        return src != dest && position.count(src) && position.count(dest) && component.at(src) != component.at(dest);
+    };
+
+    // Kahn's algorithm: an asset is ready when its requested children and
+    // powered devices are ordered
+    std::unordered_map<uint32_t, size_t> pending;
+    for (uint32_t id : requested) {
+        size_t& count = pending[id];
+        for (uint32_t child : s_list(children, id)) {
+            count += position.count(child);
+        }
+        for (uint32_t dest : s_list(links, id)) {
+            count += isDependency(id, dest);
+        }
+    }
+
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (uint32_t id : requested) {
+        if (pending[id] == 0) {
+            ready.push(position.at(id));
+        }
+    }
+    std::vector<uint32_t> order;
+    while (!ready.empty()) {
+        uint32_t id = requested[ready.top()];
+        ready.pop();
+        order.push_back(id);
+
+        uint32_t parent = elements.at(id).parent_id;
+        if (parent != id && position.count(parent) && --pending[parent] == 0) {
+            ready.push(position.at(parent));
+        }
+        for (uint32_t src : s_list(sources, id)) {
+            if (isDependency(src, id) && --pending[src] == 0) {
+                ready.push(position.at(src));
+            }
+        }
+    }
+
+    // only a loop of parents (broken database) leaves assets unordered
+    for (uint32_t id : requested) {
+        if (pending[id] != 0) {
+            rejected.emplace(id, s_rejected(TRANSLATE_ME("can't delete the asset because it has at least one child")));
+        }
+    }
+
+    std::unordered_set<uint32_t> deletable;
+    for (uint32_t id : order) {
+        Step        step{elements.at(id), {}, {}};
+        std::string error;
+
+        // disable deleting RC0
+        if (RC0_INAME == step.el.name) {
+            log_debug("Prevented deleting RC-0");
+            error = "Prevented deleting RC-0";
+        }
+        for (uint32_t child : s_list(children, id)) {
+            if (error.empty() && !deletable.count(child)) {
+                error = TRANSLATE_ME("can't delete the asset because it has at least one child");
+            }
+            step.children.push_back(child);
+        }
+        for (uint32_t dest : s_list(links, id)) {
+            if (dest == id || (position.count(dest) && component.at(id) == component.at(dest))) {
+                continue;
+            }
+            if (error.empty() && !deletable.count(dest)) {
+                error = TRANSLATE_ME("can't delete the asset because it is linked to others");
+            }
+            step.links.push_back(dest);
+        }
+
+        if (!error.empty()) {
+            rejected.emplace(id, s_rejected(error));
+            continue;
+        }
+        deletable.insert(id);
+        _steps.push_back(std::move(step));
+    }
+
+    for (uint32_t id : ids) {
+        auto it = rejected.find(id);
+        if (it != rejected.end()) {
+            _rejected.push_back(*it);
+            rejected.erase(it);
+        }
+    }
+
+    log_debug("delete of %zu assets planned, %zu rejected", _steps.size(), _rejected.size());
+}
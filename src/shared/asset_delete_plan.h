@@ -0,0 +1,92 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_delete_plan.h
+/// @brief Order of deletion of many assets at once
+///
+/// How it works
+/// ============
+/// Elements and links of all assets are loaded by two queries, so that
+/// checking a request does not cost any query per asset. An asset depends
+/// on its direct children and on the devices it powers: those have to be
+/// deleted first. Requested assets are ordered topologically along these
+/// dependencies (Kahn's algorithm, ties keep the order of the request).
+/// Power links can form cycles: the strongly connected components of the
+/// requested assets are computed first (Tarjan's algorithm) and only links
+/// between assets of the same component are not taken as dependencies.
+/// Assets merely depending on a cycle keep all their dependencies.
+///
+/// An asset is rejected up front when it is rackcontroller-0, or when any
+/// dependency is neither requested nor deleted before it:
+///
+///     AssetDeletePlan plan(conn, ids);
+///     for (const auto& step : plan.steps()) {
+///         // delete step.el, unless a dependency failed to be deleted
+///     }
+
+#pragma once
+
+#include "db/dbhelpers.h"
+#include <fty_common_db_asset.h>
+#include <tntdb/connection.h>
+#include <utility>
+#include <vector>
+
+class AssetDeletePlan
+{
+public:
+    struct Step
+    {
+        db_a_elmnt_t          el;
+        std::vector<uint32_t> children; ///< direct children, deleted before the asset
+        std::vector<uint32_t> links;    ///< devices powered by the asset, deleted before it
+    };
+
+    /// Loads assets and links and plans deletion of ids
+    /// @throws std::exception on database error
+    AssetDeletePlan(tntdb::Connection& conn, const std::vector<uint32_t>& ids);
+
+    /// Plans deletion of ids among all assets and power links (source, powered device)
+    AssetDeletePlan(const std::vector<db_a_elmnt_t>& elements, const std::vector<std::pair<uint32_t, uint32_t>>& links,
+        const std::vector<uint32_t>& ids);
+
+    /// Requested assets which exist, in the order of the request
+    const std::vector<db_a_elmnt_t>& found() const
+    {
+        return _found;
+    }
+
+    /// Requested assets which cannot be deleted, in the order of the request
+    const std::vector<std::pair<uint32_t, db_reply_t>>& rejected() const
+    {
+        return _rejected;
+    }
+
+    /// Assets to delete, in the order of deletion
+    const std::vector<Step>& steps() const
+    {
+        return _steps;
+    }
+
+private:
+    std::vector<db_a_elmnt_t>                    _found;
+    std::vector<std::pair<uint32_t, db_reply_t>> _rejected;
+    std::vector<Step>                            _steps;
+};
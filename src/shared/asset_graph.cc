@@ -0,0 +1,244 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_graph.cc
+ * \brief Process-wide in-memory graph of asset containment and power links
+ */
+#include "shared/asset_graph.h"
+#include "shared/asset_watcher.h"
+#include <fty_common.h>
+#include <fty_log.h>
+#include <fty_proto.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+// ------------------------------------------------------------------------------------------------------------------
+
+void AssetGraph::Snapshot::Csr::build(size_t nodes, const std::vector<std::pair<uint32_t, uint32_t>>& edges)
+{
+    // counting sort of edges by their source
+    offsets.assign(nodes + 1, 0);
+    for (const auto& edge : edges) {
+        ++offsets[edge.first + 1];
+    }
+    for (size_t i = 0; i != nodes; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    targets.resize(edges.size());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (const auto& edge : edges) {
+        targets[next[edge.first]++] = edge.second;
+    }
+}
+
+AssetGraph::Snapshot::Snapshot(tntdb::Connection& conn)
+{
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   id_asset_element, id_parent, id_type, id_subtype, name"
+        " FROM"
+        "   t_bios_asset_element"
+        " ORDER BY"
+        "   id_asset_element");
+
+    tntdb::Result result = st.select();
+    _nodes.reserve(result.size());
+    _byId.reserve(result.size());
+    _byName.reserve(result.size());
+    for (const auto& row : result) {
+        Node node;
+        row[0].get(node.id);
+        row[1].get(node.parent_id);
+        row[2].get(node.type_id);
+        row[3].get(node.subtype_id);
+        row[4].get(node.name);
+        _byId.emplace(node.id, uint32_t(_nodes.size()));
+        _byName.emplace(node.name, uint32_t(_nodes.size()));
+        _nodes.push_back(std::move(node));
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    _parent.assign(_nodes.size(), NONE);
+    for (uint32_t i = 0; i != _nodes.size(); ++i) {
+        uint32_t parent = index(_nodes[i].parent_id);
+        if (parent != NONE && parent != i) {
+            _parent[i] = parent;
+            edges.emplace_back(parent, i);
+        }
+    }
+    _children.build(_nodes.size(), edges);
+
+    tntdb::Statement links = conn.prepareCached(
+        " SELECT"
+        "   id_asset_device_src, id_asset_device_dest"
+        " FROM"
+        "   t_bios_asset_link"
+        " WHERE"
+        "   id_asset_link_type = :type");
+
+    edges.clear();
+    for (const auto& row : links.set("type", INPUT_POWER_CHAIN).select()) {
+        a_elmnt_id_t src = 0, dest = 0;
+        row[0].get(src);
+        row[1].get(dest);
+        uint32_t src_i = index(src), dest_i = index(dest);
+        if (src_i != NONE && dest_i != NONE) {
+            edges.emplace_back(src_i, dest_i);
+        }
+    }
+    _powerOut.build(_nodes.size(), edges);
+    for (auto& edge : edges) {
+        std::swap(edge.first, edge.second);
+    }
+    _powerIn.build(_nodes.size(), edges);
+
+    log_debug("asset graph loaded (%zu assets, %zu power links)", _nodes.size(), edges.size());
+}
+
+uint32_t AssetGraph::Snapshot::index(a_elmnt_id_t id) const
+{
+    auto it = _byId.find(id);
+    return it == _byId.end() ? NONE : it->second;
+}
+
+const AssetGraph::Node* AssetGraph::Snapshot::find(a_elmnt_id_t id) const
+{
+    uint32_t i = index(id);
+    return i == NONE ? nullptr : &_nodes[i];
+}
+
+const AssetGraph::Node* AssetGraph::Snapshot::find(const std::string& name) const
+{
+    auto it = _byName.find(name);
+    return it == _byName.end() ? nullptr : &_nodes[it->second];
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::neighbours(const Csr& csr, a_elmnt_id_t id) const
+{
+    Nodes    nodes;
+    uint32_t i = index(id);
+    if (i == NONE) {
+        return nodes;
+    }
+    nodes.reserve(csr.offsets[i + 1] - csr.offsets[i]);
+    for (uint32_t e = csr.offsets[i]; e != csr.offsets[i + 1]; ++e) {
+        nodes.push_back(&_nodes[csr.targets[e]]);
+    }
+    return nodes;
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::reachable(const Csr& csr, a_elmnt_id_t id) const
+{
+    Nodes    nodes;
+    uint32_t start = index(id);
+    if (start == NONE) {
+        return nodes;
+    }
+
+    // the result doubles as the queue of the breadth first search
+    std::vector<bool>     visited(_nodes.size(), false);
+    std::vector<uint32_t> queue{start};
+    visited[start] = true;
+    for (size_t head = 0; head != queue.size(); ++head) {
+        uint32_t i = queue[head];
+        for (uint32_t e = csr.offsets[i]; e != csr.offsets[i + 1]; ++e) {
+            uint32_t next = csr.targets[e];
+            if (!visited[next]) {
+                visited[next] = true;
+                queue.push_back(next);
+                nodes.push_back(&_nodes[next]);
+            }
+        }
+    }
+    return nodes;
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::children(a_elmnt_id_t id) const
+{
+    return neighbours(_children, id);
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::subtree(a_elmnt_id_t id) const
+{
+    return reachable(_children, id);
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::ancestors(a_elmnt_id_t id) const
+{
+    Nodes    nodes;
+    uint32_t i = index(id);
+    // a broken database might contain a loop, the chain cannot be longer than the number of assets
+    while (i != NONE && _parent[i] != NONE && nodes.size() < _nodes.size()) {
+        i = _parent[i];
+        nodes.push_back(&_nodes[i]);
+    }
+    return nodes;
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::power_sources(a_elmnt_id_t id) const
+{
+    return neighbours(_powerIn, id);
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::power_chain(a_elmnt_id_t id) const
+{
+    return reachable(_powerIn, id);
+}
+
+AssetGraph::Snapshot::Nodes AssetGraph::Snapshot::powered(a_elmnt_id_t id) const
+{
+    return reachable(_powerOut, id);
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+
+AssetGraph& AssetGraph::instance()
+{
+    static AssetGraph graph;
+    return graph;
+}
+
+std::shared_ptr<const AssetGraph::Snapshot> AssetGraph::get(tntdb::Connection& conn)
+{
+    std::call_once(_subscribed, [this]() {
+        AssetWatcher::instance().subscribe([this](const AssetWatcher::Event& event) {
+            // inventory messages change ext attributes only
+            if (!event.operation || !streq(event.operation, FTY_PROTO_ASSET_OP_INVENTORY)) {
+                invalidate();
+            }
+        });
+    });
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!AssetWatcher::instance().watching() || _stale || !_snapshot) {
+        // cleared first: a change arriving during the load marks the new snapshot stale
+        _stale    = false;
+        _snapshot = std::make_shared<const Snapshot>(conn);
+    }
+    return _snapshot;
+}
+
+void AssetGraph::invalidate()
+{
+    _stale = true;
+}
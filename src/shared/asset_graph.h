@@ -0,0 +1,140 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_graph.h
+/// @brief Process-wide in-memory graph of asset containment and power links
+///
+/// How it works
+/// ============
+/// The graph is loaded by two queries (elements with their parents, power
+/// links) into an immutable Snapshot: nodes in one array, children and
+/// power links in CSR form (offsets into flat arrays of node indexes), so
+/// that a traversal walks contiguous memory and takes no lock:
+///
+///     auto graph = AssetGraph::instance().get(conn);
+///     for (const AssetGraph::Node* node : graph->subtree(rack_id)) {
+///         ...
+///     }
+///
+/// The graph listens to the AssetWatcher. A change of an asset marks the
+/// graph stale and the next get() builds a new snapshot, readers still
+/// holding the old one are not disturbed. If the ASSETS stream is not
+/// consumed, every get() loads a fresh snapshot.
+
+#pragma once
+
+#include "dbtypes.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_map>
+#include <vector>
+
+class AssetGraph
+{
+public:
+    struct Node
+    {
+        a_elmnt_id_t    id         = 0;
+        a_elmnt_id_t    parent_id  = 0;
+        a_elmnt_tp_id_t type_id    = 0;
+        a_dvc_tp_id_t   subtype_id = 0;
+        std::string     name;
+    };
+
+    class Snapshot
+    {
+    public:
+        using Nodes = std::vector<const Node*>;
+
+        /// @throws std::exception on database error
+        explicit Snapshot(tntdb::Connection& conn);
+
+        /// Node of the asset, nullptr if not found
+        const Node* find(a_elmnt_id_t id) const;
+        const Node* find(const std::string& name) const;
+
+        size_t size() const
+        {
+            return _nodes.size();
+        }
+
+        /// Direct children of the asset
+        Nodes children(a_elmnt_id_t id) const;
+
+        /// All assets located in the asset, breadth first, the asset itself excluded
+        Nodes subtree(a_elmnt_id_t id) const;
+
+        /// Parent, grandparent, ... up to the top most location
+        Nodes ancestors(a_elmnt_id_t id) const;
+
+        /// Devices powering the asset directly
+        Nodes power_sources(a_elmnt_id_t id) const;
+
+        /// All devices upstream of the asset in the power chain, breadth first
+        Nodes power_chain(a_elmnt_id_t id) const;
+
+        /// All devices downstream of the asset in the power chain, breadth first
+        Nodes powered(a_elmnt_id_t id) const;
+
+    private:
+        static constexpr uint32_t NONE = uint32_t(-1);
+
+        struct Csr
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> targets;
+
+            void build(size_t nodes, const std::vector<std::pair<uint32_t, uint32_t>>& edges);
+        };
+
+        uint32_t index(a_elmnt_id_t id) const;
+        Nodes    neighbours(const Csr& csr, a_elmnt_id_t id) const;
+        Nodes    reachable(const Csr& csr, a_elmnt_id_t id) const;
+
+        std::vector<Node>                          _nodes;
+        std::vector<uint32_t>                      _parent;
+        std::unordered_map<a_elmnt_id_t, uint32_t> _byId;
+        std::unordered_map<std::string, uint32_t>  _byName;
+        Csr                                        _children;
+        Csr                                        _powerIn;
+        Csr                                        _powerOut;
+    };
+
+    static AssetGraph& instance();
+
+    /// Current snapshot of the graph, loaded again when assets changed
+    /// @throws std::exception on database error
+    std::shared_ptr<const Snapshot> get(tntdb::Connection& conn);
+
+    /// Drop the current snapshot
+    void invalidate();
+
+private:
+    AssetGraph() = default;
+
+    std::once_flag                  _subscribed;
+    std::mutex                      _mutex;
+    std::shared_ptr<const Snapshot> _snapshot;
+    std::atomic<bool>               _stale{true};
+};
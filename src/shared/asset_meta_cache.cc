@@ -0,0 +1,188 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_meta_cache.cc
+ * \brief Process-wide cache of asset name -> id, ext name, type and subtype
+ */
+#include "shared/asset_meta_cache.h"
+#include "shared/asset_watcher.h"
+#include <fty_common.h>
+#include <fty_log.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+#define ASSET_META_SELECT                                                                                              \
+    " SELECT"                                                                                                          \
+    "   v.id, v.name, v.type_name, v.subtype_name, ext.value"                                                          \
+    " FROM"                                                                                                            \
+    "   v_web_element v"                                                                                               \
+    " LEFT JOIN t_bios_asset_ext_attributes ext"                                                                       \
+    "   ON ext.id_asset_element = v.id AND ext.keytag = 'name'"
+
+// maximum number of names remembered as not found
+static constexpr size_t MISSING_MAX = 10000;
+
+static AssetMetaCache::Meta s_row_to_meta(const tntdb::Row& row)
+{
+    AssetMetaCache::Meta meta;
+    row[0].get(meta.id);
+    row[1].get(meta.name);
+    row[2].get(meta.type_name);
+    row[3].get(meta.subtype_name);
+    row[4].get(meta.ext_name);
+    return meta;
+}
+
+AssetMetaCache& AssetMetaCache::instance()
+{
+    static AssetMetaCache cache;
+    return cache;
+}
+
+bool AssetMetaCache::get(tntdb::Connection& conn, const std::string& name, Meta& meta)
+{
+    // not under the lock, the watcher calls invalidate() with its own lock held
+    std::call_once(_subscribed, [this]() {
+        AssetWatcher::instance().subscribe([this](const AssetWatcher::Event& event) {
+            if (event.name.empty()) {
+                clear();
+            } else {
+                invalidate(event.name);
+            }
+        });
+    });
+
+    if (!AssetWatcher::instance().watching()) {
+        // nobody tells us about changes, do not cache
+        return loadOne(conn, name, meta) == Lookup::FOUND;
+    }
+
+    bool     all;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto                        it = _assets.find(name);
+        if (it != _assets.end()) {
+            meta = it->second;
+            return true;
+        }
+        if (_missing.count(name)) {
+            return false;
+        }
+        // a lookup during the first load queries its asset only
+        all         = !_loaded && !_loadingAll;
+        _loadingAll = _loadingAll || all;
+        generation  = _generation;
+        ++_loading;
+    }
+
+    Assets assets;
+    Lookup found = Lookup::FAILED;
+    if (all) {
+        try {
+            loadAll(conn, assets);
+            auto it = assets.find(name);
+            found   = it == assets.end() ? Lookup::MISSING : Lookup::FOUND;
+            if (found == Lookup::FOUND) {
+                meta = it->second;
+            }
+        } catch (const std::exception& e) {
+            log_error("loading of asset cache failed: %s", e.what());
+        }
+    } else {
+        found = loadOne(conn, name, meta);
+        if (found == Lookup::FOUND) {
+            assets.emplace(name, meta);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation == _generation) {
+        for (auto& asset : assets) {
+            if (!_changed.count(asset.first)) {
+                _assets[asset.first] = std::move(asset.second);
+            }
+        }
+        if (found == Lookup::MISSING && !_changed.count(name)) {
+            if (_missing.size() >= MISSING_MAX) {
+                _missing.clear();
+            }
+            _missing.insert(name);
+        }
+        if (all) {
+            _loaded = found != Lookup::FAILED;
+        }
+    }
+    if (all) {
+        _loadingAll = false;
+    }
+    if (--_loading == 0) {
+        _changed.clear();
+    }
+    return found == Lookup::FOUND;
+}
+
+void AssetMetaCache::invalidate(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _assets.erase(name);
+    _missing.erase(name);
+    if (_loading) {
+        _changed.insert(name);
+    }
+}
+
+void AssetMetaCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _assets.clear();
+    _missing.clear();
+    _loaded = false;
+}
+
+void AssetMetaCache::loadAll(tntdb::Connection& conn, Assets& assets)
+{
+    tntdb::Statement st = conn.prepareCached(ASSET_META_SELECT);
+
+    for (const auto& row : st.select()) {
+        Meta meta = s_row_to_meta(row);
+        assets.emplace(meta.name, std::move(meta));
+    }
+    log_debug("asset cache loaded (%zu assets)", assets.size());
+}
+
+AssetMetaCache::Lookup AssetMetaCache::loadOne(tntdb::Connection& conn, const std::string& name, Meta& meta)
+{
+    try {
+        tntdb::Statement st  = conn.prepareCached(ASSET_META_SELECT " WHERE v.name = :name");
+        tntdb::Row       row = st.set("name", name).selectRow();
+        meta                 = s_row_to_meta(row);
+        return Lookup::FOUND;
+    } catch (const tntdb::NotFound&) {
+        log_debug("asset '%s' not found", name.c_str());
+        return Lookup::MISSING;
+    } catch (const std::exception& e) {
+        log_error("select of asset '%s' failed: %s", name.c_str(), e.what());
+    }
+    return Lookup::FAILED;
+}
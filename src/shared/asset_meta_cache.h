@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_meta_cache.h
+/// @brief Process-wide cache of asset name -> id, ext name, type and subtype
+///
+/// How it works
+/// ============
+/// The first lookup loads every asset with one query. Entries are dropped
+/// when the AssetWatcher reports a change of the asset and are then
+/// reloaded one by one on demand. Names not found are remembered as well,
+/// until the asset shows up on the stream. If the ASSETS stream is not
+/// consumed the cache is bypassed and every lookup hits the database, as
+/// before.
+///
+/// The database is queried without the lock: a lookup missing the cache
+/// does not block the others. Results of a query are not cached for assets
+/// changed while it was running.
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_map>
+#include <unordered_set>
+
+class AssetMetaCache
+{
+public:
+    struct Meta
+    {
+        uint32_t    id = 0;
+        std::string name;
+        std::string ext_name;
+        std::string type_name;
+        std::string subtype_name;
+    };
+
+    static AssetMetaCache& instance();
+
+    /// Get metadata of the asset
+    /// @return false if the asset does not exist or on database error
+    bool get(tntdb::Connection& conn, const std::string& name, Meta& meta);
+
+    /// Drop the asset from the cache
+    void invalidate(const std::string& name);
+
+private:
+    AssetMetaCache() = default;
+
+    enum class Lookup
+    {
+        FOUND,
+        MISSING,
+        FAILED
+    };
+
+    using Assets = std::unordered_map<std::string, Meta>;
+
+    void   clear();
+    void   loadAll(tntdb::Connection& conn, Assets& assets);
+    Lookup loadOne(tntdb::Connection& conn, const std::string& name, Meta& meta);
+
+    std::once_flag                  _subscribed;
+    std::mutex                      _mutex;
+    Assets                          _assets;
+    std::unordered_set<std::string> _missing;
+    bool                            _loaded     = false;
+    bool                            _loadingAll = false;
+    // bumped by clear(), results of queries started before are not cached
+    uint64_t                        _generation = 0;
+    // queries running and names changed since the oldest one started
+    unsigned                        _loading = 0;
+    std::unordered_set<std::string> _changed;
+};
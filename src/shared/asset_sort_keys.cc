@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_sort_keys.cc
+ * \brief Process-wide cache of asset orders for topology replies
+ */
+#include "shared/asset_sort_keys.h"
+#include "shared/asset_watcher.h"
+#include <algorithm>
+#include <fty_common.h>
+#include <fty_log.h>
+#include <tntdb/result.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+// maximum number of cached orders, keytags are limited by the callers
+static constexpr size_t MAX_ORDERS = 32;
+
+// the former ORDER BY, assets without the attribute go last in both directions
+static const std::string SELECT_ORDER =
+    " SELECT"
+    "   e.name"
+    " FROM"
+    "   t_bios_asset_element e"
+    " LEFT JOIN t_bios_asset_ext_attributes a"
+    "   ON e.id_asset_element = a.id_asset_element AND a.keytag = :keytag"
+    " LEFT JOIN t_bios_asset_ext_attributes n"
+    "   ON e.id_asset_element = n.id_asset_element AND n.keytag = 'name'"
+    " ORDER BY";
+static const std::string ORDER_ASC  = " COALESCE(a.value, 'ZZZZZZ999999') ASC, n.value ASC";
+static const std::string ORDER_DESC = " a.value DESC, n.value DESC";
+
+AssetSortKeys& AssetSortKeys::instance()
+{
+    static AssetSortKeys keys;
+    return keys;
+}
+
+std::shared_ptr<const AssetSortKeys::Ranks> AssetSortKeys::fetch(tntdb::Connection& conn, const Order& order)
+{
+    uint64_t         generation = _generation;
+    tntdb::Statement st         = conn.prepareCached(SELECT_ORDER + (order.second ? ORDER_ASC : ORDER_DESC));
+
+    auto ranks = std::make_shared<Ranks>();
+    for (const auto& row : st.set("keytag", order.first).select()) {
+        std::string name;
+        row[0].get(name);
+        size_t rank = ranks->size();
+        ranks->emplace(std::move(name), rank);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!AssetWatcher::instance().watching() || generation != _generation) {
+        return ranks;
+    }
+    if (_orders.size() >= MAX_ORDERS) {
+        _orders.clear();
+    }
+    _orders[order] = ranks;
+    return ranks;
+}
+
+void AssetSortKeys::sort(
+    tntdb::Connection& conn, std::vector<std::string>& names, const std::string& keytag, bool ascending)
+{
+    // not under the lock, the watcher calls invalidate() with its own lock held
+    std::call_once(_subscribed, [this]() {
+        AssetWatcher::instance().subscribe([this](const AssetWatcher::Event& event) {
+            if (event.name.empty()) {
+                clear();
+            } else {
+                invalidate(event.name);
+            }
+        });
+    });
+
+    Order                        order{keytag, ascending};
+    std::shared_ptr<const Ranks> ranks;
+    if (AssetWatcher::instance().watching()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto                        it = _orders.find(order);
+        if (it != _orders.end()) {
+            ranks = it->second;
+        }
+    }
+    // an asset created after the order was fetched, its event is not here yet
+    if (ranks && std::any_of(names.begin(), names.end(), [&ranks](const std::string& name) {
+            return ranks->count(name) == 0;
+        })) {
+        ranks.reset();
+    }
+    if (!ranks) {
+        ranks = fetch(conn, order);
+    }
+
+    std::vector<std::pair<size_t, std::string>> items;
+    items.reserve(names.size());
+    for (auto& name : names) {
+        auto it = ranks->find(name);
+        if (it == ranks->end()) {
+            log_warning("asset %s not found, it is left out of the sorted list", name.c_str());
+            continue;
+        }
+        items.emplace_back(it->second, std::move(name));
+    }
+    std::sort(items.begin(), items.end());
+
+    names.clear();
+    for (auto& item : items) {
+        names.push_back(std::move(item.second));
+    }
+}
+
+void AssetSortKeys::invalidate(const std::string& /* name */)
+{
+    clear();
+}
+
+void AssetSortKeys::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _orders.clear();
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_sort_keys.h
+/// @brief Process-wide cache of asset orders for topology replies
+///
+/// How it works
+/// ============
+/// Topology replies are sorted by an ext attribute (asset_order, name, ...)
+/// and then by the ext name. The database sorts all assets with the former
+/// SQL ORDER BY, by one of two statements of fixed text (ascending and
+/// descending) with the keytag bound as a parameter. Prepared statements
+/// are reused by every request and values are compared by the collation of
+/// the database. The resulting position of every asset is cached per keytag
+/// and direction, a request only looks up positions of its assets.
+///
+/// A change of one asset may move it anywhere in every order, so each
+/// change reported by the AssetWatcher drops all cached orders. If the
+/// ASSETS stream is not consumed, nothing is cached and every request sorts
+/// all assets again.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tntdb/connection.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class AssetSortKeys
+{
+public:
+    static AssetSortKeys& instance();
+
+    /// Sort names of assets by the value of keytag, then by their ext name.
+    /// Names not found in the database are removed.
+    /// @throws std::exception on database error
+    void sort(tntdb::Connection& conn, std::vector<std::string>& names, const std::string& keytag, bool ascending);
+
+    /// Drop cached orders, the asset may have moved in any of them
+    void invalidate(const std::string& name);
+
+private:
+    /// internal name -> position of the asset in one order
+    using Ranks = std::unordered_map<std::string, size_t>;
+
+    /// keytag and ascending
+    using Order = std::pair<std::string, bool>;
+
+    AssetSortKeys() = default;
+
+    std::shared_ptr<const Ranks> fetch(tntdb::Connection& conn, const Order& order);
+
+    void clear();
+
+    std::once_flag                                _subscribed;
+    std::mutex                                    _mutex;
+    std::map<Order, std::shared_ptr<const Ranks>> _orders;
+    // bumped by every invalidation, orders fetched before that are not cached
+    std::atomic<uint64_t>                         _generation{0};
+};
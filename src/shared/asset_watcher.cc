@@ -0,0 +1,168 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file asset_watcher.cc
+ * \brief Process-wide consumer of the ASSETS stream shared by asset caches
+ */
+#include "shared/asset_watcher.h"
+#include <fty_common_mlm_utils.h>
+#include <algorithm>
+#include <chrono>
+#include <fty_log.h>
+
+/// Wait before reconnecting of the ASSETS stream, in ms, doubled after each failure
+static constexpr int WATCHER_BACKOFF_MIN = 1000;
+static constexpr int WATCHER_BACKOFF_MAX = 60000;
+
+AssetWatcher& AssetWatcher::instance()
+{
+    static AssetWatcher watcher;
+    return watcher;
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool AssetWatcher::subscribe(Listener listener)
+{
+    std::call_once(_started, &AssetWatcher::start, this);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _listeners.push_back(std::move(listener));
+    return _watching;
+}
+
+void AssetWatcher::changed(const std::string& name, const char* operation)
+{
+    Event event;
+    event.name      = name;
+    event.operation = operation;
+    dispatch(event);
+}
+
+void AssetWatcher::dispatch(const Event& event)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& listener : _listeners) {
+        listener(event);
+    }
+}
+
+mlm_client_t* AssetWatcher::connect()
+{
+    mlm_client_t* client      = mlm_client_new();
+    std::string   client_name = utils::generate_mlm_client_id("web.asset_watcher");
+    if (!client || mlm_client_connect(client, MLM_ENDPOINT, 1000, client_name.c_str()) == -1 ||
+        mlm_client_set_consumer(client, FTY_PROTO_STREAM_ASSETS, ".*") == -1) {
+        mlm_client_destroy(&client);
+        return nullptr;
+    }
+    return client;
+}
+
+void AssetWatcher::start()
+{
+    // first attempt is synchronous, so that the first subscriber knows whether caching works
+    mlm_client_t* client = connect();
+    if (client) {
+        _watching = true;
+    } else {
+        log_error("asset watcher: cannot consume ASSETS stream, asset caches are disabled until it is reconnected");
+    }
+
+    // from now on the client is used by the watcher thread only
+    _thread = std::thread(&AssetWatcher::run, this, client);
+}
+
+void AssetWatcher::run(mlm_client_t* client)
+{
+    int backoff = WATCHER_BACKOFF_MIN;
+    while (!_stop) {
+        if (!client) {
+            // wait by small steps, so that the destructor does not wait for the whole backoff
+            for (int waited = 0; waited < backoff && !_stop; waited += 100) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            if (_stop) {
+                break;
+            }
+            client = connect();
+            if (!client) {
+                backoff = std::min(backoff * 2, WATCHER_BACKOFF_MAX);
+                continue;
+            }
+            // changes done while the stream was not consumed are unknown
+            dispatch(Event());
+            _watching = true;
+            log_info("asset watcher: ASSETS stream consumed again, asset caches are enabled");
+        }
+        backoff = WATCHER_BACKOFF_MIN;
+
+        watch(client);
+        mlm_client_destroy(&client);
+
+        // changes are not tracked anymore
+        _watching = false;
+        dispatch(Event());
+        if (!_stop) {
+            log_error("asset watcher: ASSETS stream lost, asset caches are disabled until it is reconnected");
+        }
+    }
+    mlm_client_destroy(&client);
+}
+
+void AssetWatcher::watch(mlm_client_t* client)
+{
+    zpoller_t* poller = zpoller_new(mlm_client_msgpipe(client), NULL);
+    while (!_stop) {
+        if (!zpoller_wait(poller, 1000)) {
+            if (zpoller_terminated(poller) || !mlm_client_connected(client)) {
+                break;
+            }
+            continue;
+        }
+
+        zmsg_t* msg = mlm_client_recv(client);
+        if (!msg) {
+            // client was interrupted or its connection is gone
+            break;
+        }
+        if (!fty_proto_is(msg)) {
+            zmsg_destroy(&msg);
+            continue;
+        }
+        fty_proto_t* proto = fty_proto_decode(&msg);
+        if (proto && fty_proto_id(proto) == FTY_PROTO_ASSET) {
+            Event event;
+            event.name      = fty_proto_name(proto);
+            event.operation = fty_proto_operation(proto);
+            event.asset     = proto;
+            dispatch(event);
+        }
+        fty_proto_destroy(&proto);
+    }
+    zpoller_destroy(&poller);
+}
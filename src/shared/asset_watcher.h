@@ -0,0 +1,110 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file asset_watcher.h
+/// @brief Process-wide consumer of the ASSETS stream shared by asset caches
+///
+/// How it works
+/// ============
+/// One malamute client consumes the ASSETS stream in its own thread, started
+/// by the first subscribe(). Each message is passed to all listeners, in the
+/// order they subscribed, from that thread:
+///
+///     AssetWatcher::instance().subscribe([this](const AssetWatcher::Event& event) {
+///         invalidate(event.name);
+///     });
+///
+/// Writes of this process are announced by changed() as soon as they are
+/// committed, so that a read following the write does not get a stale cache
+/// before the message published by send_configure() comes back from the
+/// stream. Listeners get such change twice and must be idempotent.
+///
+/// If the stream cannot be consumed or is lost, watching() is false and the
+/// listeners get an event with an empty name: caches must forget everything
+/// and must not cache while watching() is false. The watcher thread then
+/// reconnects, waiting 1s after the first failure and up to 1 minute after
+/// next ones. Once reconnected, listeners get one more event with an empty
+/// name (changes made meanwhile are unknown) and watching() is true again.
+
+#pragma once
+
+#include <atomic>
+#include <fty_proto.h>
+#include <functional>
+#include <malamute.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AssetWatcher
+{
+public:
+    struct Event
+    {
+        /// name of the changed asset, empty when all assets may have changed
+        std::string name;
+        /// FTY_PROTO_ASSET_OP_*, nullptr when all assets may have changed
+        const char* operation = nullptr;
+        /// the stream message, nullptr for changes announced by changed()
+        fty_proto_t* asset = nullptr;
+    };
+
+    /// Called from the watcher thread (or from the writer calling changed()),
+    /// listeners are serialized and must not call back the watcher
+    using Listener = std::function<void(const Event& event)>;
+
+    static AssetWatcher& instance();
+
+    ~AssetWatcher();
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    /// Register the listener, the first call starts the watcher
+    /// @return watching()
+    bool subscribe(Listener listener);
+
+    /// Announce a change committed by this process
+    void changed(const std::string& name, const char* operation);
+
+    /// True while the ASSETS stream is consumed, may change at any time
+    bool watching() const
+    {
+        return _watching;
+    }
+
+private:
+    AssetWatcher() = default;
+
+    static mlm_client_t* connect();
+
+    void start();
+    void run(mlm_client_t* client);
+    void watch(mlm_client_t* client);
+    void dispatch(const Event& event);
+
+    std::once_flag        _started;
+    std::mutex            _mutex;
+    std::vector<Listener> _listeners;
+    std::atomic<bool>     _watching{false};
+    std::atomic<bool>     _stop{false};
+    std::thread           _thread;
+};
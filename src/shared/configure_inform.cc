@@ -19,9 +19,9 @@
  */
 
 #include "shared/configure_inform.h"
+#include "db/connection_pool.h"
 #include <fty_common.h>
 #include <fty_common_db_asset_insert.h>
-#include <fty_common_db_dbpath.h>
 #include <fty_common_mlm_utils.h>
 #include <fty_proto.h>
 #include <malamute.h>
@@ -56,7 +56,7 @@ void send_configure(
         mlm_client_destroy(&client);
         throw std::runtime_error(" mlm_client_set_producer () failed.");
     }
-    tntdb::Connection conn = tntdb::connect(DBConn::url);
+    auto conn = persist::ConnectionPool::instance().acquire();
     for (const auto& oneRow : rows) {
 
         std::string s_priority   = std::to_string(oneRow.first.priority);
@@ -19,30 +19,30 @@
  */
 
 #include "csv.h"
+#include "csv_reader.h"
 #include "persist/assetcrud.h"
 #include <algorithm>
-#include <cxxtools/csvdeserializer.h>
 #include <fty_common.h>
 #include <fty_common_macros.h>
 #include <iostream>
 #include <set>
-#include <sstream>
 #include <stdexcept>
 
 namespace shared {
 
 /* Workaround for a fact a) std::transform to do a strip and lower is weird, b) it breaks the map somehow*/
-static const std::string _ci_strip(const std::string& str)
+static std::string _ci_strip(const std::string& str)
 {
-    std::ostringstream b;
+    std::string b;
+    b.reserve(str.size());
 
     for (const char c : str) {
         // allowed chars [a-zA-Z0-9_\.]
         if (::isalnum(c) || c == '_' || c == '.')
-            b << static_cast<char>(::tolower(c));
+            b.push_back(static_cast<char>(::tolower(c)));
     }
 
-    return b.str();
+    return b;
 }
 
 void CsvMap::deserialize()
@@ -60,7 +60,7 @@ void CsvMap::deserialize()
             throw std::invalid_argument(msg);
         }
 
-        _title_to_index.emplace(title, i);
+        _title_to_index.emplace(title, Column{i});
         i++;
     }
 }
@@ -75,12 +75,13 @@ const std::string& CsvMap::get(size_t row_i, const std::string& title_name) cons
 
     std::string title = _ci_strip(title_name);
 
-    if (_title_to_index.count(title) == 0) {
+    auto it = _title_to_index.find(title);
+    if (it == _title_to_index.end()) {
         std::string msg = TRANSLATE_ME("title name '%s' not found", title.c_str());
         throw std::out_of_range{msg};
     }
 
-    size_t col_i = _title_to_index.at(title);
+    size_t col_i = it->second.index;
     if (col_i >= _data[row_i].size()) {
         const char* err = "On line %zu: requested column %s (index %zu) where maximum is %zu";
         throw std::out_of_range(TRANSLATE_ME(err, row_i + 1, title_name.c_str(), col_i + 1, _data[row_i].size()));
@@ -93,6 +94,34 @@ std::string CsvMap::get_strip(size_t row_i, const std::string& title_name) const
     return _ci_strip(get(row_i, title_name));
 }
 
+CsvMap::Column CsvMap::column(const std::string& title_name) const
+{
+    auto it = _title_to_index.find(_ci_strip(title_name));
+    return it == _title_to_index.end() ? Column{} : it->second;
+}
+
+const std::string& CsvMap::get(size_t row_i, Column column) const
+{
+    if (row_i >= _data.size()) {
+        std::string msg = TRANSLATE_ME("row_index %zu was out of range %zu", row_i, _data.size());
+        throw std::out_of_range(msg);
+    }
+    if (!column.valid()) {
+        std::string msg = TRANSLATE_ME("column not found");
+        throw std::out_of_range{msg};
+    }
+    if (column.index >= _data[row_i].size()) {
+        const char* err = "On line %zu: requested column index %zu where maximum is %zu";
+        throw std::out_of_range(TRANSLATE_ME(err, row_i + 1, column.index + 1, _data[row_i].size()));
+    }
+    return _data[row_i][column.index];
+}
+
+std::string CsvMap::get_strip(size_t row_i, Column column) const
+{
+    return _ci_strip(get(row_i, column));
+}
+
 bool CsvMap::hasTitle(const std::string& title_name) const
 {
     std::string title = _ci_strip(title_name);
@@ -102,8 +131,8 @@ bool CsvMap::hasTitle(const std::string& title_name) const
 std::set<std::string> CsvMap::getTitles() const
 {
     std::set<std::string> ret{};
-    for (auto i : _title_to_index) {
-        ret.emplace(i.first);
+    for (const auto& i : _title_to_index) {
+        ret.emplace_hint(ret.end(), i.first);
     }
     return ret;
 }
@@ -158,49 +187,90 @@ void skip_utf8_BOM(std::istream& i)
     i.putback(char(c1));
 }
 
-char findDelimiter(std::istream& i, std::size_t max_pos)
+CsvDialect sniffDialect(std::istream& i, std::size_t block_size)
 {
-    for (std::size_t pos = 0; i.good() && !i.eof() && pos != max_pos; pos++) {
-        i.seekg(std::streamoff(pos));
-        char ret = char(i.peek());
-        if (ret == ',' || ret == ';' || ret == '\t') {
-            i.seekg(0);
-            return ret;
+    CsvDialect dialect;
+
+    std::streampos start = i.tellg();
+    std::string    block(block_size, '\0');
+    i.read(&block[0], std::streamsize(block_size));
+    block.resize(size_t(i.gcount()));
+    i.clear();
+
+    size_t pos = 0;
+    if (block.compare(0, 3, "\xef\xbb\xbf") == 0) {
+        dialect.bom = true;
+        pos         = 3;
+    }
+    i.seekg(start + std::streamoff(pos));
+
+    // count delimiters on the first line, quoted fields may span lines
+    static const char candidates[] = {',', ';', '\t'};
+    size_t            counts[3]    = {0, 0, 0};
+    size_t            first[3]     = {block.size(), block.size(), block.size()};
+    bool              quoted       = false;
+    bool              at_start     = true;
+    for (; pos < block.size(); ++pos) {
+        char c = block[pos];
+        if (quoted) {
+            // a doubled quote closes and opens again, the result is the same
+            quoted = c != '"';
+            continue;
+        }
+        if (at_start && c == '"') {
+            quoted = true;
+            continue;
+        }
+        if (c == '\n' || c == '\r') {
+            break;
+        }
+        at_start = false;
+        for (size_t k = 0; k != 3; ++k) {
+            if (c == candidates[k]) {
+                ++counts[k];
+                first[k] = std::min(first[k], pos);
+                at_start = true;
+            }
         }
     }
-    i.seekg(0);
-    return '\x0';
-}
 
-bool hasApostrof(std::istream& i)
-{
-    for (std::size_t pos = 0; i.good() && !i.eof(); pos++) {
-        i.seekg(std::streamoff(pos));
-        char ret = char(i.peek());
-        if (ret == '\'') {
-            i.seekg(0);
-            return true;
+    size_t best = 3;
+    for (size_t k = 0; k != 3; ++k) {
+        if (counts[k] != 0 &&
+            (best == 3 || counts[k] > counts[best] || (counts[k] == counts[best] && first[k] < first[best]))) {
+            best = k;
         }
     }
-    i.seekg(0);
-    return false;
+    if (best != 3) {
+        dialect.delimiter = candidates[best];
+    }
+    return dialect;
 }
+
 CsvMap CsvMap_from_istream(std::istream& in)
 {
-    std::vector<std::vector<std::string>> data;
-    cxxtools::CsvDeserializer                  deserializer(in);
-    char                                       delimiter = findDelimiter(in);
-    if (delimiter == '\x0') {
+    CsvDialect dialect = sniffDialect(in);
+    if (dialect.delimiter == '\x0') {
         std::string msg = TRANSLATE_ME("Cannot detect the delimiter, use comma (,) semicolon (;) or tabulator");
         log_error("%s\n", msg.c_str());
         LOG_END;
         throw std::invalid_argument(msg);
     }
-    log_debug("Using delimiter '%c'", delimiter);
-    deserializer.delimiter(delimiter);
-    deserializer.readTitle(false);
-    deserializer.deserialize(data);
-    CsvMap cm{data};
+    log_debug("Using delimiter '%c'", dialect.delimiter);
+    return CsvMap_from_istream(in, dialect.delimiter);
+}
+
+CsvMap CsvMap_from_istream(std::istream& in, char delimiter)
+{
+    CsvMap::Data                  data;
+    CsvReader                     reader(in, delimiter);
+    std::vector<std::string_view> fields;
+    while (reader.next(fields)) {
+        data.emplace_back(fields.begin(), fields.end());
+    }
+    data.shrink_to_fit();
+
+    CsvMap cm{std::move(data)};
     cm.deserialize();
     return cm;
 }
@@ -39,12 +39,19 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 ///
 ///    assert (cm.get(0, "nAMe") == "Name");
 ///    assert (cm.get(1, " name") == "RACK-01");
+///
+/// When the same column is read for many rows, resolve it once:
+///
+///    auto name = cm.column("name");
+///    for (size_t row_i = 1; row_i != cm.rows(); ++row_i)
+///        use(cm.get(row_i, name));
 
 #pragma once
 
 #include <cstdint>
 #include <cxxtools/csvdeserializer.h>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -61,12 +68,31 @@ class CsvMap
 public:
     using Data = std::vector<std::vector<std::string>>;
 
+    /// Handle of a column, see column()
+    struct Column
+    {
+        static constexpr size_t NONE = size_t(-1);
+
+        size_t index = NONE;
+
+        /// false if the title was not found
+        bool valid() const
+        {
+            return index != NONE;
+        }
+    };
+
 public:
     /// Creates new CsvMap instance with data inside
     CsvMap(const Data& data)
         : _data{data}
         , _title_to_index{} {};
 
+    /// Creates new CsvMap instance taking the data over, without a copy
+    CsvMap(Data&& data)
+        : _data{std::move(data)}
+        , _title_to_index{} {};
+
     /// Creates an empty CsvMap instance
     CsvMap(void)
         : _data{}
@@ -87,6 +113,19 @@ public:
     /// @throws std::out_of_range if row_i > data.size() or title_name is not known
     std::string get_strip(size_t row_i, const std::string& title_name) const;
 
+    /// resolve the title name to a column handle, invalid handle if title_name is not known
+    Column column(const std::string& title_name) const;
+
+    /// return the content on row in the given column
+    ///
+    /// @throws std::out_of_range if row_i > data.size(), column is invalid or missing on the row
+    const std::string& get(size_t row_i, Column column) const;
+
+    /// return the content on row in the given column striped and in lower case
+    ///
+    /// @throws std::out_of_range if row_i > data.size(), column is invalid or missing on the row
+    std::string get_strip(size_t row_i, Column column) const;
+
     /// return number of rows
     size_t rows() const
     {
@@ -109,6 +148,14 @@ public:
      */
     std::set<std::string> getTitles() const;
 
+    /**
+     * \brief get all (normalized) titles with their columns, without a copy
+     */
+    const std::map<std::string, Column>& columns() const
+    {
+        return _title_to_index;
+    }
+
     std::string getCreateUser() const;
     std::string getUpdateUser() const;
     std::string getUpdateTs() const;
@@ -121,7 +168,7 @@ public:
 
 private:
     Data                          _data;
-    std::map<std::string, size_t> _title_to_index;
+    std::map<std::string, Column> _title_to_index;
     std::string                   _create_user, _update_user, _update_ts;
     uint32_t                      _create_mode;
 };
@@ -129,36 +176,56 @@ private:
 // TODO: does not belongs to csv, move somewhere else
 void skip_utf8_BOM(std::istream& i);
 
-/**
- * \brief find the delimiter used in csv file
- *
- * \param i istream, which is analyzed
- * \param max_pos specifies how many bytes should be investigated before
- *                \x0 is returned. Defaults to 60.
- *
- * \return ';' or '\t' or '\x0' if nothing found in first \max_pos bytes
- */
-char findDelimiter(std::istream& i, std::size_t max_pos = 60);
+/// Format of a csv file, see sniffDialect()
+struct CsvDialect
+{
+    /// ',' or ';' or '\t', '\x0' if not detected
+    char delimiter = '\x0';
+    /// true if the input starts by UTF-8 BOM
+    bool bom = false;
+};
 
 /**
- * \brief check apostrofs
+ * \brief detect the format of csv file
+ *
+ * Only the first block of the input is read, the delimiter is the most
+ * frequent of comma, semicolon and tabulator outside of double quotes (the
+ * only quote CsvReader knows) on the first line. On return, the stream is
+ * positioned at the beginning of the data, behind the BOM if any.
  *
- * \param i istream, which is analyzed
+ * \param i istream, which is analyzed, must be seekable
+ * \param block_size how many bytes are investigated
  *
- * \return true if there is at leas one apostrof
+ * \return detected dialect, delimiter is '\x0' if nothing was found
  */
-bool hasApostrof(std::istream& i);
+CsvDialect sniffDialect(std::istream& i, std::size_t block_size = 4096);
 
 /**
  *  \brief read the data from istream
  *
  *  \param[in] input stream
+ *  Dialect is detected by sniffDialect().
+ *
  *  \return CsvMap instance
  *  \throws invalid_argument if delimiter was not autodetected
  *          ... or various other exceptions ;-)
  */
 CsvMap CsvMap_from_istream(std::istream& in);
 
+/**
+ *  \brief read the data from istream with a known delimiter
+ *
+ *  Rows are tokenized by CsvReader straight into the CsvMap, no intermediate
+ *  copy of the input is made. The whole table is kept in memory, csv import
+ *  (persist::load_asset_csv(std::istream&)) reads the file by parts instead.
+ *
+ *  \param[in] input stream
+ *  \param[in] delimiter of the fields
+ *  \return CsvMap instance
+ *  \throws invalid_argument if csv contain multiple title with the same name
+ */
+CsvMap CsvMap_from_istream(std::istream& in, char delimiter);
+
 /**
  *  \brief read the data from serialization info
  *
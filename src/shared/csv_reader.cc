@@ -0,0 +1,137 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file csv_reader.cc
+ * \brief Streaming csv tokenizer
+ */
+#include "shared/csv_reader.h"
+
+namespace shared {
+
+CsvReader::CsvReader(std::istream& in, char delimiter, size_t blockSize)
+    : _in(in)
+    , _delimiter(delimiter)
+    , _block(blockSize)
+{
+}
+
+bool CsvReader::fill()
+{
+    if (!_in.good()) {
+        return false;
+    }
+    _in.read(_block.data(), std::streamsize(_block.size()));
+    _pos = 0;
+    _end = size_t(_in.gcount());
+    return _end != 0;
+}
+
+int CsvReader::peek()
+{
+    if (_pos == _end && !fill()) {
+        return EOF;
+    }
+    return static_cast<unsigned char>(_block[_pos]);
+}
+
+int CsvReader::get()
+{
+    int ch = peek();
+    if (ch != EOF) {
+        ++_pos;
+        if (ch == '\n') {
+            ++_line;
+        }
+    }
+    return ch;
+}
+
+bool CsvReader::next(std::vector<std::string_view>& fields)
+{
+    fields.clear();
+    _row.clear();
+    _spans.clear();
+
+    // skip empty lines
+    int ch = peek();
+    while (ch == '\n' || ch == '\r') {
+        get();
+        ch = peek();
+    }
+    if (ch == EOF) {
+        return false;
+    }
+    _rowLine = _line;
+
+    size_t start   = 0;
+    bool   atStart = true;
+    bool   quoted  = false;
+    while (true) {
+        ch = get();
+
+        if (quoted) {
+            if (ch == EOF) {
+                // unterminated quote, take what we have
+                quoted = false;
+            } else if (ch == '"') {
+                if (peek() == '"') {
+                    _row += char(get());
+                } else {
+                    quoted = false;
+                }
+                continue;
+            } else {
+                _row += char(ch);
+                continue;
+            }
+        }
+
+        if (ch == EOF || ch == '\n' || ch == '\r' || ch == _delimiter) {
+            _spans.emplace_back(start, _row.size() - start);
+            start   = _row.size();
+            atStart = true;
+            if (ch == _delimiter) {
+                continue;
+            }
+            if (ch == '\r' && peek() == '\n') {
+                get();
+            }
+            break;
+        }
+
+        if (atStart && ch == '"') {
+            quoted  = true;
+            atStart = false;
+            continue;
+        }
+        atStart = false;
+        _row += char(ch);
+    }
+
+    // views are created at the end, _row may have been reallocated meanwhile
+    fields.reserve(_spans.size());
+    for (const auto& span : _spans) {
+        fields.emplace_back(_row.data() + span.first, span.second);
+    }
+    return true;
+}
+
+} // namespace shared
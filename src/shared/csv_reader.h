@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file csv_reader.h
+/// @brief Streaming csv tokenizer
+///
+/// How it works
+/// ============
+/// The input is read by blocks into a buffer reused for the whole stream.
+/// Fields of one row are unescaped into a second reused buffer and returned
+/// as string_views, valid until the next call of next():
+///
+///     shared::CsvReader reader(in, ',');
+///     std::vector<std::string_view> fields;
+///     while (reader.next(fields)) {
+///         ...
+///     }
+///
+/// Memory used by the reader is bounded by the block size and by the
+/// longest row, not by the size of the input.
+///
+/// A field starting with a double quote is quoted, the quote is doubled
+/// inside the field. An apostrophe is an ordinary character, so values
+/// like 'rack 1 or O'Brien are read as they are. Rows end by LF, CRLF or
+/// CR, empty lines are skipped. The delimiter is found by sniffDialect(),
+/// which knows the same quoting.
+
+#pragma once
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace shared {
+
+class CsvReader
+{
+public:
+    CsvReader(std::istream& in, char delimiter, size_t blockSize = 64 * 1024);
+
+    CsvReader(const CsvReader&) = delete;
+    CsvReader& operator=(const CsvReader&) = delete;
+
+    /// Read the next row
+    /// @param[out] fields - fields of the row, valid until the next call
+    /// @return false at the end of the input
+    bool next(std::vector<std::string_view>& fields);
+
+    /// Line of the input where the last returned row started (1 based)
+    size_t line() const
+    {
+        return _rowLine;
+    }
+
+private:
+    int  get();
+    int  peek();
+    bool fill();
+
+    std::istream&                         _in;
+    char                                  _delimiter;
+    std::vector<char>                     _block;
+    size_t                                _pos  = 0;
+    size_t                                _end  = 0;
+    size_t                                _line = 1;
+    size_t                                _rowLine = 0;
+    std::string                           _row;
+    std::vector<std::pair<size_t, size_t>> _spans;
+};
+
+} // namespace shared
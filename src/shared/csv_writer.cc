@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file csv_writer.cc
+ * \brief Streaming csv writer
+ */
+#include "shared/csv_writer.h"
+#include <cstdio>
+
+namespace shared {
+
+CsvWriter::CsvWriter(std::ostream& os, char delimiter, size_t bufferSize)
+    : _os(os)
+    , _delimiter(delimiter)
+    , _bufferSize(bufferSize)
+{
+    _buffer.reserve(bufferSize + bufferSize / 4);
+}
+
+CsvWriter::~CsvWriter()
+{
+    flush();
+}
+
+CsvWriter& CsvWriter::field(std::string_view v)
+{
+    if (!_rowStart) {
+        _buffer += _delimiter;
+    }
+    _rowStart = false;
+
+    bool quote = !v.empty() && v[0] == '\'';
+    for (size_t i = 0; !quote && i != v.size(); ++i) {
+        char c = v[i];
+        quote  = c == _delimiter || c == '"' || c == '\n' || c == '\r';
+    }
+    if (!quote) {
+        _buffer.append(v.data(), v.size());
+        return *this;
+    }
+
+    _buffer += '"';
+    size_t start = 0;
+    for (size_t i = 0; i != v.size(); ++i) {
+        if (v[i] == '"') {
+            _buffer.append(v.data() + start, i + 1 - start);
+            _buffer += '"';
+            start = i + 1;
+        }
+    }
+    _buffer.append(v.data() + start, v.size() - start);
+    _buffer += '"';
+    return *this;
+}
+
+CsvWriter& CsvWriter::field(uint32_t v)
+{
+    char buf[16];
+    int  n = snprintf(buf, sizeof(buf), "%u", v);
+    return field(std::string_view(buf, size_t(n)));
+}
+
+CsvWriter& CsvWriter::endRow()
+{
+    _buffer += '\n';
+    _rowStart = true;
+    ++_rows;
+    if (_buffer.size() >= _bufferSize) {
+        flush();
+    }
+    return *this;
+}
+
+bool CsvWriter::flush()
+{
+    if (!_buffer.empty()) {
+        _os.write(_buffer.data(), std::streamsize(_buffer.size()));
+        _buffer.clear();
+    }
+    return !_os.flush().fail();
+}
+
+} // namespace shared
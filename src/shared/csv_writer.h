@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file csv_writer.h
+/// @brief Streaming csv writer
+///
+/// How it works
+/// ============
+/// Fields are quoted straight into one buffer reused for the whole output,
+/// a complete chunk of rows is written to the stream and the stream is
+/// flushed, so that a tntnet reply in direct mode sends it to the client
+/// right away:
+///
+///     shared::CsvWriter w(reply.out());
+///     w.field("name").field("type").endRow();
+///     ...
+///     w.flush();
+///
+/// Quoting follows RFC 4180: a field is enclosed in double quotes when it
+/// contains the delimiter, a double quote or a line break, a double quote
+/// is doubled. A field starting with an apostrophe is quoted too, older
+/// imports (cxxtools::CsvDeserializer) take the apostrophe as a quote.
+/// Rows end by LF, as with cxxtools::CsvSerializer.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace shared {
+
+class CsvWriter
+{
+public:
+    /// Write the csv to os, by chunks of about bufferSize bytes
+    explicit CsvWriter(std::ostream& os, char delimiter = ',', size_t bufferSize = 64 * 1024);
+
+    ~CsvWriter();
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    /// Next field of the current row
+    CsvWriter& field(std::string_view v);
+    CsvWriter& field(uint32_t v);
+
+    /// Terminate the current row, the chunk is written when it is full
+    CsvWriter& endRow();
+
+    /// Write buffered rows and flush the stream
+    /// @return false if the stream failed
+    bool flush();
+
+    /// Number of rows terminated so far
+    size_t rows() const
+    {
+        return _rows;
+    }
+
+private:
+    std::ostream& _os;
+    char          _delimiter;
+    size_t        _bufferSize;
+    std::string   _buffer;
+    size_t        _rows     = 0;
+    bool          _rowStart = true;
+};
+
+} // namespace shared
@@ -30,6 +30,7 @@
 #include <fty_common_db_asset.h>
 #include <map>
 #include <string>
+#include <vector>
 
 class asset_manager
 {
@@ -38,6 +39,9 @@ public:
     db_reply<db_web_element_t>                get_item1(uint32_t id);
     db_reply<std::map<uint32_t, std::string>> get_items1(const std::string& typeName, const std::string& subtypeName);
 
+    /// Elements of several assets by one query, assets which do not exist are missing in the reply
+    db_reply<std::map<uint32_t, db_web_element_t>> get_items(const std::vector<uint32_t>& ids);
+
     // to support old style
     db_reply<db_web_element_t> get_item1(const std::string& id, const std::string& type);
 
@@ -0,0 +1,271 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file json_writer.cc
+ * \brief Streaming json writer
+ */
+#include "shared/json_writer.h"
+#include <cassert>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace utils {
+
+JsonWriter::JsonWriter(std::string& out)
+    : _out(out)
+{
+}
+
+JsonWriter::JsonWriter(std::ostream& os, size_t bufferSize)
+    : _out(_buffer)
+    , _os(&os)
+    , _bufferSize(bufferSize)
+{
+    _buffer.reserve(bufferSize + bufferSize / 4);
+}
+
+JsonWriter::~JsonWriter()
+{
+    flush();
+}
+
+bool JsonWriter::flush()
+{
+    if (!_os) {
+        return true;
+    }
+    if (!_buffer.empty()) {
+        _os->write(_buffer.data(), std::streamsize(_buffer.size()));
+        _buffer.clear();
+    }
+    return !_os->fail();
+}
+
+void JsonWriter::afterWrite()
+{
+    if (_os && _buffer.size() >= _bufferSize) {
+        flush();
+    }
+}
+
+void JsonWriter::separate()
+{
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    if (_depth == 0) {
+        if (_hasTopLevel) {
+            _out += ',';
+        }
+        _hasTopLevel = true;
+        return;
+    }
+    uint64_t bit = uint64_t(1) << (_depth - 1);
+    if (_hasElement & bit) {
+        _out += ',';
+    }
+    _hasElement |= bit;
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+    separate();
+    assert(_depth < 64);
+    _out += '{';
+    ++_depth;
+    _hasElement &= ~(uint64_t(1) << (_depth - 1));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    assert(_depth > 0);
+    --_depth;
+    _out += '}';
+    afterWrite();
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+    separate();
+    assert(_depth < 64);
+    _out += '[';
+    ++_depth;
+    _hasElement &= ~(uint64_t(1) << (_depth - 1));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    assert(_depth > 0);
+    --_depth;
+    _out += ']';
+    afterWrite();
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view k)
+{
+    separate();
+    escape(k);
+    _out += ':';
+    _afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view v)
+{
+    separate();
+    escape(v);
+    afterWrite();
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* v)
+{
+    if (!v) {
+        return null();
+    }
+    return value(std::string_view(v));
+}
+
+JsonWriter& JsonWriter::value(const std::string& v)
+{
+    return value(std::string_view(v));
+}
+
+JsonWriter& JsonWriter::value(bool v)
+{
+    separate();
+    _out += v ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t v)
+{
+    char buf[24];
+    int  n = snprintf(buf, sizeof(buf), "%" PRId64, v);
+    return raw(std::string_view(buf, size_t(n)));
+}
+
+JsonWriter& JsonWriter::value(int v)
+{
+    return value(int64_t(v));
+}
+
+JsonWriter& JsonWriter::value(uint32_t v)
+{
+    return value(int64_t(v));
+}
+
+JsonWriter& JsonWriter::value(double v)
+{
+    if (std::isnan(v) || std::isinf(v)) {
+        return null();
+    }
+    char buf[512];
+    int  n = snprintf(buf, sizeof(buf), "%f", v);
+    return raw(std::string_view(buf, size_t(n)));
+}
+
+JsonWriter& JsonWriter::null()
+{
+    return raw("null");
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json)
+{
+    separate();
+    _out.append(json.data(), json.size());
+    afterWrite();
+    return *this;
+}
+
+JsonWriter& JsonWriter::elements(std::string_view json)
+{
+    if (json.empty()) {
+        return *this;
+    }
+    if (!_os || json.size() < _bufferSize) {
+        return raw(json);
+    }
+    // large parts go to the stream without a copy in the buffer
+    separate();
+    flush();
+    _os->write(json.data(), std::streamsize(json.size()));
+    return *this;
+}
+
+void JsonWriter::escape(std::string_view v)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    _out += '"';
+    size_t start = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(v[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // as utils::json::escape, keep what is already escaped
+        if (c == '\\' && i + 1 < v.size() && v[i + 1] != '\0' && strchr("\"\\/bfnrtu", v[i + 1])) {
+            ++i;
+            continue;
+        }
+        _out.append(v.data() + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"':
+                _out += "\\\"";
+                break;
+            case '\\':
+                _out += "\\\\";
+                break;
+            case '\b':
+                _out += "\\b";
+                break;
+            case '\f':
+                _out += "\\f";
+                break;
+            case '\n':
+                _out += "\\n";
+                break;
+            case '\r':
+                _out += "\\r";
+                break;
+            case '\t':
+                _out += "\\t";
+                break;
+            default:
+                _out += "\\u00";
+                _out += HEX[c >> 4];
+                _out += HEX[c & 0xf];
+        }
+    }
+    _out.append(v.data() + start, v.size() - start);
+    _out += '"';
+}
+
+} // namespace utils
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file json_writer.h
+/// @brief Streaming json writer
+///
+/// How it works
+/// ============
+/// Values are escaped straight into the output, commas are tracked per
+/// nesting level, so that no temporary string is built per field:
+///
+///     std::string json;
+///     utils::JsonWriter w(json);
+///     w.beginObject().member("id", name).key("groups").beginArray();
+///     ...
+///     w.endArray().endObject();
+///
+/// Values written at the top level are separated by commas as well, so a
+/// writer may serialize a part of an array (a shard serialized by another
+/// thread), which is merged into the array by elements():
+///
+///     utils::JsonWriter part(shard);
+///     part.beginObject()...endObject();
+///     part.beginObject()...endObject();
+///     ...
+///     w.beginArray().elements(shard).endArray();
+///
+/// Strings are escaped like utils::json::escape does: valid escape
+/// sequences already present in the value are kept as they are.
+///
+/// Writing to a std::ostream (e.g. reply.out()) goes through an internal
+/// buffer flushed when it grows over the given size and on flush().
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+class JsonWriter
+{
+public:
+    /// Append the json to out
+    explicit JsonWriter(std::string& out);
+
+    /// Write the json to os, by chunks of about bufferSize bytes
+    explicit JsonWriter(std::ostream& os, size_t bufferSize = 4096);
+
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+
+    /// Key of the next member of the current object
+    JsonWriter& key(std::string_view k);
+
+    JsonWriter& value(std::string_view v);
+    JsonWriter& value(const char* v);
+    JsonWriter& value(const std::string& v);
+    JsonWriter& value(bool v);
+    JsonWriter& value(int64_t v);
+    JsonWriter& value(int v);
+    JsonWriter& value(uint32_t v);
+    /// Same format as std::to_string(double), NaN is written as null
+    JsonWriter& value(double v);
+    JsonWriter& null();
+
+    /// Already serialized json value, written as is
+    JsonWriter& raw(std::string_view json);
+
+    /// Already serialized elements of the current array (values separated by
+    /// commas), written as is. Nothing is written for an empty string.
+    JsonWriter& elements(std::string_view json);
+
+    template <typename T>
+    JsonWriter& member(std::string_view k, const T& v)
+    {
+        return key(k).value(v);
+    }
+
+    /// Push buffered data to the stream (no-op for string output)
+    /// @return false if the stream failed
+    bool flush();
+
+private:
+    void separate();
+    void escape(std::string_view v);
+    void afterWrite();
+
+    std::string   _buffer;
+    std::string&  _out;
+    std::ostream* _os         = nullptr;
+    size_t        _bufferSize = 0;
+    // one bit per nesting level: set when the level already has an element
+    uint64_t _hasElement = 0;
+    unsigned _depth      = 0;
+    bool     _afterKey   = false;
+    // a value was written at the top level
+    bool _hasTopLevel = false;
+};
+
+} // namespace utils
@@ -19,7 +19,11 @@
  */
 
 #include "shared/utils_json.h"
+#include "db/connection_pool.h"
+#include "persist/assetcrud.h"
+#include "shared/asset_meta_cache.h"
 #include "shared/data.h"
+#include "shared/json_writer.h"
 #include "shared/utils.h"
 #include "shared/utilspp.h"
 #include "web/src/asset_computed_impl.h"
@@ -41,15 +45,6 @@ struct Outlet
     bool        group_r;
 };
 
-std::string getOutletNumber(const std::string& extAttributeName)
-{
-    auto        dot1    = extAttributeName.find_first_of(".");
-    std::string oNumber = extAttributeName.substr(dot1 + 1);
-    auto        dot2    = oNumber.find_first_of(".");
-    oNumber             = oNumber.substr(0, dot2);
-    return oNumber;
-}
-
 // encode metric GET request
 
 zmsg_t* s_rt_encode_GET(const char* name)
@@ -159,22 +154,19 @@ std::string getJsonAlert(tntdb::Connection connection, fty_proto_t* alert)
         return json;
     }
 
-    auto asset_element = DBAssets::select_asset_element_web_byName(connection, fty_proto_name(alert));
-    if (asset_element.status != 1) {
-        log_error("%s", asset_element.msg.c_str());
-        return json;
-    }
-
-    log_debug("DBAssets::id_to_name_ext_name ('%d')", asset_element.item.id);
-    std::pair<std::string, std::string> asset_element_names = DBAssets::id_to_name_ext_name(asset_element.item.id);
-    if (asset_element_names.first.empty() && asset_element_names.second.empty()) {
-        log_error("internal-error : Database error");
+    // alert lists render hundreds of alerts of the same assets, avoid two queries per alert
+    AssetMetaCache::Meta asset_element;
+    if (!AssetMetaCache::instance().get(connection, fty_proto_name(alert), asset_element)) {
+        log_error("element '%s' not found", fty_proto_name(alert));
         return json;
     }
 
     // TBD Workaround for IPMPROG-1729: Replace all occurrences of ename value with correct friendly name
     // ... "ename": { "value":"<ename_to_replace>", "assetLink":"ups-xxxxxx" } ...
-    auto updateDescription = [asset_element_names](std::string description) -> std::string {
+    auto updateDescription = [&asset_element](std::string description) -> std::string {
+        if (description.find("ename") == std::string::npos) {
+            return description;
+        }
         // caution: inverse search for regex_match (last found in first)
         const static std::regex reg(R"xxx((.*\ename\")([:{ ]*\"value\"[:\" ]*)([^\"]*)(\".*))xxx");
         std::string res;
@@ -182,27 +174,28 @@ std::string getJsonAlert(tntdb::Connection connection, fty_proto_t* alert)
         std::string search = description;
         while (std::regex_match(search, matches, reg) && matches.size() == 5) {
             //logDebug("match1={} match2={} match3={} match4={}", matches.str(1), matches.str(2), matches.str(3), matches.str(4));
-            res = matches.str(2) + asset_element_names.second + matches.str(4) + res;
+            res = matches.str(2) + asset_element.ext_name + matches.str(4) + res;
             search = matches.str(1);
         }
         res = search + res;
         return res;
     };
 
-    json += "{";
-
-    json += utils::json::jsonify("timestamp", buff) + ",";
-    json += utils::json::jsonify("rule_name", fty_proto_rule(alert)) + ",";
-    json += utils::json::jsonify("element_id", fty_proto_name(alert)) + ",";
-    json += utils::json::jsonify("element_name", asset_element_names.second) + ",";
-    json += utils::json::jsonify("element_type", asset_element.item.type_name) + ",";
-    json += utils::json::jsonify("element_sub_type", utils::strip(asset_element.item.subtype_name)) + ",";
-    json += utils::json::jsonify("state", fty_proto_state(alert)) + ",";
-    json += utils::json::jsonify("severity", fty_proto_severity(alert)) + ",";
-    json += utils::json::jsonify("description", updateDescription(fty_proto_description(alert)));
+    json.reserve(512);
+    utils::JsonWriter w(json);
+    w.beginObject();
+    w.member("timestamp", buff);
+    w.member("rule_name", fty_proto_rule(alert));
+    w.member("element_id", fty_proto_name(alert));
+    w.member("element_name", asset_element.ext_name);
+    w.member("element_type", asset_element.type_name);
+    w.member("element_sub_type", utils::strip(asset_element.subtype_name));
+    w.member("state", fty_proto_state(alert));
+    w.member("severity", fty_proto_severity(alert));
+    w.member("description", updateDescription(fty_proto_description(alert)));
     const char* md = fty_proto_metadata(alert); // assume json object payload if !empty
-    json += "," + utils::json::jsonify("metadata", ((md && (*md)) ? md : "{}"));
-    json += "}";
+    w.key("metadata").raw(utils::json::jsonify((md && (*md)) ? md : "{}"));
+    w.endObject();
 
     return json;
 }
@@ -225,148 +218,153 @@ std::string getJsonAsset(mlm_client_t* clientMlm, int64_t elemId)
         return json;
     }
 
-    std::pair<std::string, std::string> parent_names    = DBAssets::id_to_name_ext_name(tmp.item.basic.parent_id);
-    std::string                         parent_name     = parent_names.first;
-    std::string                         ext_parent_name = parent_names.second;
+    // resolve names of every referenced asset at once
+    std::set<a_elmnt_id_t> ids{tmp.item.basic.id};
+    if (tmp.item.basic.parent_id != 0) {
+        ids.insert(tmp.item.basic.parent_id);
+    }
+    for (const auto& oneGroup : tmp.item.groups) {
+        ids.insert(oneGroup.first);
+    }
+    for (const auto& oneLink : tmp.item.powers) {
+        ids.insert(oneLink.src_id);
+    }
+    for (const auto& it : tmp.item.parents) {
+        ids.insert(std::get<0>(it));
+    }
+
+    std::map<a_elmnt_id_t, std::pair<std::string, std::string>> names;
+    try {
+        auto conn      = persist::ConnectionPool::instance().acquire();
+        auto names_ret = select_names_ext_names(conn, ids);
+        if (names_ret.status == 0) {
+            log_error("Database failure: %s", names_ret.msg.c_str());
+            return json;
+        }
+        names = std::move(names_ret.item);
+    } catch (const std::exception& e) {
+        log_error("Database failure: %s", e.what());
+        return json;
+    }
+    auto ext_name_of = [&names](a_elmnt_id_t id, std::string& ext_name) -> bool {
+        auto it = names.find(id);
+        if (it == names.end()) {
+            return false;
+        }
+        ext_name = it->second.second;
+        return true;
+    };
+
+    std::string parent_name;
+    std::string ext_parent_name;
+    auto        parent_it = names.find(tmp.item.basic.parent_id);
+    if (parent_it != names.end()) {
+        parent_name     = parent_it->second.first;
+        ext_parent_name = parent_it->second.second;
+    }
 
-    std::pair<std::string, std::string> asset_names = DBAssets::id_to_name_ext_name(tmp.item.basic.id);
-    if (asset_names.first.empty() && asset_names.second.empty()) {
+    std::string asset_ext_name;
+    if (!ext_name_of(tmp.item.basic.id, asset_ext_name)) {
         log_error("Database failure");
         return json;
     }
-    std::string asset_ext_name = asset_names.second;
 
-    json += "{";
-
-    json += utils::json::jsonify("id", tmp.item.basic.name) + ",";
-    json += "\"power_devices_in_uri\": \"/api/v1/assets\?in=";
-    json += (tmp.item.basic.name);
-    json += "&sub_type=epdu,pdu,feed,genset,ups,sts,rackcontroller\",";
-    json += utils::json::jsonify("name", asset_ext_name) + ",";
-    json += utils::json::jsonify("status", tmp.item.basic.status) + ",";
-    json += utils::json::jsonify("priority", "P" + std::to_string(tmp.item.basic.priority)) + ",";
-    json += utils::json::jsonify("type", tmp.item.basic.type_name) + ",";
+    json.reserve(4096);
+    utils::JsonWriter w(json);
+    w.beginObject();
+    w.member("id", tmp.item.basic.name);
+    w.key("power_devices_in_uri")
+        .value("/api/v1/assets?in=" + tmp.item.basic.name + "&sub_type=epdu,pdu,feed,genset,ups,sts,rackcontroller");
+    w.member("name", asset_ext_name);
+    w.member("status", tmp.item.basic.status);
+    w.member("priority", "P" + std::to_string(tmp.item.basic.priority));
+    w.member("type", tmp.item.basic.type_name);
 
     // if element is located, then show the location
     if (tmp.item.basic.parent_id != 0) {
-        json += utils::json::jsonify("location_uri", "/api/v1/asset/" + parent_name) + ",";
-        json += utils::json::jsonify("location_id", parent_name) + ",";
-        json += utils::json::jsonify("location", ext_parent_name) + ",";
+        w.member("location_uri", "/api/v1/asset/" + parent_name);
+        w.member("location_id", parent_name);
+        w.member("location", ext_parent_name);
 
-        // Get informations from database
-        auto parentAsset = asset_mgr.get_item1(tmp.item.basic.parent_id);
-        json += utils::json::jsonify("location_type", parentAsset.item.basic.type_name) + ",";
+        // direct parent is the first of the parents
+        std::string location_type;
+        for (const auto& it : tmp.item.parents) {
+            if (std::get<0>(it) == tmp.item.basic.parent_id) {
+                location_type = std::get<2>(it);
+                break;
+            }
+        }
+        w.member("location_type", location_type);
     } else {
-        json += "\"location\":\"\",";
-        json += "\"location_type\":\"\",";
+        w.member("location", "");
+        w.member("location_type", "");
     }
 
-    json += "\"groups\": [";
+    w.key("groups").beginArray();
     // every element (except groups) can be placed in some group
-    if (!tmp.item.groups.empty()) {
-        uint32_t    group_count = uint32_t(tmp.item.groups.size());
-        uint32_t    i           = 1;
-        std::string ext_name    = "";
-        for (auto& oneGroup : tmp.item.groups) {
-            std::pair<std::string, std::string> group_names = DBAssets::id_to_name_ext_name(oneGroup.first);
-            if (group_names.first.empty() && group_names.second.empty()) {
-                log_error("Database failure");
-                json = "";
-                return json;
-            }
-            ext_name = group_names.second;
-            json += "{";
-            json += utils::json::jsonify("id", oneGroup.second) + ",";
-            json += utils::json::jsonify("name", ext_name);
-            json += "}";
-
-            if (i != group_count) {
-                json += ",";
-            }
-            i++;
+    std::string ext_name;
+    for (auto& oneGroup : tmp.item.groups) {
+        if (!ext_name_of(oneGroup.first, ext_name)) {
+            log_error("Database failure");
+            json = "";
+            return json;
         }
+        w.beginObject().member("id", oneGroup.second).member("name", ext_name).endObject();
     }
-    json += "]";
+    w.endArray();
 
     // Device is special element with more attributes
     if (tmp.item.basic.type_id == persist::asset_type::DEVICE) {
-        json += ", \"powers\": [";
-
-        if (!tmp.item.powers.empty()) {
-            uint32_t power_count = uint32_t(tmp.item.powers.size());
-            uint32_t i           = 1;
-            for (auto& oneLink : tmp.item.powers) {
-                std::pair<std::string, std::string> link_names = DBAssets::id_to_name_ext_name(oneLink.src_id);
-                if (link_names.first.empty() && link_names.second.empty()) {
-                    log_error("Database failure");
-                    json = "";
-                    return json;
-                }
-                json += "{";
-                json += utils::json::jsonify("src_name", link_names.second) + ",";
-                json += utils::json::jsonify("src_id", oneLink.src_name);
-
-                if (!oneLink.src_socket.empty()) {
-                    json += "," + utils::json::jsonify("src_socket", oneLink.src_socket);
-                }
-                if (!oneLink.dest_socket.empty()) {
-                    json += "," + utils::json::jsonify("dest_socket", oneLink.dest_socket);
-                }
-
-                json += "}";
-                if (i != power_count) {
-                    json += ",";
-                }
-                i++;
+        w.key("powers").beginArray();
+        for (auto& oneLink : tmp.item.powers) {
+            if (!ext_name_of(oneLink.src_id, ext_name)) {
+                log_error("Database failure");
+                json = "";
+                return json;
             }
+            w.beginObject();
+            w.member("src_name", ext_name);
+            w.member("src_id", oneLink.src_name);
+            if (!oneLink.src_socket.empty()) {
+                w.member("src_socket", oneLink.src_socket);
+            }
+            if (!oneLink.dest_socket.empty()) {
+                w.member("dest_socket", oneLink.dest_socket);
+            }
+            w.endObject();
         }
-
-        json += "]";
+        w.endArray();
     }
     // ACE: to be consistent with RFC-11 this was put here
     if (tmp.item.basic.type_id == persist::asset_type::GROUP) {
         auto it = tmp.item.ext.find("type");
         if (it != tmp.item.ext.end()) {
-            json += "," + utils::json::jsonify("sub_type", utils::strip(it->second.first));
+            w.member("sub_type", utils::strip(it->second.first));
             tmp.item.ext.erase(it);
         }
     } else {
-        json += "," + utils::json::jsonify("sub_type", utils::strip(tmp.item.basic.subtype_name));
-
-        json += ", \"parents\" : [";
-        size_t i = 1;
-
-        std::string ext_name = "";
+        w.member("sub_type", utils::strip(tmp.item.basic.subtype_name));
 
+        w.key("parents").beginArray();
         for (const auto& it : tmp.item.parents) {
-            char                                comma    = i != tmp.item.parents.size() ? ',' : ' ';
-            std::pair<std::string, std::string> it_names = DBAssets::id_to_name_ext_name(std::get<0>(it));
-            if (it_names.first.empty() && it_names.second.empty()) {
+            if (!ext_name_of(std::get<0>(it), ext_name)) {
                 log_error("Database failure");
                 json = "";
                 return json;
             }
-            ext_name = it_names.second;
-            json += "{";
-            json += utils::json::jsonify("id", std::get<1>(it));
-            json += "," + utils::json::jsonify("name", ext_name);
-            json += "," + utils::json::jsonify("type", std::get<2>(it));
-            json += "," + utils::json::jsonify("sub_type", std::get<3>(it));
-            json += "}";
-            json += (comma);
-            i++;
+            w.beginObject();
+            w.member("id", std::get<1>(it));
+            w.member("name", ext_name);
+            w.member("type", std::get<2>(it));
+            w.member("sub_type", std::get<3>(it));
+            w.endObject();
         }
-        json += "]";
+        w.endArray();
     }
 
-    json += ", \"ext\" : [";
-    bool isExtCommaNeeded = false;
-
+    w.key("ext").beginArray();
     if (!tmp.item.basic.asset_tag.empty()) {
-        json += "{";
-        json += utils::json::jsonify("asset_tag", tmp.item.basic.asset_tag);
-        json += ", \"read_only\" : false}";
-        isExtCommaNeeded = true;
+        w.beginObject().member("asset_tag", tmp.item.basic.asset_tag).member("read_only", false).endObject();
     }
 
     std::map<std::string, Outlet> outlets;
@@ -375,13 +373,6 @@ std::string getJsonAsset(mlm_client_t* clientMlm, int64_t elemId)
     std::vector<std::string>      fqdns;
     std::vector<std::string>      hostnames;
     if (!tmp.item.ext.empty()) {
-        std::regex r_outlet_label("^outlet\\.[0-9][0-9]*\\.label$");
-        std::regex r_outlet_group("^outlet\\.[0-9][0-9]*\\.group$");
-        std::regex r_outlet_type("^outlet\\.[0-9][0-9]*\\.type$");
-        std::regex r_ip("^ip\\.[0-9][0-9]*$");
-        std::regex r_mac("^mac\\.[0-9][0-9]*$");
-        std::regex r_hostname("^hostname\\.[0-9][0-9]*$");
-        std::regex r_fqdn("^fqdn\\.[0-9][0-9]*$");
         for (auto& oneExt : tmp.item.ext) {
             auto& attrName = oneExt.first;
 
@@ -392,188 +383,97 @@ std::string getJsonAsset(mlm_client_t* clientMlm, int64_t elemId)
             if (attrName == "location_type")
                 continue;
 
-            auto& attrValue  = oneExt.second.first;
-            auto  isReadOnly = oneExt.second.second;
-            if (std::regex_match(attrName, r_outlet_label)) {
-                auto oNumber = getOutletNumber(attrName);
-                auto it      = outlets.find(oNumber);
-                if (it == outlets.cend()) {
-                    auto r = outlets.emplace(oNumber, Outlet());
-                    it     = r.first;
-                }
-                it->second.label   = attrValue;
-                it->second.label_r = isReadOnly;
-                continue;
-            } else if (std::regex_match(attrName, r_outlet_group)) {
-                auto oNumber = getOutletNumber(attrName);
-                auto it      = outlets.find(oNumber);
+            auto&            attrValue  = oneExt.second.first;
+            auto             isReadOnly = oneExt.second.second;
+            std::string_view number;
+            auto             kind = utils::classify_ext_attribute(attrName, number);
+            if (kind == utils::ExtAttrKind::OUTLET_LABEL || kind == utils::ExtAttrKind::OUTLET_GROUP ||
+                kind == utils::ExtAttrKind::OUTLET_TYPE) {
+                auto it = outlets.find(std::string(number));
                 if (it == outlets.cend()) {
-                    auto r = outlets.emplace(oNumber, Outlet());
+                    auto r = outlets.emplace(std::string(number), Outlet());
                     it     = r.first;
                 }
-                it->second.group   = attrValue;
-                it->second.group_r = isReadOnly;
-                continue;
-            } else if (std::regex_match(attrName, r_outlet_type)) {
-                auto oNumber = getOutletNumber(attrName);
-                auto it      = outlets.find(oNumber);
-                if (it == outlets.cend()) {
-                    auto r = outlets.emplace(oNumber, Outlet());
-                    it     = r.first;
+                if (kind == utils::ExtAttrKind::OUTLET_LABEL) {
+                    it->second.label   = attrValue;
+                    it->second.label_r = isReadOnly;
+                } else if (kind == utils::ExtAttrKind::OUTLET_GROUP) {
+                    it->second.group   = attrValue;
+                    it->second.group_r = isReadOnly;
+                } else {
+                    it->second.type   = attrValue;
+                    it->second.type_r = isReadOnly;
                 }
-                it->second.type   = attrValue;
-                it->second.type_r = isReadOnly;
                 continue;
-            } else if (std::regex_match(attrName, r_ip)) {
+            } else if (kind == utils::ExtAttrKind::IP) {
                 ips.push_back(attrValue);
                 continue;
-            } else if (std::regex_match(attrName, r_mac)) {
+            } else if (kind == utils::ExtAttrKind::MAC) {
                 macs.push_back(attrValue);
                 continue;
-            } else if (std::regex_match(attrName, r_fqdn)) {
+            } else if (kind == utils::ExtAttrKind::FQDN) {
                 fqdns.push_back(attrValue);
                 continue;
-            } else if (std::regex_match(attrName, r_hostname)) {
+            } else if (kind == utils::ExtAttrKind::HOSTNAME) {
                 hostnames.push_back(attrValue);
                 continue;
             }
             // If we are here -> then this attribute is not special and should be returned as "ext"
-            std::string extKey = oneExt.first;
-            std::string extVal = oneExt.second.first;
-
-            json += isExtCommaNeeded ? "," : "";
-            json += "{";
-            json += utils::json::jsonify(extKey, extVal) + ",\"read_only\" :";
-            json += oneExt.second.second ? "true" : "false";
-            json += "}";
-
-            isExtCommaNeeded = true;
+            w.beginObject().member(attrName, attrValue).member("read_only", isReadOnly).endObject();
         } // end of for each loop for ext attribute
     }
+    w.endArray();
 
-    json += "]";
-    // Print "ips"
-
-    if (!ips.empty()) {
-        json += ", \"ips\" : [";
-        int i = 1;
-
-        int max_size = int(ips.size());
-
-        for (const auto& oneIp : ips) {
-            json += "\"" + (oneIp) + "\"";
-            json += (max_size == i ? "" : ",");
-            i++;
+    auto writeList = [&w](const char* key, const std::vector<std::string>& values) {
+        if (values.empty()) {
+            return;
         }
-        json += "]";
-    }
-
-    // Print "macs"
-    if (!macs.empty()) {
-
-        json += ", \"macs\" : [";
-        int i = 1;
-
-        int max_size = int(macs.size());
-
-        for (auto& oneMac : macs) {
-            json += "\"" + (oneMac) + "\"";
-            json += (max_size == i ? "" : ",");
-            i++;
-        }
-        json += "]";
-    }
-
-    // Print "fqdns"
-    if (!fqdns.empty()) {
-        json += ", \"fqdns\" : [";
-        int i        = 1;
-        int max_size = int(fqdns.size());
-        for (auto& oneFqdn : fqdns) {
-            json += "\"" + (oneFqdn) + "\"";
-            json += (max_size == i ? "" : ",");
-            i++;
-        }
-        json += "]";
-    }
-
-    // Print "fqdns"
-    if (!hostnames.empty()) {
-
-        json += " , \"hostnames\" : [";
-        int i = 1;
-
-        int max_size = int(hostnames.size());
-        for (auto& oneHostname : hostnames) {
-            json += "\"" + (oneHostname) + "\"";
-            json += (max_size == i ? "" : ",");
-            i++;
+        w.key(key).beginArray();
+        for (const auto& value : values) {
+            w.value(value);
         }
-        json += "]";
-    }
+        w.endArray();
+    };
+    writeList("ips", ips);
+    writeList("macs", macs);
+    writeList("fqdns", fqdns);
+    writeList("hostnames", hostnames);
 
     // Print "outlets"
     if (!outlets.empty()) {
-        json += ", \"outlets\": {";
-        int i = 1;
-
-        int max_size = int(outlets.size());
-
+        w.key("outlets").beginObject();
         for (auto& oneOutlet : outlets) {
-
-            bool isCommaNeeded = false;
-
-            json += "\"" + (oneOutlet.first) + "\" : [";
+            w.key(oneOutlet.first).beginArray();
             if (!oneOutlet.second.label.empty()) {
-
-                std::string outletLabel = oneOutlet.second.label;
-
-                json += "{\"name\":\"label\",";
-                json += utils::json::jsonify("value", outletLabel) + ",\"read_only\" : ";
-                json += oneOutlet.second.label_r ? "true" : "false";
-                json += "}";
-                isCommaNeeded = true;
+                w.beginObject().member("name", "label").member("value", oneOutlet.second.label);
+                w.member("read_only", oneOutlet.second.label_r).endObject();
             }
-
             if (!oneOutlet.second.group.empty()) {
-                if (isCommaNeeded) {
-                    json += ",";
-                }
-
-                json += "{\"name\":\"group\",";
-                json += utils::json::jsonify("value", oneOutlet.second.group) + ",\"read_only\" : ";
-                json += oneOutlet.second.group_r ? "true" : "false";
-                json += "}";
-                isCommaNeeded = true;
+                w.beginObject().member("name", "group").member("value", oneOutlet.second.group);
+                w.member("read_only", oneOutlet.second.group_r).endObject();
             }
-
             if (!oneOutlet.second.type.empty()) {
-                if (isCommaNeeded) {
-                    json += ",";
-                }
-
-                json += "{\"name\":\"type\",";
-                json += utils::json::jsonify("value", oneOutlet.second.type) + ",\"read_only\" : ";
-                json += oneOutlet.second.type_r ? "true" : "false";
-                json += "}";
+                w.beginObject().member("name", "type").member("value", oneOutlet.second.type);
+                w.member("read_only", oneOutlet.second.type_r).endObject();
             }
-
-            json += "]";
-            json += (max_size == i ? "" : ",");
-            i++;
+            w.endArray();
         }
-        json += "}";
+        w.endObject();
     }
 
-    json += ", \"computed\" : {";
+    w.key("computed").beginObject();
     if (persist::is_rack(tmp.item.basic.type_id)) {
         int    freeusize         = free_u_size(tmp.item.basic.id);
         double realpower_nominal = s_rack_realpower_nominal(clientMlm, tmp.item.basic.name.c_str());
 
-        json += "\"freeusize\":" + (freeusize >= 0 ? std::to_string(freeusize) : "null");
-        json +=
-            ",\"realpower.nominal\":" + (!std::isnan(realpower_nominal) ? std::to_string(realpower_nominal) : "null");
-        json += ", \"outlet.available\" : {";
+        w.key("freeusize");
+        if (freeusize >= 0) {
+            w.value(freeusize);
+        } else {
+            w.null();
+        }
+        w.member("realpower.nominal", realpower_nominal);
+
         std::map<std::string, int> res;
         int                        rv = rack_outlets_available(tmp.item.basic.id, res);
         if (rv != 0) {
@@ -581,19 +481,19 @@ std::string getJsonAsset(mlm_client_t* clientMlm, int64_t elemId)
             json = "";
             return json;
         }
-        size_t i = 1;
+        w.key("outlet.available").beginObject();
         for (const auto& it : res) {
-
-            std::string val   = it.second >= 0 ? std::to_string(it.second) : "null";
-            std::string comma = i == res.size() ? "" : ",";
-            i++;
-            json += "\"" + it.first + "\":" + val;
-            json += (comma);
+            w.key(it.first);
+            if (it.second >= 0) {
+                w.value(it.second);
+            } else {
+                w.null();
+            }
         } // for it : res
-
-        json += "}";
+        w.endObject();
     } // rack
+    w.endObject();
 
-    json += "}}";
+    w.endObject();
     return json;
 }
@@ -203,5 +203,73 @@ join (const char **str_arr, const char *separator) {
     }
 }
 
-} // namespace utils
+namespace {
+
+struct ExtAttrKeyword
+{
+    std::string_view   keyword;
+    utils::ExtAttrKind kind;
+};
 
+// <prefix>N
+constexpr ExtAttrKeyword EXT_ATTR_PREFIXES[] = {
+    {"ip.", utils::ExtAttrKind::IP},
+    {"mac.", utils::ExtAttrKind::MAC},
+    {"hostname.", utils::ExtAttrKind::HOSTNAME},
+    {"fqdn.", utils::ExtAttrKind::FQDN},
+};
+
+// outlet.N<suffix>
+constexpr std::string_view OUTLET_PREFIX = "outlet.";
+constexpr ExtAttrKeyword   EXT_ATTR_OUTLET_SUFFIXES[] = {
+    {".label", utils::ExtAttrKind::OUTLET_LABEL},
+    {".group", utils::ExtAttrKind::OUTLET_GROUP},
+    {".type", utils::ExtAttrKind::OUTLET_TYPE},
+};
+
+// length of the leading [0-9]* of s
+size_t
+digits_length (std::string_view s) {
+    size_t i = 0;
+    while (i < s.size () && s[i] >= '0' && s[i] <= '9')
+        ++i;
+    return i;
+}
+
+bool
+starts_with (std::string_view s, std::string_view prefix) {
+    return s.size () >= prefix.size () && s.compare (0, prefix.size (), prefix) == 0;
+}
+
+} // namespace
+
+ExtAttrKind
+classify_ext_attribute (std::string_view name, std::string_view& number) {
+    if (starts_with (name, OUTLET_PREFIX)) {
+        std::string_view rest = name.substr (OUTLET_PREFIX.size ());
+        size_t n = digits_length (rest);
+        if (n == 0)
+            return ExtAttrKind::OTHER;
+        for (const auto& suffix : EXT_ATTR_OUTLET_SUFFIXES) {
+            if (rest.substr (n) == suffix.keyword) {
+                number = rest.substr (0, n);
+                return suffix.kind;
+            }
+        }
+        return ExtAttrKind::OTHER;
+    }
+
+    for (const auto& prefix : EXT_ATTR_PREFIXES) {
+        if (starts_with (name, prefix.keyword)) {
+            std::string_view rest = name.substr (prefix.keyword.size ());
+            if (!rest.empty () && digits_length (rest) == rest.size ()) {
+                number = rest;
+                return prefix.kind;
+            }
+            return ExtAttrKind::OTHER;
+        }
+    }
+    return ExtAttrKind::OTHER;
+}
+
+} // namespace utils
@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <map>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 namespace utils::math {
 
@@ -91,4 +92,23 @@ std::string join(const char** str_arr, uint32_t length, const char* separator);
 /// @note Use this version only for arrays that are NULL terminated!
 std::string join(const char** str_arr, const char* separator);
 
+/// Ext attributes getting a special treatment in asset representations
+enum class ExtAttrKind
+{
+    OTHER,
+    OUTLET_LABEL, ///< outlet.N.label
+    OUTLET_GROUP, ///< outlet.N.group
+    OUTLET_TYPE,  ///< outlet.N.type
+    IP,           ///< ip.N
+    MAC,          ///< mac.N
+    HOSTNAME,     ///< hostname.N
+    FQDN          ///< fqdn.N
+};
+
+/// Classify an ext attribute name, without regex nor allocation
+/// @param[in] name - the ext attribute name
+/// @param[out] number - the N of the name (view into name), untouched for ExtAttrKind::OTHER
+/// @return the kind of the attribute
+ExtAttrKind classify_ext_attribute(std::string_view name, std::string_view& number);
+
 } // namespace utils
@@ -23,9 +23,10 @@
 #include <tntdb/connection.h>
 #include <tntdb/row.h>
 #include <fty_common.h>
-#include <fty_common_db_dbpath.h>
 #include <fty_common_db_asset.h>
 
+#include "db/connection_pool.h"
+#include "shared/asset_graph.h"
 #include "shared/utils.h"
 #include "dbtypes.h"
 
@@ -55,8 +56,7 @@ s_get_devices_usize(
 int free_u_size( a_elmnt_id_t elementId)
 {
     try{
-        tntdb::Connection conn;
-        conn = tntdb::connect(DBConn::url);
+        auto conn = persist::ConnectionPool::instance().acquire();
 
         // get the rack u_size
         std::set<a_elmnt_id_t> rack_id{elementId};
@@ -68,18 +68,9 @@ int free_u_size( a_elmnt_id_t elementId)
 
         // get id of the devices inside the rack
         std::set<a_elmnt_id_t> element_ids{};
-        std::function<void(const tntdb::Row&)> func = \
-            [&element_ids](const tntdb::Row& row)
-            {
-                    a_elmnt_id_t asset_id = 0;
-                    row["asset_id"].get(asset_id);
-                    element_ids.insert (asset_id);
-            };
-
-        auto rv = DBAssets::select_assets_by_container(conn, elementId, func);
-        if ( rv==-1 ) {
-            log_debug( "free_u_size() rv is null");
-            return -1;
+        auto graph = AssetGraph::instance().get(conn);
+        for (const AssetGraph::Node* node : graph->subtree(elementId)) {
+            element_ids.insert (node->id);
         }
         // substract sum( device size ) if there are some
         int freeusize2 = s_get_devices_usize( conn, element_ids);
@@ -131,19 +122,17 @@ rack_outlets_available(
 {
     int sum = -1;
     bool tainted = false;
-    tntdb::Connection conn;
+    persist::PooledConnection conn;
     res["sum"] = sum;
 
-    std::function<void(const tntdb::Row &row)> cb = \
-        [&conn, &sum, &tainted, &res](const tntdb::Row &row)
-        {
-            a_elmnt_id_t device_subtype = 0;
-            row["subtype_id"].get(device_subtype);
-            if (!persist::is_epdu(int(device_subtype)) && !persist::is_pdu(int(device_subtype)))
-                return;
+    try {
+        conn = persist::ConnectionPool::instance().acquire();
+        auto graph = AssetGraph::instance().get(conn);
+        for (const AssetGraph::Node* node : graph->subtree(elementId)) {
+            if (!persist::is_epdu(int(node->subtype_id)) && !persist::is_pdu(int(node->subtype_id)))
+                continue;
 
-            a_elmnt_id_t device_asset_id = 0;
-            row["asset_id"].get(device_asset_id);
+            a_elmnt_id_t device_asset_id = node->id;
 
             uint32_t foo = s_select_outlet_count(conn, device_asset_id);
             int outlet_count = foo != UINT32_MAX ? int(foo) : -1;
@@ -159,14 +148,7 @@ rack_outlets_available(
             else
                 tainted = true;
             res[std::to_string(device_asset_id)] = outlet_count;
-        };
-
-    int rv;
-    try {
-        conn = tntdb::connect(DBConn::url);
-        rv = DBAssets::select_assets_by_container(
-                conn, elementId, cb);
-
+        }
     } catch (std::exception &e) {
         log_error("%s", e.what());
         return -1;
@@ -174,5 +156,5 @@ rack_outlets_available(
 
     if (!tainted)
         res["sum"] = sum +1;   //sum is initialized to -1
-    return rv;
+    return 0;
 }
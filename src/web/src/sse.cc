@@ -41,6 +41,10 @@ Sse::Sse()
 
 Sse::~Sse()
 {
+  if (_dc)
+  {
+    AssetDcIndex::instance().release(_dc);
+  }
   if (_clientMlm)
   {
     mlm_client_destroy(&_clientMlm);
@@ -138,92 +142,24 @@ zmsg_t * Sse::getMessageFromMlm()
 
 std::string Sse::loadAssetFromDatacenter()
 {
-
-  std::map<std::string, int> assets;
-  std::map<std::string, int> assetsWithNoLocation;
-
-  //Get all assets from the datacenter
-  auto asset_element = DBAssets::select_asset_element_web_byId(_connection, _datacenter_id);
-  if (asset_element.status != 1)
-  {
-    return asset_element.msg.c_str();
-  }
-  log_debug("Asset element name = '%s'.", asset_element.item.name.c_str());
-  assets.emplace(std::make_pair(asset_element.item.name, 5));
-
-  try
-  {
-    int rv = DBAssets::select_assets_by_container(_connection, _datacenter_id,
-      [&assets](const tntdb::Row & row) -> void
-      {
-        std::string name;
-        row[0].get(name);
-        assets.emplace(std::make_pair(name, 5));
-      });
-    if (rv != 0)
-    {
-      return TRANSLATE_ME ("DBAssets::select_assets_by_container () failed.");
-    }
-  }
-  catch (const tntdb::Error& e)
-  {
-    return JSONIFY (e.what());
-  }
-  catch (const std::exception& e)
-  {
-    return JSONIFY (e.what());
-  }
-  _assetsOfDatacenter = assets;
-  if(ManageFtyLog::getInstanceFtylog()->isLogDebug())
-  {
-    log_debug("=== These elements are topologically under element id: '%" PRIu32"' ===", _datacenter_id);
-    for (auto const& item : _assetsOfDatacenter)
-    {
-      log_debug("%s", item.first.c_str());
-    }
-    log_debug("=== end ===");
-  }
-  //Get all assets without location
-  try
-  {
-    int rv = DBAssets::select_assets_without_container(_connection,{persist::asset_type::DEVICE},{},
-      [&assetsWithNoLocation](const tntdb::Row & row) -> void
-      {
-        std::string name;
-        row[0].get(name);
-        assetsWithNoLocation.emplace(std::make_pair(name, 5));
-      });
-    if (rv != 0)
-    {
-      return TRANSLATE_ME ("DBAssets::select_assets_by_container () failed.");
-    }
-  }
-  catch (const tntdb::Error& e)
-  {
-    return JSONIFY (e.what());
-  }
-  catch (const std::exception& e)
+  //The index is shared by all sse, only the first one loads it
+  std::string errorMsg = AssetDcIndex::instance().load(_connection);
+  if (!errorMsg.empty())
   {
-    return JSONIFY (e.what());
+    return errorMsg;
   }
-  _assetsWithNoLocation = assetsWithNoLocation;
-
-  if(ManageFtyLog::getInstanceFtylog()->isLogDebug())
+  if (_dc)
   {
-    log_debug("=== These elements are witout location ===");
-    for (auto const& item : _assetsWithNoLocation)
-    {
-      log_debug("%s", item.first.c_str());
-    }
-    log_debug("=== end ===");
+    AssetDcIndex::instance().release(_dc);
   }
+  _dc = AssetDcIndex::instance().datacenter(_datacenter);
   return std::string("");
 }
 
 std::string Sse::changeFtyProtoAlert2Json(fty_proto_t *alert)
 {
   std::string json = "";
-  if (_assetsOfDatacenter.find(fty_proto_name(alert)) == _assetsOfDatacenter.end())
+  if (!isAssetInDatacenter(fty_proto_name(alert)))
   {
     log_debug("skipping due to element_src '%s' not being in the list", fty_proto_name(alert));
     return json;
@@ -250,7 +186,7 @@ std::string Sse::changeFtyProtoAlert2Json(fty_proto_t *alert)
   return json;
 }
 
-std::string Sse::changeFtyProtoAsset2Json(fty_proto_t *asset)
+std::string Sse::changeFtyProtoAsset2Json(fty_proto_t *asset, const AssetDcIndex::Change& change)
 {
   log_debug("SSE FtyProto asset message (name: %s, operation: %s)", fty_proto_name(asset), fty_proto_operation(asset));
 
@@ -258,29 +194,17 @@ std::string Sse::changeFtyProtoAsset2Json(fty_proto_t *asset)
   std::string json = "";
 
   std::string nameElement = std::string(fty_proto_name(asset));
+  AssetDcIndex::Dc noLocation = AssetDcIndex::instance().noLocation();
+
   //Check operation
   //if delete send json
   if (streq(fty_proto_operation(asset), FTY_PROTO_ASSET_OP_DELETE))
   {
     log_debug("SSE get an delete message");
-    if (_assetsOfDatacenter.find(nameElement) == _assetsOfDatacenter.end())
-    {
-      //The asset is maybe without location
-      if (_assetsWithNoLocation.find(nameElement) != _assetsWithNoLocation.end())
-      {
-        //remove this asset from the list without location
-        _assetsWithNoLocation.erase(nameElement);
-      }
-      else
-      {
-        log_debug("skipping due to element_src '%s' not being in the list", fty_proto_name(asset));
-        return json;
-      }
-    }
-    else
+    if (change.before != _dc && change.before != noLocation)
     {
-      //remove this asset from the assets list
-      _assetsOfDatacenter.erase(nameElement);
+      log_debug("skipping due to element_src '%s' not being in the list", fty_proto_name(asset));
+      return json;
     }
     json += "data:{\"topic\":\"asset/" + nameElement + "\",\"payload\":{}}\n\n";
   }
@@ -290,28 +214,15 @@ std::string Sse::changeFtyProtoAsset2Json(fty_proto_t *asset)
   {
     log_debug("SSE get an update, create or inventory message");
 
-    if (streq(fty_proto_operation(asset), FTY_PROTO_ASSET_OP_UPDATE)
-        || streq(fty_proto_operation(asset), FTY_PROTO_ASSET_OP_INVENTORY))
+    if (streq(fty_proto_operation(asset), FTY_PROTO_ASSET_OP_UPDATE))
     {
       //if update
-      //Check if asset is in asset element
-      if (_assetsOfDatacenter.find(nameElement) == _assetsOfDatacenter.end())
+      if (change.after != _dc)
       {
-        //The asset is maybe without location
-        if (_assetsWithNoLocation.find(nameElement) != _assetsWithNoLocation.end())
+        //The asset left the datacenter or had no location: send a "delete" message by sse
+        if (change.before == _dc || change.before == noLocation)
         {
-          //remove this asset from the list without location
-          _assetsWithNoLocation.erase(nameElement);
-          //if not in the datacenter, send a "delete" message by sse
-          if (!isAssetInDatacenter(asset))
-          {
-            json += "data:{\"topic\":\"asset/" + nameElement + "\",\"payload\":{}}\n\n";
-          }
-          else
-          {
-            //Add this asset in the list of assets of the datacenter
-              _assetsOfDatacenter.emplace(std::make_pair(nameElement, 5));
-          }
+          json += "data:{\"topic\":\"asset/" + nameElement + "\",\"payload\":{}}\n\n";
         }
         else
         {
@@ -323,40 +234,15 @@ std::string Sse::changeFtyProtoAsset2Json(fty_proto_t *asset)
     }
     else
     {
-      //fty_proto_operation(asset) ==  FTY_PROTO_ASSET_OP_CREATE
-      //Check if parent is null
-      log_debug("Asset parent : %s",fty_proto_aux_string(asset,"parent","0"));
-      if(streq(fty_proto_aux_string(asset,"parent","0"),"0"))
+      //fty_proto_operation(asset) ==  FTY_PROTO_ASSET_OP_CREATE or FTY_PROTO_ASSET_OP_INVENTORY
+      //(inventory leaves the location as is)
+      //Devices without location are sent to every datacenter
+      if (change.after != _dc && change.after != noLocation)
       {
-        //Check if the asset is a device
-        const char *type = fty_proto_aux_string(asset, "type", "none");
-        log_debug("Asset type : %s", type);
-
-        // XXX: autodiscovered items seems to not have a type, need to take a closer look...
-        if (streq(type, "device") || streq(type, "none"))
-        {
-          //Add in the list of asset without location, will send a normal create message
-          _assetsWithNoLocation.emplace(std::make_pair(nameElement, 5));
-        }
-        else
-        {
-          //Asset not in the datacenter which is not a device : Don't send any message
-          return json;
-        }
-      }
-      else if (!isAssetInDatacenter(asset))
-      {
-        //Check if the parent is the filtered datacenter
-        //if not the same datacenter, return
         log_debug("skipping due to element_src '%s' is not an element of the datacenter",
                   nameElement.c_str());
         return json;
       }
-      else
-      {
-        //Add in the list of asset of the datacenter
-        _assetsOfDatacenter.emplace(std::make_pair(nameElement, 5));
-      }
     }
 
     //get id of this element
@@ -412,9 +298,7 @@ std::string Sse::changeSseMessage2Json(zmsg_t *message)
   zstr_free(&aux);
 
   // check asset (assetID is optional)
-  if (!assetID.empty()
-    && (_assetsOfDatacenter.find(assetID) == _assetsOfDatacenter.end())
-  )
+  if (!assetID.empty() && !isAssetInDatacenter(assetID))
   {
     //NOTE: here, message is (partially) consumed and can't be handled elsewhere on return
     log_debug("skipping due to element_src '%s' not being in the list", assetID.c_str());
@@ -424,20 +308,9 @@ std::string Sse::changeSseMessage2Json(zmsg_t *message)
   return "data:{\"topic\":\"" + topic + "\",\"payload\":" + jsonPayload + "}\n\n";
 }
 
-bool Sse::isAssetInDatacenter(fty_proto_t *asset)
+bool Sse::isAssetInDatacenter(const std::string& name) const
 {
-  int i = 1;
-  const char * parentName = fty_proto_aux_string(asset, ("parent_name." + std::to_string(i)).c_str(), "not found");
-  bool found = streq(parentName, _datacenter.c_str());
-
-  while (!found && !streq(parentName, "not found"))
-  {
-    i++;
-    parentName = fty_proto_aux_string(asset, ("parent_name." + std::to_string(i)).c_str(), "not found");
-    found = streq(parentName, _datacenter.c_str());
-  }
-  log_debug("Sse : Asset %s found",found ? "":"not");
-  return found;
+  return _dc != nullptr && AssetDcIndex::instance().find(name) == _dc;
 }
 
 bool Sse::shouldPublishAlert(fty_proto_t *alert)
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include "shared/asset_dc_index.h"
 #include <exception>
 #include <fty_proto.h>
 #include <functional>
@@ -63,15 +64,14 @@ private:
     std::string                       _json;
     std::string                       _datacenter;
     tntdb::Connection                 _connection;
-    std::map<std::string, int>        _assetsOfDatacenter;
-    std::map<std::string, int>        _assetsWithNoLocation;
+    AssetDcIndex::Dc                  _dc = nullptr;
     std::map<std::string, AlertState> _alertStates;
     uint32_t                          _datacenter_id;
     mlm_client_t*                     _clientMlm = NULL;
     zsock_t*                          _pipe      = NULL;
     zpoller_t*                        _poller    = NULL;
 
-    bool isAssetInDatacenter(fty_proto_t* asset);
+    bool isAssetInDatacenter(const std::string& name) const;
     bool shouldPublishAlert(fty_proto_t* alert);
 
 public:
@@ -132,7 +132,7 @@ public:
     /// get the message from malamate
     zmsg_t* getMessageFromMlm();
 
-    /// Search all asset included in the datacenter
+    /// Make sure the asset datacenter index is loaded
     /// @return null or an error message if error
     std::string loadAssetFromDatacenter();
 
@@ -140,9 +140,9 @@ public:
     /// @return an empty string if error
     std::string changeFtyProtoAlert2Json(fty_proto_t* alert);
 
-    /// Convert an fty_proto_asset message to json
+    /// Convert an fty_proto_asset message to json, change is its location change computed by AssetDcIndex
     /// @return an empty string if error
-    std::string changeFtyProtoAsset2Json(fty_proto_t* asset);
+    std::string changeFtyProtoAsset2Json(fty_proto_t* asset, const AssetDcIndex::Change& change);
 
     /// Convert generic sse message to json
     /// @return an empty string if error
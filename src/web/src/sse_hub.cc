@@ -0,0 +1,290 @@
+/*
+ *
+ * Copyright (C) 2018 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file sse_hub.cc
+ * \brief Shared per-datacenter fan-out of sse frames
+ */
+#include "web/src/sse_hub.h"
+#include <fty_common_db_dbpath.h>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <chrono>
+#include <cinttypes>
+#include <future>
+#include <map>
+#include <tntdb/connect.h>
+
+namespace {
+
+struct HubEntry
+{
+    std::weak_ptr<SseHub> hub;
+    // result of init() of the hub, pending while it runs
+    std::shared_future<std::string> started;
+};
+
+std::mutex                      s_hubsMutex;
+std::map<std::string, HubEntry> s_hubs;
+
+} // namespace
+
+std::shared_ptr<SseHub> SseHub::acquire(const std::string& datacenter, uint32_t datacenterId, std::string& errorMsg)
+{
+    std::shared_ptr<SseHub>         hub;
+    std::shared_future<std::string> started;
+    std::promise<std::string>       initDone;
+    bool                            starter = false;
+    {
+        // the lock covers the map only, the hub is started without it
+        std::lock_guard<std::mutex> lock(s_hubsMutex);
+
+        auto& entry = s_hubs[datacenter];
+        hub         = entry.hub.lock();
+        bool pending =
+            hub && entry.started.valid() && entry.started.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+        if (!hub || (!pending && !hub->isRunning())) {
+            hub.reset(new SseHub(datacenter, datacenterId, DEFAULT_CAPACITY));
+            entry.hub     = hub;
+            entry.started = initDone.get_future().share();
+            starter       = true;
+        }
+        started = entry.started;
+    }
+
+    if (starter) {
+        hub->_thread = std::thread([raw = hub.get(), initDone = std::move(initDone)]() mutable {
+            std::string err = raw->init();
+            raw->_running   = err.empty();
+            initDone.set_value(err);
+            if (raw->_running) {
+                raw->run();
+            }
+        });
+    }
+
+    // callers for the same datacenter wait for the same start
+    errorMsg = started.get();
+    if (!errorMsg.empty()) {
+        return nullptr;
+    }
+
+    if (starter) {
+        log_info("sse hub started for datacenter '%s'", datacenter.c_str());
+    }
+    return hub;
+}
+
+SseHub::SseHub(const std::string& datacenter, uint32_t datacenterId, size_t capacity)
+    : _datacenter(datacenter)
+    , _ring(capacity)
+{
+    _sse.setDatacenter(datacenter);
+    _sse.setDatacenterId(datacenterId);
+}
+
+SseHub::~SseHub()
+{
+    if (_subscription) {
+        AssetDcIndex::instance().unsubscribe(_subscription);
+    }
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    for (auto& asset : _assets) {
+        fty_proto_destroy(&asset.first);
+    }
+    zsock_destroy(&_wakeupBackend);
+    zsock_destroy(&_wakeup);
+    log_info("sse hub stopped for datacenter '%s'", _datacenter.c_str());
+}
+
+uint64_t SseHub::cursor() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _head;
+}
+
+bool SseHub::wait(uint64_t& cursor, int timeoutMs, std::vector<Frame>& frames) const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() {
+        return _head > cursor || !_running;
+    });
+
+    uint64_t oldest = _head > _ring.size() ? _head - _ring.size() : 0;
+    if (cursor < oldest) {
+        log_warning("sse client too slow, %" PRIu64 " frames dropped", oldest - cursor);
+        cursor = oldest;
+    }
+    for (; cursor < _head; ++cursor) {
+        frames.push_back(_ring[cursor % _ring.size()]);
+    }
+    return _running;
+}
+
+void SseHub::publish(std::string&& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ring[_head % _ring.size()] = std::make_shared<const std::string>(std::move(frame));
+        ++_head;
+    }
+    _cond.notify_all();
+}
+
+std::string SseHub::init()
+{
+    try {
+        _sse.setConnection(tntdb::connect(DBConn::url));
+    } catch (const std::exception& e) {
+        log_error("tntdb::connect (url = '%s') failed: %s.", DBConn::url.c_str(), e.what());
+        return TRANSLATE_ME("Connecting to database failed.");
+    }
+
+    // Get asset from the datacenter
+    std::string errorMsg = _sse.loadAssetFromDatacenter();
+    if (!errorMsg.empty()) {
+        return errorMsg;
+    }
+
+    // connect to malamute and streams
+    errorMsg = _sse.connectMalamute();
+    if (!errorMsg.empty()) {
+        return errorMsg;
+    }
+    if (-1 == _sse.consumeStream(FTY_PROTO_STREAM_ALERTS, ".*")) {
+        return TRANSLATE_ME("Cannot consume ALERT stream");
+    }
+    if (-1 == _sse.consumeStream("SSE", ".*")) {
+        return TRANSLATE_ME("Cannot consume SSE stream");
+    }
+
+    // assets come from the index, which consumes the ASSETS stream for everybody
+    _wakeup = zsys_create_pipe(&_wakeupBackend);
+    if (!_wakeup || zpoller_add(_sse.getPoller(), _wakeup) == -1) {
+        return TRANSLATE_ME("Cannot create sse hub pipe");
+    }
+    _subscription = AssetDcIndex::instance().subscribe([this](fty_proto_t* asset, const AssetDcIndex::Change& change) {
+        queueAsset(asset, change);
+    });
+    return "";
+}
+
+void SseHub::queueAsset(fty_proto_t* asset, const AssetDcIndex::Change& change)
+{
+    if (!asset) {
+        // the index was dropped, subscribers reconnect to a new hub
+        _stop = true;
+        return;
+    }
+
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> lock(_assetsMutex);
+        wakeup = _assets.empty();
+        _assets.emplace_back(fty_proto_dup(asset), change);
+    }
+    // the hub thread drains the whole queue, one signal is enough
+    if (wakeup) {
+        zsock_signal(_wakeupBackend, 0);
+    }
+}
+
+void SseHub::handleAssets()
+{
+    zsock_wait(_wakeup);
+
+    std::deque<AssetChange> assets;
+    {
+        std::lock_guard<std::mutex> lock(_assetsMutex);
+        assets.swap(_assets);
+    }
+    for (auto& asset : assets) {
+        std::string json = _sse.changeFtyProtoAsset2Json(asset.first, asset.second);
+        fty_proto_destroy(&asset.first);
+        if (!json.empty()) {
+            publish(std::move(json));
+        }
+    }
+}
+
+void SseHub::run()
+{
+    while (!_stop) {
+        // short timeout, so that the last subscriber leaving stops us quickly
+        zsock_t* which = static_cast<zsock_t*>(zpoller_wait(_sse.getPoller(), 1000));
+        if (!which) {
+            if (zpoller_terminated(_sse.getPoller())) {
+                log_error("sse hub '%s': zpoller_wait terminated.", _datacenter.c_str());
+                break;
+            }
+            continue;
+        }
+        if (which == _wakeup) {
+            handleAssets();
+            continue;
+        }
+
+        zmsg_t* recv_msg = _sse.getMessageFromMlm();
+        if (recv_msg) {
+            handleMessage(&recv_msg);
+            zmsg_destroy(&recv_msg);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _cond.notify_all();
+}
+
+void SseHub::handleMessage(zmsg_t** recv_msg)
+{
+    if (_sse.messageCommand() != "STREAM DELIVER") {
+        log_debug("%s message not handled", _sse.messageCommand().c_str());
+        return;
+    }
+
+    std::string json;
+    if (fty_proto_is(*recv_msg)) {
+        fty_proto_t* msgProto = fty_proto_decode(recv_msg);
+
+        if (msgProto == NULL) {
+            log_debug("msgProto is NULL");
+        } else if (fty_proto_id(msgProto) == FTY_PROTO_ALERT) {
+            json = _sse.changeFtyProtoAlert2Json(msgProto);
+        } else {
+            log_debug("FTY_PROTO message not handled (id: %d)", fty_proto_id(msgProto));
+        }
+        fty_proto_destroy(&msgProto);
+    } else if (_sse.messageSubject() == "SSE") {
+        json = _sse.changeSseMessage2Json(*recv_msg);
+    } else {
+        log_debug("%s message not handled (subject: %s)", _sse.messageCommand().c_str(),
+            _sse.messageSubject().c_str());
+    }
+
+    if (!json.empty()) {
+        publish(std::move(json));
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ *
+ * Copyright (C) 2018 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/// @file sse_hub.h
+/// @brief Shared per-datacenter fan-out of sse frames
+///
+/// How it works
+/// ============
+/// One SseHub exists per datacenter for as long as at least one sse
+/// connection holds it. The hub owns a single Sse object (malamute client,
+/// database connection) driven by its own thread: every ALERTS/SSE message
+/// is decoded and rendered to a "data:" frame once, then stored in a bounded
+/// ring buffer. Assets messages are not consumed by the hub but received
+/// from AssetDcIndex with their change of location: they are queued and the
+/// hub thread is woken up by a pipe to render them. Each sse connection keeps a
+/// cursor in that ring and writes the frames it has not seen yet.
+/// A connection falling behind by more than the ring capacity skips the
+/// overwritten frames.
+
+#pragma once
+
+#include "web/src/sse.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SseHub
+{
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    /// Default number of frames kept in the ring buffer
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    /// Get the hub of the datacenter, start it if needed.
+    /// Callers arriving while the hub starts wait for that start, other datacenters are not blocked.
+    /// @return the hub or nullptr (errorMsg is then set)
+    static std::shared_ptr<SseHub> acquire(const std::string& datacenter, uint32_t datacenterId, std::string& errorMsg);
+
+    ~SseHub();
+
+    SseHub(const SseHub&) = delete;
+    SseHub& operator=(const SseHub&) = delete;
+
+    /// Cursor of the next frame to be published (new subscribers start here)
+    uint64_t cursor() const;
+
+    /// Wait up to timeoutMs for frames published at or after cursor.
+    /// Appends them to frames and advances cursor.
+    /// @return false if the hub is stopped
+    bool wait(uint64_t& cursor, int timeoutMs, std::vector<Frame>& frames) const;
+
+    bool isRunning() const
+    {
+        return _running;
+    }
+
+private:
+    SseHub(const std::string& datacenter, uint32_t datacenterId, size_t capacity);
+
+    /// Connect malamute/database and load the datacenter assets
+    /// @return empty string or an error message
+    std::string init();
+    void        run();
+    void        publish(std::string&& frame);
+    void        handleMessage(zmsg_t** recv_msg);
+    void        queueAsset(fty_proto_t* asset, const AssetDcIndex::Change& change);
+    void        handleAssets();
+
+    using AssetChange = std::pair<fty_proto_t*, AssetDcIndex::Change>;
+
+    Sse                             _sse;
+    std::string                     _datacenter;
+    std::vector<Frame>              _ring;
+    uint64_t                        _head = 0;
+    mutable std::mutex              _mutex;
+    mutable std::condition_variable _cond;
+    std::atomic<bool>               _running{false};
+    std::atomic<bool>               _stop{false};
+    std::thread                     _thread;
+
+    size_t                  _subscription = 0;
+    std::mutex              _assetsMutex;
+    std::deque<AssetChange> _assets;
+    zsock_t*                _wakeup        = nullptr; // polled by the hub thread
+    zsock_t*                _wakeupBackend = nullptr; // signaled by the index listener
+};
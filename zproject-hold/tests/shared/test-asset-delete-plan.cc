@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file test-asset-delete-plan.cc
+ * \brief Tests of the order of deletion of many assets
+ */
+#include <catch.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shared/asset_delete_plan.h"
+
+using Links = std::vector<std::pair<uint32_t, uint32_t>>;
+
+static db_a_elmnt_t s_el (uint32_t id, uint32_t parent_id, const std::string& name = "")
+{
+    db_a_elmnt_t el {};
+    el.id = id;
+    el.parent_id = parent_id;
+    el.name = name.empty () ? "asset-" + std::to_string (id) : name;
+    el.status = "active";
+    return el;
+}
+
+static std::vector<uint32_t> s_order (const AssetDeletePlan& plan)
+{
+    std::vector<uint32_t> order;
+    for (const auto& step : plan.steps ()) {
+        order.push_back (step.el.id);
+    }
+    return order;
+}
+
+static std::vector<uint32_t> s_rejected (const AssetDeletePlan& plan)
+{
+    std::vector<uint32_t> rejected;
+    for (const auto& it : plan.rejected ()) {
+        CHECK ( it.second.status == 0 );
+        rejected.push_back (it.first);
+    }
+    return rejected;
+}
+
+TEST_CASE ("AssetDeletePlan containment", "[delete]")
+{
+    // datacenter 1, room 2, racks 3 and 4
+    std::vector<db_a_elmnt_t> elements {s_el (1, 0), s_el (2, 1), s_el (3, 2), s_el (4, 2)};
+
+    AssetDeletePlan plan (elements, {}, {1, 2, 3, 4});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {3, 4, 2, 1} ));
+    CHECK ( s_rejected (plan).empty () );
+    CHECK ( plan.found ().size () == 4 );
+    REQUIRE ( plan.steps ().size () == 4 );
+    CHECK (( plan.steps ()[2].children == std::vector<uint32_t> {3, 4} ));
+
+    // a child which is not requested keeps its parent
+    plan = AssetDeletePlan (elements, {}, {2, 3});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {3} ));
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {2} ));
+
+    // unknown assets are rejected and not found, duplicates are planned once
+    plan = AssetDeletePlan (elements, {}, {42, 4, 4});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {4} ));
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {42} ));
+    CHECK ( plan.found ().size () == 2 );
+}
+
+TEST_CASE ("AssetDeletePlan power links", "[delete]")
+{
+    // ups 10 powers pdu 11, which powers server 12, all in rack 3, server 13 stands alone
+    std::vector<db_a_elmnt_t> elements {s_el (3, 0), s_el (10, 3), s_el (11, 3), s_el (12, 3), s_el (13, 0)};
+    Links links {{10, 11}, {11, 12}};
+
+    AssetDeletePlan plan (elements, links, {10, 11, 12, 3});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {12, 11, 10, 3} ));
+    REQUIRE ( plan.steps ().size () == 4 );
+    CHECK (( plan.steps ()[1].links == std::vector<uint32_t> {12} ));
+
+    // powering a device which stays prevents the delete
+    plan = AssetDeletePlan (elements, links, {10, 12});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {12} ));
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {10} ));
+
+    // independent assets keep the order of the request
+    plan = AssetDeletePlan (elements, links, {13, 12});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {13, 12} ));
+
+    // a device powering itself does not depend on itself
+    plan = AssetDeletePlan (elements, {{13, 13}}, {13});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {13} ));
+    CHECK ( s_rejected (plan).empty () );
+}
+
+TEST_CASE ("AssetDeletePlan power link cycles", "[delete]")
+{
+    // ups 10 and 11 power each other, 12 powers 10 and 13 powers 12
+    std::vector<db_a_elmnt_t> elements {s_el (3, 0), s_el (10, 3), s_el (11, 3), s_el (12, 3), s_el (13, 3)};
+    Links links {{10, 11}, {11, 10}, {12, 10}, {13, 12}};
+
+    // assets of the cycle are deleted in the order of the request
+    AssetDeletePlan plan (elements, links, {11, 10});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {11, 10} ));
+    CHECK ( s_rejected (plan).empty () );
+    REQUIRE ( plan.steps ().size () == 2 );
+    CHECK ( plan.steps ()[0].links.empty () );
+    CHECK ( plan.steps ()[1].links.empty () );
+
+    // assets powering the cycle still wait for it
+    plan = AssetDeletePlan (elements, links, {13, 12, 10, 11, 3});
+    CHECK (( s_order (plan) == std::vector<uint32_t> {10, 12, 13, 11, 3} ));
+    CHECK ( s_rejected (plan).empty () );
+    REQUIRE ( plan.steps ().size () == 5 );
+    CHECK (( plan.steps ()[1].links == std::vector<uint32_t> {10} ));
+
+    // part of a cycle cannot go alone
+    plan = AssetDeletePlan (elements, links, {10});
+    CHECK ( s_order (plan).empty () );
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {10} ));
+
+    // nor can assets powering a cycle which stays
+    plan = AssetDeletePlan (elements, links, {12, 13});
+    CHECK ( s_order (plan).empty () );
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {12, 13} ));
+}
+
+TEST_CASE ("AssetDeletePlan rackcontroller-0", "[delete]")
+{
+    std::vector<db_a_elmnt_t> elements {s_el (3, 0), s_el (10, 3, "rackcontroller-0")};
+
+    AssetDeletePlan plan (elements, {}, {10, 3});
+    CHECK ( s_order (plan).empty () );
+    CHECK (( s_rejected (plan) == std::vector<uint32_t> {10, 3} ));
+}
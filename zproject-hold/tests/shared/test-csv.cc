@@ -0,0 +1,210 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file test-csv.cc
+ * \brief Tests of the streaming csv reader and writer and of the dialect sniffer
+ */
+#include <catch.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shared/csv.h"
+#include "shared/csv_reader.h"
+#include "shared/csv_writer.h"
+
+using Rows = std::vector<std::vector<std::string>>;
+
+// all rows of the input, as strings
+static Rows s_read (const std::string& input, char delimiter = ',', size_t blockSize = 64 * 1024)
+{
+    std::istringstream in (input);
+    shared::CsvReader reader (in, delimiter, blockSize);
+    std::vector<std::string_view> fields;
+    Rows rows;
+    while (reader.next (fields)) {
+        rows.emplace_back (fields.begin (), fields.end ());
+    }
+    return rows;
+}
+
+TEST_CASE ("CsvReader fields", "[csv]")
+{
+    CHECK (( s_read ("") == Rows{} ));
+    CHECK (( s_read ("a,b,c\n1,2,3\n") == Rows{{"a", "b", "c"}, {"1", "2", "3"}} ));
+    // no line end at the end of the input
+    CHECK (( s_read ("a,b\n1,2") == Rows{{"a", "b"}, {"1", "2"}} ));
+    // empty fields
+    CHECK (( s_read (",\n,a,\n") == Rows{{"", ""}, {"", "a", ""}} ));
+    // other delimiters
+    CHECK (( s_read ("a;b\t c\n", ';') == Rows{{"a", "b\t c"}} ));
+    CHECK (( s_read ("a;b\t c\n", '\t') == Rows{{"a;b", " c"}} ));
+}
+
+TEST_CASE ("CsvReader line ends", "[csv]")
+{
+    CHECK (( s_read ("a,b\r\n1,2\r\n") == Rows{{"a", "b"}, {"1", "2"}} ));
+    CHECK (( s_read ("a,b\r1,2\r") == Rows{{"a", "b"}, {"1", "2"}} ));
+    CHECK (( s_read ("a,b\n1,2\r\n3,4\r5,6") == Rows{{"a", "b"}, {"1", "2"}, {"3", "4"}, {"5", "6"}} ));
+    // empty lines are skipped
+    CHECK (( s_read ("\n\r\na\n\n\r\nb\r\n\r\n") == Rows{{"a"}, {"b"}} ));
+
+    // line numbers count LF, quoted line breaks included
+    std::istringstream in ("a\r\n\r\n\"b\nc\"\nd\n");
+    shared::CsvReader reader (in, ',');
+    std::vector<std::string_view> fields;
+    REQUIRE ( reader.next (fields) );
+    CHECK ( reader.line () == 1 );
+    REQUIRE ( reader.next (fields) );
+    CHECK ( reader.line () == 3 );
+    CHECK ( fields[0] == "b\nc" );
+    REQUIRE ( reader.next (fields) );
+    CHECK ( reader.line () == 5 );
+    CHECK ( !reader.next (fields) );
+}
+
+TEST_CASE ("CsvReader quoting", "[csv]")
+{
+    CHECK (( s_read ("\"a,b\",c\n") == Rows{{"a,b", "c"}} ));
+    CHECK (( s_read ("\"a\"\"b\",\"\"\"\"\n") == Rows{{"a\"b", "\""}} ));
+    CHECK (( s_read ("\"\",\"\"\n") == Rows{{"", ""}} ));
+    // line breaks inside quotes
+    CHECK (( s_read ("\"a\nb\",\"c\r\nd\"\nx\n") == Rows{{"a\nb", "c\r\nd"}, {"x"}} ));
+    // a quote inside an unquoted field is an ordinary character
+    CHECK (( s_read ("a\"b,c\n") == Rows{{"a\"b", "c"}} ));
+    // an apostrophe does not quote
+    CHECK (( s_read ("'a,b',O'Brien\n") == Rows{{"'a", "b'", "O'Brien"}} ));
+    // text after the closing quote is kept
+    CHECK (( s_read ("\"a\"b,c\n") == Rows{{"ab", "c"}} ));
+    // unterminated quote takes the rest of the input
+    CHECK (( s_read ("a,\"b,c\nd") == Rows{{"a", "b,c\nd"}} ));
+}
+
+TEST_CASE ("CsvReader small blocks", "[csv]")
+{
+    std::string input = "name,\"quoted \"\"value\"\"\",x\r\n\r\n\"multi\r\nline\",last\r\n";
+    Rows expected = {{"name", "quoted \"value\"", "x"}, {"multi\r\nline", "last"}};
+    for (size_t blockSize = 1; blockSize != 8; ++blockSize) {
+        CAPTURE (blockSize);
+        CHECK ( s_read (input, ',', blockSize) == expected );
+    }
+}
+
+TEST_CASE ("sniffDialect", "[csv]")
+{
+    SECTION ("delimiters") {
+        std::istringstream comma ("name,type,sub_type\n1;2;3;4;5\n");
+        CHECK ( shared::sniffDialect (comma).delimiter == ',' );
+        std::istringstream semicolon ("name;type;sub_type\n");
+        CHECK ( shared::sniffDialect (semicolon).delimiter == ';' );
+        std::istringstream tab ("name\ttype,x\tsub_type\r\n");
+        CHECK ( shared::sniffDialect (tab).delimiter == '\t' );
+        // the first one wins a tie
+        std::istringstream tie ("a;b,c\n");
+        CHECK ( shared::sniffDialect (tie).delimiter == ';' );
+        std::istringstream none ("name\n");
+        CHECK ( shared::sniffDialect (none).delimiter == '\x0' );
+        std::istringstream empty ("");
+        CHECK ( shared::sniffDialect (empty).delimiter == '\x0' );
+    }
+
+    SECTION ("quotes") {
+        // delimiters inside double quotes are not counted, even across lines
+        std::istringstream quoted ("\"a;b;c;d\",\"e;\nf;g\",h\n");
+        CHECK ( shared::sniffDialect (quoted).delimiter == ',' );
+        std::istringstream doubled ("\"a\"\";\"\";\",b,c\n");
+        CHECK ( shared::sniffDialect (doubled).delimiter == ',' );
+        // an apostrophe does not quote
+        std::istringstream apostrophe ("'name;type;x',a,b\n");
+        CHECK ( shared::sniffDialect (apostrophe).delimiter == ';' );
+    }
+
+    SECTION ("BOM and position") {
+        std::istringstream bom ("\xef\xbb\xbfname;type\n1;2\n");
+        shared::CsvDialect dialect = shared::sniffDialect (bom);
+        CHECK ( dialect.bom );
+        CHECK ( dialect.delimiter == ';' );
+        std::string rest;
+        std::getline (bom, rest);
+        CHECK ( rest == "name;type" );
+
+        std::istringstream plain ("name,type\n");
+        dialect = shared::sniffDialect (plain);
+        CHECK ( !dialect.bom );
+        std::getline (plain, rest);
+        CHECK ( rest == "name,type" );
+    }
+
+    SECTION ("first block only") {
+        std::istringstream in ("a,b,c;d;e;f;g\n");
+        CHECK ( shared::sniffDialect (in, 4).delimiter == ',' );
+        // the stream is usable after a short input
+        std::istringstream shortInput ("a;b");
+        CHECK ( shared::sniffDialect (shortInput, 1024).delimiter == ';' );
+        std::string rest;
+        std::getline (shortInput, rest);
+        CHECK ( rest == "a;b" );
+    }
+}
+
+// the writer output, as read back
+static std::string s_write (const std::vector<std::string>& fields, char delimiter = ',')
+{
+    std::ostringstream out;
+    shared::CsvWriter w (out, delimiter);
+    for (const auto& field : fields) {
+        w.field (field);
+    }
+    w.endRow ();
+    CHECK ( w.flush () );
+    CHECK (( s_read (out.str (), delimiter) == Rows{fields} ));
+    return out.str ();
+}
+
+TEST_CASE ("CsvWriter quoting", "[csv]")
+{
+    CHECK (( s_write ({"a", "b c", "1"}) == "a,b c,1\n" ));
+    CHECK (( s_write ({"a,b", "c"}) == "\"a,b\",c\n" ));
+    CHECK (( s_write ({"a;b", "c"}, ';') == "\"a;b\";c\n" ));
+    CHECK (( s_write ({"a;b", "c"}) == "a;b,c\n" ));
+    CHECK (( s_write ({"say \"hi\"", "\""}) == "\"say \"\"hi\"\"\",\"\"\"\"\n" ));
+    CHECK (( s_write ({"a\nb", "c\r\nd", "e\rf"}) == "\"a\nb\",\"c\r\nd\",\"e\rf\"\n" ));
+    // a leading apostrophe is quoted for older readers, others are not
+    CHECK (( s_write ({"'a", "O'Brien"}) == "\"'a\",O'Brien\n" ));
+    CHECK (( s_write ({"x", "", "y"}) == "x,,y\n" ));
+}
+
+TEST_CASE ("CsvWriter rows", "[csv]")
+{
+    std::ostringstream out;
+    {
+        // a buffer smaller than a row, written by every endRow ()
+        shared::CsvWriter w (out, ',', 4);
+        w.field ("name").field (uint32_t (42)).endRow ();
+        CHECK ( out.str () == "name,42\n" );
+        w.field ("").endRow ();
+        w.field ("x").field (uint32_t (4294967295u));
+        CHECK ( w.rows () == 2 );
+        w.endRow ();
+        CHECK ( w.rows () == 3 );
+    }
+    CHECK ( out.str () == "name,42\n\nx,4294967295\n" );
+}
@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file test-import-plan.cc
+ * \brief Tests of the order of import of csv rows
+ */
+#include <catch.hpp>
+#include <string>
+#include <vector>
+
+#include "db/import_plan.h"
+
+using persist::RowRefs;
+
+// rows[0] stands for the titles
+static persist::ImportPlan s_plan (const std::vector<RowRefs>& rows)
+{
+    std::vector<RowRefs> all {RowRefs {}};
+    all.insert (all.end (), rows.begin (), rows.end ());
+    return persist::import_plan (all);
+}
+
+static bool s_contains (const std::string& s, const std::string& part)
+{
+    return s.find (part) != std::string::npos;
+}
+
+TEST_CASE ("import_plan csv order", "[import]")
+{
+    // row numbers of the plan are indexes of the csv map, the title is row 0
+    auto plan = s_plan ({
+        {"dc", "", {}},
+        {"room", "", {"dc"}},
+        {"ups", "", {"room", "database-asset"}},
+        {"rack", "", {"room", "group-in-database"}},
+    });
+    CHECK (( plan.in_order == std::vector<bool> {false, true, true, true, true} ));
+    CHECK ( plan.deferred.empty () );
+    CHECK ( plan.cycles.empty () );
+
+    // references to itself (ignored power source) do not defer the row
+    plan = s_plan ({{"ups", "", {"ups", "ups"}}});
+    CHECK (( plan.in_order == std::vector<bool> {false, true} ));
+    CHECK ( plan.deferred.empty () );
+
+    // an empty input has only the title
+    plan = persist::import_plan ({RowRefs {}});
+    CHECK (( plan.in_order == std::vector<bool> {false} ));
+    CHECK ( plan.deferred.empty () );
+}
+
+TEST_CASE ("import_plan forward references", "[import]")
+{
+    auto plan = s_plan ({
+        {"room", "", {"dc"}},
+        {"rack", "", {"room"}},
+        {"pdu", "", {"rack", "ups"}},
+        {"ups", "ups-12", {}},
+        {"dc", "", {}},
+        {"feed", "", {"dc"}},
+    });
+    // rows referencing later rows, and rows depending on them, are deferred
+    CHECK (( plan.in_order == std::vector<bool> {false, false, false, false, true, true, true} ));
+    CHECK (( plan.deferred == std::vector<size_t> {1, 2, 3} ));
+    CHECK ( plan.cycles.empty () );
+
+    // id references rows too, a duplicate reference is one dependency
+    plan = s_plan ({
+        {"epdu", "", {"ups-12", "ups-12", "ups-12"}},
+        {"ups", "ups-12", {}},
+    });
+    CHECK (( plan.in_order == std::vector<bool> {false, false, true} ));
+    CHECK (( plan.deferred == std::vector<size_t> {1} ));
+}
+
+TEST_CASE ("import_plan deferred rows in dependency order", "[import]")
+{
+    // 1 needs 3, 3 needs 4, 2 needs 4: rows freed together are taken in csv order
+    auto plan = s_plan ({
+        {"a", "", {"c"}},
+        {"b", "", {"d"}},
+        {"c", "", {"d"}},
+        {"d", "", {"e"}},
+        {"e", "", {}},
+    });
+    CHECK (( plan.deferred == std::vector<size_t> {4, 2, 3, 1} ));
+    CHECK (( plan.in_order == std::vector<bool> {false, false, false, false, false, true} ));
+    CHECK ( plan.cycles.empty () );
+}
+
+TEST_CASE ("import_plan cycles", "[import]")
+{
+    auto plan = s_plan ({
+        {"ups-a", "", {"ups-b"}},
+        {"ups-b", "", {"ups-a"}},
+        {"pdu", "", {"ups-a"}},
+        {"rack", "", {}},
+        {"x", "", {"y"}},
+        {"y", "", {"z"}},
+        {"z", "", {"x"}},
+    });
+    CHECK (( plan.in_order == std::vector<bool> {false, false, false, false, true, false, false, false} ));
+
+    // rows in a cycle, or depending on one, are reported
+    REQUIRE ( plan.cycles.size () == 6 );
+    CHECK ( plan.cycles.count (4) == 0 );
+    // user-visible row numbers count the title as line 1
+    CHECK ( s_contains (plan.cycles[1], "2 -> 3 -> 2") );
+    CHECK ( s_contains (plan.cycles[2], "2 -> 3 -> 2") );
+    CHECK ( s_contains (plan.cycles[3], "depends on row") );
+    CHECK ( s_contains (plan.cycles[5], "6 -> 7 -> 8 -> 6") );
+    CHECK ( s_contains (plan.cycles[6], "6 -> 7 -> 8 -> 6") );
+    CHECK ( s_contains (plan.cycles[7], "6 -> 7 -> 8 -> 6") );
+
+    // and imported last, in csv order
+    CHECK (( plan.deferred == std::vector<size_t> {1, 2, 3, 5, 6, 7} ));
+}
+
+TEST_CASE ("import_plan rows after a cycle", "[import]")
+{
+    // the cycle does not stop the ordering of the other rows
+    auto plan = s_plan ({
+        {"a", "", {"b"}},
+        {"b", "", {"a"}},
+        {"c", "", {"d"}},
+        {"d", "", {}},
+    });
+    CHECK (( plan.deferred == std::vector<size_t> {3, 1, 2} ));
+    CHECK ( plan.cycles.count (3) == 0 );
+    CHECK ( plan.cycles.count (1) == 1 );
+    CHECK ( plan.cycles.count (2) == 1 );
+}
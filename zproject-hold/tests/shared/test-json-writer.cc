@@ -0,0 +1,146 @@
+/*
+ *
+ * Copyright (C) 2015 - 2020 Eaton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*!
+ * \file test-json-writer.cc
+ * \brief Tests of the streaming json writer
+ */
+#include <catch.hpp>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "shared/json_writer.h"
+
+static std::string s_escaped (const std::string& value)
+{
+    std::string json;
+    utils::JsonWriter w (json);
+    w.value (value);
+    return json;
+}
+
+TEST_CASE ("JsonWriter escaping", "[json]")
+{
+    CHECK ( s_escaped ("") == R"("")" );
+    CHECK ( s_escaped ("abc") == R"("abc")" );
+    CHECK ( s_escaped ("a\"b") == R"("a\"b")" );
+    CHECK ( s_escaped ("c:\\dir") == R"("c:\\dir")" );
+    CHECK ( s_escaped ("\b\f\n\r\t") == R"("\b\f\n\r\t")" );
+    CHECK ( s_escaped (std::string ("\x01\x1f", 2)) == R"("\u0001\u001f")" );
+    CHECK ( s_escaped (std::string ("a\0b", 3)) == R"("a\u0000b")" );
+    // utf-8 is written as is
+    CHECK ( s_escaped ("тест") == "\"тест\"" );
+
+    // valid escape sequences are kept, as by utils::json::escape
+    CHECK ( s_escaped (R"(a\"b)") == R"("a\"b")" );
+    CHECK ( s_escaped (R"(a\nb)") == R"("a\nb")" );
+    CHECK ( s_escaped (R"(\u00e9)") == R"("\u00e9")" );
+    CHECK ( s_escaped (R"(a\/b)") == R"("a\/b")" );
+    // a lone backslash is escaped
+    CHECK ( s_escaped (R"(a\xb)") == R"("a\\xb")" );
+    CHECK ( s_escaped (R"(a\)") == R"("a\\")" );
+
+    std::string json;
+    utils::JsonWriter w (json);
+    w.beginObject ().member ("k\"ey", "v").endObject ();
+    CHECK ( json == R"({"k\"ey":"v"})" );
+}
+
+TEST_CASE ("JsonWriter numbers", "[json]")
+{
+    std::string json;
+    utils::JsonWriter w (json);
+    w.beginArray ();
+    w.value (int64_t (-42)).value (0).value (uint32_t (4294967295u)).value (true).value (false);
+    w.value (1.5).value (-0.25);
+    w.value (std::nan ("")).value (std::numeric_limits<double>::infinity ());
+    w.value (-std::numeric_limits<double>::infinity ());
+    w.null ().value ((const char*) NULL);
+    w.endArray ();
+    CHECK ( json == "[-42,0,4294967295,true,false,1.500000,-0.250000,null,null,null,null,null]" );
+}
+
+TEST_CASE ("JsonWriter commas", "[json]")
+{
+    std::string json;
+    utils::JsonWriter w (json);
+    w.beginObject ();
+    w.member ("a", 1);
+    w.key ("b").beginArray ().endArray ();
+    w.key ("c").beginArray ();
+    w.beginObject ().endObject ();
+    w.beginObject ().member ("d", "x").member ("e", "y").endObject ();
+    w.beginArray ().value (1).value (2).endArray ();
+    w.endArray ();
+    w.key ("f").beginObject ().endObject ();
+    w.key ("g").raw ("{\"h\":1}");
+    w.member ("i", "j");
+    w.endObject ();
+    CHECK ( json == R"({"a":1,"b":[],"c":[{},{"d":"x","e":"y"},[1,2]],"f":{},"g":{"h":1},"i":"j"})" );
+}
+
+TEST_CASE ("JsonWriter elements", "[json]")
+{
+    // values at the top level are separated, to be merged into an array
+    std::string shard1, shard2, empty;
+    {
+        utils::JsonWriter w (shard1);
+        w.beginObject ().member ("id", 1).endObject ();
+        w.beginObject ().member ("id", 2).endObject ();
+    }
+    {
+        utils::JsonWriter w (shard2);
+        w.value ("three");
+    }
+    CHECK ( shard1 == R"({"id":1},{"id":2})" );
+
+    std::string json;
+    utils::JsonWriter w (json);
+    w.beginArray ().elements (empty).elements (shard1).elements (empty).elements (shard2).value (4).endArray ();
+    CHECK ( json == R"([{"id":1},{"id":2},"three",4])" );
+
+    std::string none;
+    utils::JsonWriter w2 (none);
+    w2.beginArray ().elements (empty).endArray ();
+    CHECK ( none == "[]" );
+}
+
+TEST_CASE ("JsonWriter stream", "[json]")
+{
+    std::string large (100, 'x');
+    std::ostringstream out;
+    {
+        // a buffer smaller than the values, flushed many times
+        utils::JsonWriter w (out, 16);
+        w.beginArray ();
+        for (int i = 0; i != 3; ++i) {
+            w.beginObject ().member ("value", large).endObject ();
+        }
+        w.elements ("\"" + large + "\",\"" + large + "\"");
+        w.value (1);
+        w.endArray ();
+        CHECK ( w.flush () );
+    }
+    std::string object = R"({"value":")" + large + R"("})";
+    std::string element = "\"" + large + "\"";
+    CHECK ( out.str () == "[" + object + "," + object + "," + object + "," + element + "," + element + ",1]" );
+}
@@ -25,6 +25,7 @@
  * \brief Not yet documented file
  */
 #include <catch.hpp>
+#include <regex>
 #include <string>
 #include <limits.h>
 
@@ -261,3 +262,61 @@ TEST_CASE ("stobiosf", "[utilities]") {
     CHECK ( utils::math::stobiosf ("12x43", integer, scale) == false );
     CHECK ( utils::math::stobiosf ("sdfsd", integer, scale) == false );
 }
+
+TEST_CASE ("classify_ext_attribute", "[utilities]") {
+    std::string_view number;
+
+    CHECK ( utils::classify_ext_attribute ("outlet.12.label", number) == utils::ExtAttrKind::OUTLET_LABEL );
+    CHECK ( number == "12" );
+    CHECK ( utils::classify_ext_attribute ("outlet.1.group", number) == utils::ExtAttrKind::OUTLET_GROUP );
+    CHECK ( number == "1" );
+    CHECK ( utils::classify_ext_attribute ("outlet.007.type", number) == utils::ExtAttrKind::OUTLET_TYPE );
+    CHECK ( number == "007" );
+    CHECK ( utils::classify_ext_attribute ("ip.1", number) == utils::ExtAttrKind::IP );
+    CHECK ( number == "1" );
+    CHECK ( utils::classify_ext_attribute ("mac.2", number) == utils::ExtAttrKind::MAC );
+    CHECK ( number == "2" );
+    CHECK ( utils::classify_ext_attribute ("hostname.3", number) == utils::ExtAttrKind::HOSTNAME );
+    CHECK ( number == "3" );
+    CHECK ( utils::classify_ext_attribute ("fqdn.40", number) == utils::ExtAttrKind::FQDN );
+    CHECK ( number == "40" );
+
+    // number is left untouched for other attributes
+    number = "untouched";
+    CHECK ( utils::classify_ext_attribute ("ip.", number) == utils::ExtAttrKind::OTHER );
+    CHECK ( utils::classify_ext_attribute ("outlet.label", number) == utils::ExtAttrKind::OTHER );
+    CHECK ( number == "untouched" );
+}
+
+TEST_CASE ("classify_ext_attribute matches the former regex", "[utilities]") {
+    // regex used by getJsonAsset before classify_ext_attribute
+    static const std::vector<std::pair<std::regex, utils::ExtAttrKind>> regexes = {
+        {std::regex ("^outlet\\.[0-9][0-9]*\\.label$"), utils::ExtAttrKind::OUTLET_LABEL},
+        {std::regex ("^outlet\\.[0-9][0-9]*\\.group$"), utils::ExtAttrKind::OUTLET_GROUP},
+        {std::regex ("^outlet\\.[0-9][0-9]*\\.type$"), utils::ExtAttrKind::OUTLET_TYPE},
+        {std::regex ("^ip\\.[0-9][0-9]*$"), utils::ExtAttrKind::IP},
+        {std::regex ("^mac\\.[0-9][0-9]*$"), utils::ExtAttrKind::MAC},
+        {std::regex ("^fqdn\\.[0-9][0-9]*$"), utils::ExtAttrKind::FQDN},
+        {std::regex ("^hostname\\.[0-9][0-9]*$"), utils::ExtAttrKind::HOSTNAME},
+    };
+    static const std::vector<std::string> names = {
+        "", "name", "ip", "ip.", "ip.1", "ip.12", "ip.1a", "ip.a1", "ip..1", "ip.1.", " ip.1", "ip.1 ", "IP.1",
+        "ipv6.1", "ip6.1", "mac.", "mac.3", "mac.x", "hostname.1", "hostname.", "hostname1", "fqdn.2", "fqdn.2.1",
+        "outlet.", "outlet.1", "outlet.1.", "outlet.1.label", "outlet.1.labels", "outlet.1.label.", "outlet..label",
+        "outlet.a.label", "outlet.1a.label", "outlet.10.group", "outlet.10.type", "outlet.10.typ", "outlet.label",
+        "outlet.switchable", "outlet.1.switchable", "outlets.1.label", "xoutlet.1.label", "ip.\n1"
+    };
+
+    for (const auto& name : names) {
+        utils::ExtAttrKind expected = utils::ExtAttrKind::OTHER;
+        for (const auto& it : regexes) {
+            if (std::regex_match (name, it.first)) {
+                expected = it.second;
+                break;
+            }
+        }
+        std::string_view number;
+        CAPTURE (name);
+        CHECK ( utils::classify_ext_attribute (name, number) == expected );
+    }
+}